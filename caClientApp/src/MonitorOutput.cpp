@@ -0,0 +1,251 @@
+#include "MonitorOutput.h"
+
+#include <alarm.h>
+
+#include <cerrno>
+#include <stdexcept>
+
+#include <unistd.h>
+
+namespace caClientApp {
+
+OutputWriter::OutputWriter(int fd, std::size_t capacity) : fd_(fd), buf_(capacity > 0 ? capacity : 1), used_(0)
+{
+}
+
+OutputWriter::~OutputWriter()
+{
+    try {
+        flush();
+    } catch (const std::exception &) {
+        // stdout closed (e.g. a pipe reader went away); nothing left to do.
+    }
+}
+
+void OutputWriter::flush()
+{
+    if (used_ > 0) {
+        const std::size_t n = used_;
+        used_ = 0;
+        writeAll(buf_.data(), n);
+    }
+}
+
+void OutputWriter::writeAll(const char *s, std::size_t n)
+{
+    while (n > 0) {
+        const ssize_t w = ::write(fd_, s, n);
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("write to output failed");
+        }
+        s += w;
+        n -= static_cast<std::size_t>(w);
+    }
+}
+
+bool parseOutputFormat(const std::string_view &name, OutputFormat &out)
+{
+    if (name == "text") {
+        out = OutputFormat::Text;
+    } else if (name == "csv") {
+        out = OutputFormat::Csv;
+    } else if (name == "json") {
+        out = OutputFormat::Json;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+// JSON number grammar, so numeric values are emitted unquoted.
+bool isJsonNumber(std::string_view s)
+{
+    std::size_t i = 0;
+    const std::size_t n = s.size();
+    if (i < n && s[i] == '-') {
+        i++;
+    }
+    const std::size_t intStart = i;
+    while (i < n && s[i] >= '0' && s[i] <= '9') {
+        i++;
+    }
+    if (i == intStart || (s[intStart] == '0' && i - intStart > 1)) {
+        return false;
+    }
+    if (i < n && s[i] == '.') {
+        const std::size_t fracStart = ++i;
+        while (i < n && s[i] >= '0' && s[i] <= '9') {
+            i++;
+        }
+        if (i == fracStart) {
+            return false;
+        }
+    }
+    if (i < n && (s[i] == 'e' || s[i] == 'E')) {
+        i++;
+        if (i < n && (s[i] == '+' || s[i] == '-')) {
+            i++;
+        }
+        const std::size_t expStart = i;
+        while (i < n && s[i] >= '0' && s[i] <= '9') {
+            i++;
+        }
+        if (i == expStart) {
+            return false;
+        }
+    }
+    return i == n;
+}
+
+const char *alarmName(const char *const *table, int count, int v)
+{
+    return (v >= 0 && v < count) ? table[v] : "?";
+}
+
+} // namespace
+
+UpdateFormatter::UpdateFormatter(OutputWriter &out, OutputFormat format)
+    : out_(out), format_(format), cachedSec_(0), prefixLen_(0)
+{
+    prefix_[0] = '\0';
+}
+
+void UpdateFormatter::writeHeader()
+{
+    if (format_ == OutputFormat::Csv) {
+        out_.write("time,pv,value,status,severity\n");
+    }
+}
+
+void UpdateFormatter::writeTime(const epicsTimeStamp &ts)
+{
+    if (prefixLen_ == 0 || ts.secPastEpoch != cachedSec_) {
+        epicsTimeStamp whole = ts;
+        whole.nsec = 0;
+        const char *fmt = format_ == OutputFormat::Json ? "%Y-%m-%dT%H:%M:%S" : "%Y-%m-%d %H:%M:%S";
+        prefixLen_ = epicsTimeToStrftime(prefix_, sizeof(prefix_), fmt, &whole);
+        cachedSec_ = ts.secPastEpoch;
+    }
+    out_.write(prefix_, prefixLen_);
+
+    char frac[7];
+    frac[0] = '.';
+    unsigned long us = ts.nsec / 1000;
+    for (int i = 6; i >= 1; i--) {
+        frac[i] = static_cast<char>('0' + us % 10);
+        us /= 10;
+    }
+    out_.write(frac, sizeof(frac));
+}
+
+void UpdateFormatter::writeInt(long v)
+{
+    char buf[24];
+    char *p = buf + sizeof(buf);
+    const bool neg = v < 0;
+    unsigned long u = neg ? 0ul - static_cast<unsigned long>(v) : static_cast<unsigned long>(v);
+    do {
+        *--p = static_cast<char>('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (neg) {
+        *--p = '-';
+    }
+    out_.write(p, static_cast<std::size_t>(buf + sizeof(buf) - p));
+}
+
+void UpdateFormatter::writeJsonString(std::string_view s)
+{
+    static const char hex[] = "0123456789abcdef";
+    out_.put('"');
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out_.put('\\');
+            out_.put(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            const char esc[6] = {'\\', 'u', '0', '0', hex[(c >> 4) & 0xf], hex[c & 0xf]};
+            out_.write(esc, sizeof(esc));
+        } else {
+            out_.put(c);
+        }
+    }
+    out_.put('"');
+}
+
+void UpdateFormatter::writeCsvField(std::string_view s)
+{
+    if (s.find_first_of(",\"\n") == std::string_view::npos) {
+        out_.write(s);
+        return;
+    }
+    out_.put('"');
+    for (char c : s) {
+        if (c == '"') {
+            out_.put('"');
+        }
+        out_.put(c);
+    }
+    out_.put('"');
+}
+
+void UpdateFormatter::write(const caClientLib::MonitorUpdate &u)
+{
+    const std::string_view value = u.value.view();
+
+    switch (format_) {
+    case OutputFormat::Text: {
+        out_.write(u.pvName);
+        for (std::size_t i = u.pvName.size(); i < 30; i++) {
+            out_.put(' ');
+        }
+        out_.put(' ');
+        writeTime(u.ts);
+        out_.put(' ');
+        out_.write(value);
+        if (u.alarmStatus != 0 || u.alarmSeverity != 0) {
+            out_.put(' ');
+            out_.write(alarmName(epicsAlarmConditionStrings, ALARM_NSTATUS, u.alarmStatus));
+            out_.put(' ');
+            out_.write(alarmName(epicsAlarmSeverityStrings, ALARM_NSEV, u.alarmSeverity));
+        }
+        out_.put('\n');
+        break;
+    }
+    case OutputFormat::Csv:
+        writeTime(u.ts);
+        out_.put(',');
+        writeCsvField(u.pvName);
+        out_.put(',');
+        writeCsvField(value);
+        out_.put(',');
+        writeInt(u.alarmStatus);
+        out_.put(',');
+        writeInt(u.alarmSeverity);
+        out_.put('\n');
+        break;
+    case OutputFormat::Json:
+        out_.write("{\"time\":\"");
+        writeTime(u.ts);
+        out_.write("\",\"pv\":");
+        writeJsonString(u.pvName);
+        out_.write(",\"value\":");
+        if (isJsonNumber(value)) {
+            out_.write(value);
+        } else {
+            writeJsonString(value);
+        }
+        out_.write(",\"status\":");
+        writeInt(u.alarmStatus);
+        out_.write(",\"severity\":");
+        writeInt(u.alarmSeverity);
+        out_.write("}\n");
+        break;
+    }
+}
+
+} // namespace caClientApp
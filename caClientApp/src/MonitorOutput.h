@@ -0,0 +1,91 @@
+#ifndef CACL_APP_MONITOR_OUTPUT_H
+#define CACL_APP_MONITOR_OUTPUT_H
+
+#include "caClientLib/CaMonitor.h"
+
+#include <epicsTime.h>
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace caClientApp {
+
+// Output buffer over a file descriptor; write(2) only when full or flushed.
+class OutputWriter {
+public:
+    explicit OutputWriter(int fd = 1, std::size_t capacity = 64 * 1024);
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter &) = delete;
+    OutputWriter &operator=(const OutputWriter &) = delete;
+
+    void write(const char *s, std::size_t n)
+    {
+        if (n > buf_.size() - used_) {
+            flush();
+            if (n > buf_.size()) {
+                writeAll(s, n);
+                return;
+            }
+        }
+        std::memcpy(&buf_[used_], s, n);
+        used_ += n;
+    }
+
+    void write(std::string_view s) { write(s.data(), s.size()); }
+
+    void put(char c)
+    {
+        if (used_ == buf_.size()) {
+            flush();
+        }
+        buf_[used_++] = c;
+    }
+
+    void flush();
+
+private:
+    void writeAll(const char *s, std::size_t n);
+
+    int fd_;
+    std::vector<char> buf_;
+    std::size_t used_;
+};
+
+enum class OutputFormat {
+    Text, // camonitor-like
+    Csv,
+    Json, // one object per line
+};
+
+bool parseOutputFormat(const std::string_view &name, OutputFormat &out);
+
+// Formats MonitorUpdates without iostreams: the date/time part is produced by
+// epicsTimeToStrftime() once per second and cached, fractions and integers
+// are written digit by digit.
+class UpdateFormatter {
+public:
+    UpdateFormatter(OutputWriter &out, OutputFormat format);
+
+    // CSV column names; nothing for the other formats.
+    void writeHeader();
+    void write(const caClientLib::MonitorUpdate &u);
+
+private:
+    void writeTime(const epicsTimeStamp &ts);
+    void writeInt(long v);
+    void writeJsonString(std::string_view s);
+    void writeCsvField(std::string_view s);
+
+    OutputWriter &out_;
+    OutputFormat format_;
+    epicsUInt32 cachedSec_;
+    char prefix_[32];
+    std::size_t prefixLen_;
+};
+
+} // namespace caClientApp
+
+#endif
@@ -0,0 +1,319 @@
+#include "PvList.h"
+
+#include <cctype>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+
+#include <fnmatch.h>
+
+namespace caClientApp {
+
+namespace {
+
+typedef std::map<std::string, std::string> Macros;
+
+std::string readFile(const std::string &path)
+{
+    std::ifstream in(path.c_str());
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+std::string dirName(const std::string &path)
+{
+    const std::string::size_type slash = path.rfind('/');
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// $(NAME), ${NAME} and $(NAME=default); unknown macros are left in place.
+std::string expandMacros(const std::string &s, const Macros &macros)
+{
+    std::string out;
+    std::string::size_type i = 0;
+    while (i < s.size()) {
+        if (s[i] == '$' && i + 1 < s.size() && (s[i + 1] == '(' || s[i + 1] == '{')) {
+            const char close = s[i + 1] == '(' ? ')' : '}';
+            const std::string::size_type end = s.find(close, i + 2);
+            if (end != std::string::npos) {
+                std::string name = s.substr(i + 2, end - i - 2);
+                std::string def;
+                bool hasDefault = false;
+                const std::string::size_type eq = name.find('=');
+                if (eq != std::string::npos) {
+                    def = name.substr(eq + 1);
+                    name.erase(eq);
+                    hasDefault = true;
+                }
+                const Macros::const_iterator it = macros.find(name);
+                if (it != macros.end()) {
+                    out += it->second;
+                } else if (hasDefault) {
+                    out += def;
+                } else {
+                    out.append(s, i, end - i + 1);
+                }
+                i = end + 1;
+                continue;
+            }
+        }
+        out += s[i++];
+    }
+    return out;
+}
+
+std::vector<std::string> templateRecordNames(const std::string &path)
+{
+    static const std::regex recordRe("(^|[^A-Za-z0-9_])g?record\\s*\\(\\s*[^,\\s]+\\s*,\\s*(\"([^\"]*)\"|[^\\s,)]+)");
+
+    std::vector<std::string> names;
+    std::istringstream in(readFile(path));
+    std::string line;
+    while (std::getline(in, line)) {
+        const std::string::size_type hash = line.find('#');
+        if (hash != std::string::npos) {
+            line.erase(hash);
+        }
+        std::smatch m;
+        if (std::regex_search(line, m, recordRe)) {
+            names.push_back(m[3].matched ? m[3].str() : m[2].str());
+        }
+    }
+    return names;
+}
+
+// Tokens: '{', '}', ',', '=', quoted strings and bare words.
+class SubstTokenizer {
+public:
+    explicit SubstTokenizer(const std::string &text) : text_(text), pos_(0) {}
+
+    bool next(std::string &tok, bool &quoted)
+    {
+        skipSpace();
+        if (pos_ >= text_.size()) {
+            return false;
+        }
+        quoted = false;
+        const char c = text_[pos_];
+        if (c == '{' || c == '}' || c == ',' || c == '=') {
+            tok.assign(1, c);
+            pos_++;
+            return true;
+        }
+        tok.clear();
+        if (c == '"') {
+            quoted = true;
+            pos_++;
+            while (pos_ < text_.size() && text_[pos_] != '"') {
+                if (text_[pos_] == '\\' && pos_ + 1 < text_.size()) {
+                    pos_++;
+                }
+                tok += text_[pos_++];
+            }
+            pos_++;
+            return true;
+        }
+        while (pos_ < text_.size() && !std::isspace(static_cast<unsigned char>(text_[pos_])) &&
+               std::string("{},=\"#").find(text_[pos_]) == std::string::npos) {
+            tok += text_[pos_++];
+        }
+        return true;
+    }
+
+    bool peek(std::string &tok)
+    {
+        const std::string::size_type save = pos_;
+        bool quoted;
+        const bool ok = next(tok, quoted);
+        pos_ = save;
+        return ok;
+    }
+
+private:
+    void skipSpace()
+    {
+        while (pos_ < text_.size()) {
+            if (std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+                pos_++;
+            } else if (text_[pos_] == '#') {
+                while (pos_ < text_.size() && text_[pos_] != '\n') {
+                    pos_++;
+                }
+            } else {
+                break;
+            }
+        }
+    }
+
+    const std::string &text_;
+    std::string::size_type pos_;
+};
+
+class SubstParser {
+public:
+    SubstParser(const std::string &path) : path_(path), text_(readFile(path)), tok_(text_) {}
+
+    std::vector<std::string> parse()
+    {
+        std::string t;
+        while (next(t)) {
+            if (t == "global") {
+                expect("{");
+                assignments(globals_);
+            } else if (t == "file") {
+                std::string file;
+                if (!next(file)) {
+                    fail("expected template file name");
+                }
+                expect("{");
+                fileBody(dirName(path_) + file);
+            } else {
+                fail("unexpected '" + t + "'");
+            }
+        }
+        return names_;
+    }
+
+private:
+    bool next(std::string &t)
+    {
+        bool quoted;
+        return tok_.next(t, quoted);
+    }
+
+    void expect(const char *what)
+    {
+        std::string t;
+        if (!next(t) || t != what) {
+            fail(std::string("expected '") + what + "'");
+        }
+    }
+
+    [[noreturn]] void fail(const std::string &msg) { throw std::runtime_error(path_ + ": " + msg); }
+
+    // NAME=value, ... '}'
+    void assignments(Macros &out)
+    {
+        std::string t;
+        while (next(t) && t != "}") {
+            if (t == ",") {
+                continue;
+            }
+            std::string eq;
+            std::string value;
+            if (!next(eq) || eq != "=" || !next(value)) {
+                fail("expected NAME=value");
+            }
+            out[t] = value;
+        }
+    }
+
+    // value, ... '}'
+    std::vector<std::string> list()
+    {
+        std::vector<std::string> out;
+        std::string t;
+        while (next(t) && t != "}") {
+            if (t != ",") {
+                out.push_back(t);
+            }
+        }
+        return out;
+    }
+
+    void fileBody(const std::string &templatePath)
+    {
+        std::string t;
+        if (tok_.peek(t) && t == "pattern") {
+            next(t);
+            expect("{");
+            const std::vector<std::string> cols = list();
+            while (tok_.peek(t) && t == "{") {
+                next(t);
+                const std::vector<std::string> values = list();
+                Macros row = globals_;
+                for (std::size_t i = 0; i < cols.size() && i < values.size(); i++) {
+                    row[cols[i]] = values[i];
+                }
+                emit(templatePath, row);
+            }
+        } else {
+            while (tok_.peek(t) && t == "{") {
+                next(t);
+                Macros row = globals_;
+                assignments(row);
+                emit(templatePath, row);
+            }
+        }
+        expect("}");
+    }
+
+    void emit(const std::string &templatePath, const Macros &macros)
+    {
+        std::map<std::string, std::vector<std::string>>::iterator it = templates_.find(templatePath);
+        if (it == templates_.end()) {
+            it = templates_.insert(std::make_pair(templatePath, templateRecordNames(templatePath))).first;
+        }
+        for (const std::string &name : it->second) {
+            names_.push_back(expandMacros(name, macros));
+        }
+    }
+
+    std::string path_;
+    std::string text_;
+    SubstTokenizer tok_;
+    Macros globals_;
+    std::map<std::string, std::vector<std::string>> templates_;
+    std::vector<std::string> names_;
+};
+
+} // namespace
+
+std::vector<std::string> readPvListFile(const std::string &path)
+{
+    std::ifstream in(path.c_str());
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    std::vector<std::string> names;
+    std::string line;
+    while (std::getline(in, line)) {
+        const std::string::size_type hash = line.find('#');
+        if (hash != std::string::npos) {
+            line.erase(hash);
+        }
+        const std::string::size_type b = line.find_first_not_of(" \t\r");
+        if (b == std::string::npos) {
+            continue;
+        }
+        const std::string::size_type e = line.find_last_not_of(" \t\r");
+        names.push_back(line.substr(b, e - b + 1));
+    }
+    return names;
+}
+
+std::vector<std::string> expandSubstitutions(const std::string &path)
+{
+    SubstParser parser(path);
+    return parser.parse();
+}
+
+std::vector<std::string> filterGlob(const std::vector<std::string> &names, const std::string &pattern)
+{
+    std::vector<std::string> out;
+    for (const std::string &n : names) {
+        if (fnmatch(pattern.c_str(), n.c_str(), 0) == 0) {
+            out.push_back(n);
+        }
+    }
+    return out;
+}
+
+} // namespace caClientApp
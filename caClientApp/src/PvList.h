@@ -0,0 +1,22 @@
+#ifndef CACL_APP_PV_LIST_H
+#define CACL_APP_PV_LIST_H
+
+#include <string>
+#include <vector>
+
+namespace caClientApp {
+
+// One PV name per line; blank lines and '#' comments are skipped.
+std::vector<std::string> readPvListFile(const std::string &path);
+
+// Expands a dbLoadTemplate/msi substitutions file (e.g. gpio.substitutions)
+// into the record names it would create. Templates are looked up relative to
+// the substitutions file; both "pattern" and "NAME=value" rows are supported.
+std::vector<std::string> expandSubstitutions(const std::string &path);
+
+// Keeps the names matching a shell-style (fnmatch) pattern.
+std::vector<std::string> filterGlob(const std::vector<std::string> &names, const std::string &pattern);
+
+} // namespace caClientApp
+
+#endif
@@ -1,12 +1,25 @@
 #include "caClientLib/CaClient.h"
+#include "caClientLib/CaptureReader.h"
+#include "caClientLib/CaptureWriter.h"
+#include "caClientLib/ShmRing.h"
+#include "caClientLib/SnapshotJoiner.h"
+
+#include "MonitorOutput.h"
+#include "PvList.h"
 
 #include <epicsTime.h>
 
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -16,6 +29,19 @@ struct Options {
     double timeoutSec = 2.0;
     double monitorDurationSec = 0.0; // 0 = run forever unless count set
     int monitorCount = 0;            // 0 = unlimited unless duration set
+    int statsRounds = 100;
+};
+
+// Selection for query/replay; times are seconds from the start of the capture.
+struct CaptureQuery {
+    std::string path;
+    std::vector<std::string> pvs; // empty = all
+    double fromSec = 0.0;
+    double toSec = -1.0; // < 0 = to the end
+    double binSec = 0.0; // > 0 = aggregate
+    double speed = 1.0;
+    std::string format; // query: csv (default) or json; replay: text (default), csv or json
+    bool info = false;
 };
 
 static void printUsage(const char *argv0)
@@ -30,14 +56,32 @@ static void printUsage(const char *argv0)
 
     std::cerr
         << "Usage:\n"
-        << "  " << prog << " [--prefix PFX] [--timeout SEC] get <pv>\n"
+        << "  " << prog << " [--prefix PFX] [--timeout SEC] get <pv> [<pv> ...]\n"
         << "  " << prog << " [--prefix PFX] [--timeout SEC] put <pv> <value>\n"
-        << "  " << prog << " [--prefix PFX] [--timeout SEC] monitor <pv> [--duration SEC] [--count N]\n\n"
+        << "  " << prog << " [--prefix PFX] [--timeout SEC] monitor [<pv> ...] [--file LIST] [--subst FILE [--glob PAT]]\n"
+        << "        [--format text|csv|json] [--duration SEC] [--count N]\n"
+        << "  " << prog << " [--prefix PFX] [--timeout SEC] stats <pv> [<pv> ...] [--rounds N] [--duration SEC]\n"
+        << "  " << prog << " [--prefix PFX] [--timeout SEC] record <file> <pv> [<pv> ...] [--duration SEC] [--count N]\n"
+        << "  " << prog << " [--prefix PFX] query <file> [<pv> ...] [--from SEC] [--to SEC] [--bin SEC] [--format csv|json] [--info]\n"
+        << "  " << prog << " [--prefix PFX] replay <file> [<pv> ...] [--from SEC] [--to SEC] [--speed X] [--format text|csv|json]\n"
+        << "  " << prog << " [--prefix PFX] [--timeout SEC] publish <pv> [<pv> ...] [--capacity N] [--duration SEC]\n"
+        << "  " << prog << " [--prefix PFX] shm <pv> [<pv> ...] [--follow] [--duration SEC] [--format text|csv|json]\n"
+        << "  " << prog << " [--prefix PFX] [--timeout SEC] snapshot <pv> [<pv> ...] [--every SEC] [--trigger PV]\n"
+        << "        [--mode before|exact|interp] [--tolerance SEC] [--lag SEC] [--depth N]\n"
+        << "        [--duration SEC] [--count N] [--format csv|json]\n\n"
         << "Examples (your StreamDevice IOC PVs):\n"
         << "  " << prog << " get led\n"
         << "  " << prog << " put led 1\n"
         << "  " << prog << " get ai0:mean\n"
-        << "  " << prog << " monitor ai0:mean --duration 5\n";
+        << "  " << prog << " monitor ai0:mean --duration 5\n"
+        << "  " << prog << " monitor --subst espCmdApp/Db/gpio.substitutions --glob 'gpio*:in' --format json\n"
+        << "  " << prog << " stats ai0:mean ai1:mean --rounds 200 --duration 5\n"
+        << "  " << prog << " record ai.cap ai0 ai1 ai0:mean ai1:mean --duration 60\n"
+        << "  " << prog << " query ai.cap ai0:mean --from 10 --to 20 --bin 1\n"
+        << "  " << prog << " replay ai.cap --speed 10\n"
+        << "  " << prog << " publish ai0:mean ai1:mean &\n"
+        << "  " << prog << " shm ai0:mean --follow\n"
+        << "  " << prog << " snapshot ai0:mean ai1:mean gpio4:in --every 0.5 --mode interp --lag 1\n";
 }
 
 static std::string fullPvName(const Options &opt, const std::string &pv)
@@ -73,30 +117,21 @@ static bool parseDouble(const std::string &s, double &out)
     return true;
 }
 
-static void printTimeStamp(const epicsTimeStamp &ts)
-{
-    char buf[64];
-    if (epicsTimeToStrftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S.%06f", &ts) == 0) {
-        std::cout << "(time?)";
-        return;
-    }
-    std::cout << buf;
-}
-
-class PrintHandler final : public caClientLib::IMonitorHandler {
+class FormatHandler final : public caClientLib::IMonitorHandler {
 public:
+    explicit FormatHandler(caClientApp::UpdateFormatter &formatter) : formatter_(formatter) {}
+
     void onUpdate(const caClientLib::MonitorUpdate &u) override
     {
-        printTimeStamp(u.ts);
-        std::cout << " " << u.pvName << " = " << u.value
-                  << " (stat=" << u.alarmStatus << ", sevr=" << u.alarmSeverity << ")\n";
+        formatter_.write(u);
         ++seen_;
     }
 
-    int seen() const { return seen_; }
+    long seen() const { return seen_; }
 
 private:
-    int seen_ = 0;
+    caClientApp::UpdateFormatter &formatter_;
+    long seen_ = 0;
 };
 
 static void cmdGet(const Options &opt, const std::string &pvArg)
@@ -106,6 +141,29 @@ static void cmdGet(const Options &opt, const std::string &pvArg)
     std::cout << pv << " = " << client.getString(pv, opt.timeoutSec) << "\n";
 }
 
+// Snapshot of several PVs in one round trip; returns false if any PV failed.
+static bool cmdGetMany(const Options &opt, const std::vector<std::string> &pvArgs)
+{
+    caClientLib::CaClient client;
+
+    std::vector<std::string> pvs;
+    pvs.reserve(pvArgs.size());
+    for (const std::string &pvArg : pvArgs) {
+        pvs.push_back(fullPvName(opt, pvArg));
+    }
+
+    bool ok = true;
+    for (const caClientLib::CaGroupResult &r : client.getStrings(pvs, opt.timeoutSec)) {
+        if (r.ok()) {
+            std::cout << r.pvName << " = " << r.value << "\n";
+        } else {
+            std::cerr << "Error: " << r.pvName << ": " << ca_message(r.status) << "\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
 static void cmdPut(const Options &opt, const std::string &pvArg, const std::string &value)
 {
     caClientLib::CaClient client;
@@ -113,33 +171,539 @@ static void cmdPut(const Options &opt, const std::string &pvArg, const std::stri
     client.putString(pv, value, opt.timeoutSec);
 }
 
-static void cmdMonitor(const Options &opt, const std::string &pvArg)
+// Monitors every PV and writes updates through one buffered formatter; the
+// buffer is flushed after each batch of callbacks. Returns false if any PV
+// could not be subscribed.
+static bool cmdMonitor(const Options &opt, const std::vector<std::string> &pvs, caClientApp::OutputFormat format)
 {
     caClientLib::CaClient client;
-    const std::string pv = fullPvName(opt, pvArg);
 
-    PrintHandler handler;
-    std::unique_ptr<caClientLib::CaMonitor> mon = client.monitorStringTime(pv, opt.timeoutSec, handler);
+    caClientApp::OutputWriter out;
+    caClientApp::UpdateFormatter formatter(out, format);
+    FormatHandler handler(formatter);
+    formatter.writeHeader();
+
+    bool ok = true;
+    std::vector<caClientLib::CaSubscription> monitors;
+    monitors.reserve(pvs.size());
+    for (const std::string &pvArg : pvs) {
+        const std::string pv = fullPvName(opt, pvArg);
+        caClientLib::CaResult<caClientLib::CaSubscription> m = client.trySubscribe(pv, opt.timeoutSec, handler);
+        if (m) {
+            monitors.push_back(std::move(*m));
+        } else {
+            std::cerr << "Error: " << pv << ": " << m.message() << "\n";
+            ok = false;
+        }
+    }
+    if (monitors.empty()) {
+        return false;
+    }
+
+    // Sleeps until CA has data instead of waking every 100 ms.
+    client.run([&]() {
+        out.flush();
+        return opt.monitorCount > 0 && handler.seen() >= opt.monitorCount;
+    }, opt.monitorDurationSec);
+    out.flush();
+    return ok;
+}
+
+class CountHandler final : public caClientLib::IMonitorHandler {
+public:
+    void onUpdate(const caClientLib::MonitorUpdate &) override { ++seen_; }
+    long seen() const { return seen_; }
+
+private:
+    long seen_ = 0;
+};
+
+static void printLatency(const char *name, const caClientLib::LatencySummary &s)
+{
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-12s %8llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+        static_cast<unsigned long long>(s.count), s.minNs / 1e3, s.p50Ns / 1e3, s.p90Ns / 1e3, s.p99Ns / 1e3,
+        s.p999Ns / 1e3, s.maxNs / 1e3);
+    std::cout << line;
+}
+
+// Times repeated gets of the PVs, then monitors them for opt.monitorDurationSec
+// to measure delivery lag, and dumps the latency histograms (microseconds).
+static bool cmdStats(const Options &opt, const std::vector<std::string> &pvArgs)
+{
+    caClientLib::CaClient client;
+    client.resetStats();
+
+    std::vector<std::string> pvs;
+    for (const std::string &pvArg : pvArgs) {
+        pvs.push_back(fullPvName(opt, pvArg));
+    }
+
+    bool ok = true;
+    for (int round = 0; round < opt.statsRounds; round++) {
+        for (const std::string &pv : pvs) {
+            const caClientLib::CaResult<std::string> r = client.tryGetString(pv, opt.timeoutSec);
+            if (!r) {
+                std::cerr << "Error: " << pv << ": " << r.message() << "\n";
+                ok = false;
+            }
+        }
+    }
+
+    long updates = 0;
+    if (opt.monitorDurationSec > 0.0) {
+        CountHandler handler;
+        std::vector<caClientLib::CaSubscription> monitors;
+        for (const std::string &pv : pvs) {
+            monitors.push_back(client.subscribe(pv, opt.timeoutSec, handler));
+        }
+        client.run(std::function<bool()>(), opt.monitorDurationSec);
+        updates = handler.seen();
+    }
+
+    const caClientLib::CaClientStats s = client.stats();
+    std::cout << "metric          count     min_us     p50_us     p90_us     p99_us   p99.9_us     max_us\n";
+    printLatency("connect", s.connect);
+    printLatency("get", s.get);
+    printLatency("put", s.put);
+    printLatency("pend_io", s.pendIo);
+    printLatency("monitor_lag", s.monitorLag);
+    std::cout << "monitor updates: " << updates << "\n"
+              << "channel cache: hits=" << s.cache.hits << " misses=" << s.cache.misses
+              << " evictions=" << s.cache.evictions << " reconnects=" << s.cache.reconnects << "\n";
+    return ok;
+}
+
+volatile std::sig_atomic_t gInterrupted = 0;
+
+extern "C" void onInterrupt(int)
+{
+    gInterrupted = 1;
+}
+
+class RecordHandler final : public caClientLib::ITypedMonitorHandler<double> {
+public:
+    RecordHandler(caClientLib::CaptureWriter &writer, std::uint32_t pvId, long &seen)
+        : writer_(writer), pvId_(pvId), seen_(seen)
+    {
+    }
 
-    epicsTimeStamp start{};
-    epicsTimeGetCurrent(&start);
+    void onUpdate(const caClientLib::TypedUpdate<double> &u) override
+    {
+        writer_.append(pvId_, u.ts, u.value, u.alarmStatus, u.alarmSeverity);
+        ++seen_;
+    }
 
-    while (true) {
-        client.pendEvent(0.1);
+private:
+    caClientLib::CaptureWriter &writer_;
+    std::uint32_t pvId_;
+    long &seen_;
+};
+
+// Appends DBR_TIME_DOUBLE updates of every PV to a capture file until the
+// duration/count is reached or SIGINT. Blocks are flushed once a second.
+static void cmdRecord(const Options &opt, const std::string &path, const std::vector<std::string> &pvArgs)
+{
+    caClientLib::CaClient client;
+    caClientLib::CaptureWriter writer(path);
+
+    long seen = 0;
+    std::vector<std::unique_ptr<RecordHandler>> handlers;
+    std::vector<std::unique_ptr<caClientLib::CaTypedMonitor<double>>> monitors;
+    for (const std::string &pvArg : pvArgs) {
+        const std::string pv = fullPvName(opt, pvArg);
+        handlers.emplace_back(new RecordHandler(writer, writer.addPv(pv), seen));
+        monitors.push_back(client.monitor<double>(pv, opt.timeoutSec, *handlers.back()));
+    }
 
-        if (opt.monitorCount > 0 && handler.seen() >= opt.monitorCount) {
-            break;
+    std::signal(SIGINT, onInterrupt);
+    std::signal(SIGTERM, onInterrupt);
+
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    Clock::time_point lastFlush = start;
+    client.run([&]() {
+        if (Clock::now() - lastFlush >= std::chrono::seconds(1)) {
+            writer.flush();
+            lastFlush = Clock::now();
         }
+        return gInterrupted || (opt.monitorCount > 0 && seen >= opt.monitorCount);
+    }, opt.monitorDurationSec);
+
+    monitors.clear();
+    writer.close();
+
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cerr << "Recorded " << writer.samples() << " updates of " << pvArgs.size() << " PVs in " << elapsed
+              << " s (" << writer.bytes() << " bytes) to " << path << "\n";
+}
 
-        if (opt.monitorDurationSec > 0.0) {
-            epicsTimeStamp now{};
-            epicsTimeGetCurrent(&now);
-            const double elapsed = epicsTimeDiffInSeconds(&now, &start);
-            if (elapsed >= opt.monitorDurationSec) {
-                break;
+// Republishes monitor updates of every PV into its shared-memory ring for
+// local readers (see ShmRing.h) until the duration elapses or SIGINT.
+static void cmdPublish(const Options &opt, const std::vector<std::string> &pvArgs, std::size_t capacity)
+{
+    caClientLib::CaClient client;
+
+    std::vector<std::unique_ptr<caClientLib::ShmRingWriter>> writers;
+    std::vector<caClientLib::CaSubscription> subscriptions;
+    for (const std::string &pvArg : pvArgs) {
+        const std::string pv = fullPvName(opt, pvArg);
+        writers.emplace_back(new caClientLib::ShmRingWriter(pv, capacity));
+        subscriptions.push_back(client.subscribe(pv, opt.timeoutSec, *writers.back()));
+        std::cerr << pv << " -> /dev/shm" << writers.back()->name() << "\n";
+    }
+
+    std::signal(SIGINT, onInterrupt);
+    std::signal(SIGTERM, onInterrupt);
+    client.run([]() { return gInterrupted != 0; }, opt.monitorDurationSec);
+    subscriptions.clear();
+
+    std::uint64_t published = 0;
+    for (const std::unique_ptr<caClientLib::ShmRingWriter> &w : writers) {
+        published += w->published();
+    }
+    std::cerr << "Published " << published << " updates of " << writers.size() << " PVs\n";
+}
+
+// Reads PVs published by cmdPublish without any CA traffic: the latest value
+// of each, or with follow every new update until the duration elapses or
+// SIGINT. Returns false if a PV has no ring or nothing was published yet.
+static bool cmdShm(const Options &opt, const std::vector<std::string> &pvArgs, bool follow,
+                   caClientApp::OutputFormat format)
+{
+    std::vector<std::unique_ptr<caClientLib::ShmRingReader>> readers;
+    for (const std::string &pvArg : pvArgs) {
+        readers.emplace_back(new caClientLib::ShmRingReader(fullPvName(opt, pvArg)));
+    }
+
+    caClientApp::OutputWriter out;
+    caClientApp::UpdateFormatter formatter(out, format);
+    formatter.writeHeader();
+    caClientLib::MonitorUpdate u;
+
+    if (!follow) {
+        bool ok = true;
+        for (const std::unique_ptr<caClientLib::ShmRingReader> &r : readers) {
+            if (r->latest(u)) {
+                formatter.write(u);
+            } else {
+                std::cerr << "Error: " << r->pvName() << ": nothing published yet\n";
+                ok = false;
             }
         }
+        out.flush();
+        return ok;
     }
+
+    std::signal(SIGINT, onInterrupt);
+    std::signal(SIGTERM, onInterrupt);
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    std::uint64_t lost = 0;
+    while (!gInterrupted &&
+           (opt.monitorDurationSec <= 0.0 ||
+            std::chrono::duration<double>(Clock::now() - start).count() < opt.monitorDurationSec)) {
+        bool any = false;
+        for (const std::unique_ptr<caClientLib::ShmRingReader> &r : readers) {
+            while (r->next(u, &lost)) {
+                formatter.write(u);
+                any = true;
+            }
+        }
+        if (!any) {
+            out.flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    out.flush();
+    if (lost > 0) {
+        std::cerr << "Missed " << lost << " updates (reader fell behind the ring)\n";
+    }
+    return true;
+}
+
+static bool selectPvs(const Options &opt, const caClientLib::CaptureReader &reader,
+                      const std::vector<std::string> &pvArgs, std::vector<std::uint32_t> &ids)
+{
+    ids.clear();
+    if (pvArgs.empty()) {
+        for (std::size_t i = 0; i < reader.pvCount(); i++) {
+            ids.push_back(static_cast<std::uint32_t>(i));
+        }
+        return true;
+    }
+    for (const std::string &pvArg : pvArgs) {
+        std::uint32_t id;
+        if (!reader.findPv(pvArg, id) && !reader.findPv(fullPvName(opt, pvArg), id)) {
+            std::cerr << "Error: " << pvArg << " is not in the capture\n";
+            return false;
+        }
+        ids.push_back(id);
+    }
+    return true;
+}
+
+static void captureWindow(const caClientLib::CaptureReader &reader, const CaptureQuery &q, std::int64_t &fromNs,
+                          std::int64_t &toNs)
+{
+    fromNs = reader.firstNs() + static_cast<std::int64_t>(q.fromSec * 1e9);
+    toNs = q.toSec < 0.0 ? std::numeric_limits<std::int64_t>::max()
+                         : reader.firstNs() + static_cast<std::int64_t>(q.toSec * 1e9);
+}
+
+// Capture timestamps as POSIX seconds with nanoseconds.
+static void printNs(std::int64_t ns)
+{
+    const std::int64_t posix = ns + static_cast<std::int64_t>(POSIX_TIME_AT_EPICS_EPOCH) * 1000000000LL;
+    std::printf("%lld.%09lld", static_cast<long long>(posix / 1000000000LL),
+        static_cast<long long>(posix % 1000000000LL));
+}
+
+// Joined rows as CSV (empty field = no sample) or JSON (null).
+class SnapshotPrinter final : public caClientLib::ISnapshotHandler {
+public:
+    SnapshotPrinter(const std::vector<std::string> &pvs, bool json) : pvs_(pvs), json_(json) {}
+
+    void onSnapshot(const caClientLib::Snapshot &row) override
+    {
+        if (json_) {
+            std::printf("{\"time\":");
+        }
+        printNs(row.ns);
+        for (std::size_t c = 0; c < row.cells.size(); c++) {
+            const caClientLib::SnapshotCell &cell = row.cells[c];
+            if (json_) {
+                std::printf(",\"%s\":", pvs_[c].c_str());
+                if (cell.valid) {
+                    std::printf("%.15g", cell.value);
+                } else {
+                    std::printf("null");
+                }
+            } else if (cell.valid) {
+                std::printf(",%.15g", cell.value);
+            } else {
+                std::printf(",");
+            }
+        }
+        std::printf(json_ ? "}\n" : "\n");
+        ++rows_;
+    }
+
+    long rows() const { return rows_; }
+
+private:
+    const std::vector<std::string> &pvs_;
+    bool json_;
+    long rows_ = 0;
+};
+
+// Monitors the PVs as DBR_TIME_DOUBLE and prints time-aligned rows (see
+// SnapshotJoiner) every period and/or on each update of the trigger PV.
+static bool cmdSnapshot(const Options &opt, const std::vector<std::string> &pvArgs, const std::string &triggerArg,
+                        caClientLib::SnapshotOptions so, bool json)
+{
+    caClientLib::CaClient client;
+
+    std::vector<std::string> pvs;
+    for (const std::string &pvArg : pvArgs) {
+        pvs.push_back(fullPvName(opt, pvArg));
+    }
+    if (!triggerArg.empty()) {
+        const std::string trigger = fullPvName(opt, triggerArg);
+        std::vector<std::string>::iterator it = std::find(pvs.begin(), pvs.end(), trigger);
+        if (it == pvs.end()) {
+            it = pvs.insert(pvs.begin(), trigger);
+        }
+        so.trigger = static_cast<int>(it - pvs.begin());
+    }
+
+    SnapshotPrinter printer(pvs, json);
+    caClientLib::SnapshotJoiner joiner(pvs, printer, so);
+
+    std::vector<std::unique_ptr<caClientLib::CaTypedMonitor<double>>> monitors;
+    for (std::size_t c = 0; c < pvs.size(); c++) {
+        monitors.push_back(client.monitor<double>(pvs[c], opt.timeoutSec, joiner.input(c)));
+    }
+
+    if (!json) {
+        std::printf("time");
+        for (const std::string &pv : pvs) {
+            std::printf(",%s", pv.c_str());
+        }
+        std::printf("\n");
+    }
+
+#ifdef CACL_HAVE_EVENT_LOOP
+    // Wake up for grid rows even when no PV changes.
+    const double tick = so.gridNs > 0 ? so.gridNs / 1e9 : 0.1;
+    client.eventLoop().addTimer(tick, []() {}, tick);
+#endif
+
+    std::signal(SIGINT, onInterrupt);
+    std::signal(SIGTERM, onInterrupt);
+    client.run([&]() {
+        joiner.advance();
+        std::fflush(stdout);
+        return gInterrupted || (opt.monitorCount > 0 && printer.rows() >= opt.monitorCount);
+    }, opt.monitorDurationSec);
+
+    const caClientLib::SnapshotStats &s = joiner.stats();
+    if (s.outOfOrder > 0 || s.triggersDropped > 0) {
+        std::cerr << "Dropped " << s.outOfOrder << " out-of-order samples and " << s.triggersDropped
+                  << " trigger rows\n";
+    }
+    return true;
+}
+
+static bool cmdQuery(const Options &opt, const CaptureQuery &q)
+{
+    caClientLib::CaptureReader reader(q.path);
+
+    std::vector<std::uint32_t> ids;
+    if (!selectPvs(opt, reader, q.pvs, ids)) {
+        return false;
+    }
+
+    if (q.info) {
+        std::printf("%s: %llu samples, %zu PVs, ", q.path.c_str(), static_cast<unsigned long long>(reader.samples()),
+            reader.pvCount());
+        if (reader.samples() > 0) {
+            printNs(reader.firstNs());
+            std::printf(" .. ");
+            printNs(reader.lastNs());
+        }
+        std::printf("\n");
+        for (std::uint32_t id : ids) {
+            std::printf("  %s %llu\n", reader.pvName(id).c_str(), static_cast<unsigned long long>(reader.samples(id)));
+        }
+        return true;
+    }
+
+    std::int64_t fromNs;
+    std::int64_t toNs;
+    captureWindow(reader, q, fromNs, toNs);
+    const bool json = q.format == "json";
+    if (!q.format.empty() && q.format != "csv" && !json) {
+        std::cerr << "query supports --format csv or json\n";
+        return false;
+    }
+
+    if (q.binSec > 0.0) {
+        if (!json) {
+            std::printf("bin_start,pv,count,min,max,mean\n");
+        }
+        for (std::uint32_t id : ids) {
+            const char *pv = reader.pvName(id).c_str();
+            for (const caClientLib::CaptureBin &b :
+                 reader.bins(id, fromNs, toNs, static_cast<std::int64_t>(q.binSec * 1e9))) {
+                if (json) {
+                    std::printf("{\"bin_start\":");
+                }
+                printNs(b.startNs);
+                if (json) {
+                    std::printf(",\"pv\":\"%s\",\"count\":%llu,\"min\":%.15g,\"max\":%.15g,\"mean\":%.15g}\n", pv,
+                        static_cast<unsigned long long>(b.count), b.min, b.max, b.mean);
+                } else {
+                    std::printf(",%s,%llu,%.15g,%.15g,%.15g\n", pv, static_cast<unsigned long long>(b.count), b.min,
+                        b.max, b.mean);
+                }
+            }
+        }
+        return true;
+    }
+
+    if (!json) {
+        std::printf("time,pv,value,status,severity\n");
+    }
+    reader.scan(ids, fromNs, toNs, [&](std::uint32_t id, const caClientLib::CaptureSample &s) {
+        if (json) {
+            std::printf("{\"time\":");
+        }
+        printNs(s.ns);
+        if (json) {
+            std::printf(",\"pv\":\"%s\",\"value\":%.15g,\"status\":%d,\"severity\":%d}\n",
+                reader.pvName(id).c_str(), s.value, s.status, s.severity);
+        } else {
+            std::printf(",%s,%.15g,%d,%d\n", reader.pvName(id).c_str(), s.value, s.status, s.severity);
+        }
+        return true;
+    });
+    return true;
+}
+
+static bool cmdReplay(const Options &opt, const CaptureQuery &q)
+{
+    caClientLib::CaptureReader reader(q.path);
+
+    std::vector<std::uint32_t> ids;
+    if (!selectPvs(opt, reader, q.pvs, ids)) {
+        return false;
+    }
+
+    caClientLib::ReplayOptions ro;
+    ro.speed = q.speed;
+    captureWindow(reader, q, ro.fromNs, ro.toNs);
+
+    caClientApp::OutputFormat format = caClientApp::OutputFormat::Text;
+    if (!q.format.empty()) {
+        caClientApp::parseOutputFormat(q.format, format);
+    }
+
+    caClientApp::OutputWriter out;
+    caClientApp::UpdateFormatter formatter(out, format);
+    FormatHandler handler(formatter);
+    formatter.writeHeader();
+    reader.replay(ids, handler, ro);
+    return true;
+}
+
+// Parses "<file> [<pv> ...] [options]" for query/replay; returns false on error.
+static bool parseCaptureQuery(const std::vector<std::string> &args, size_t idx, CaptureQuery &q)
+{
+    while (idx < args.size()) {
+        const std::string &a = args[idx];
+        const bool hasValue = idx + 1 < args.size();
+        double d;
+        if ((a == "--from" || a == "--to" || a == "--bin" || a == "--speed") && hasValue) {
+            if (!parseDouble(args[idx + 1], d) || d < 0.0) {
+                std::cerr << "Invalid " << a << "\n";
+                return false;
+            }
+            if (a == "--from") {
+                q.fromSec = d;
+            } else if (a == "--to") {
+                q.toSec = d;
+            } else if (a == "--bin") {
+                q.binSec = d;
+            } else {
+                q.speed = d;
+            }
+            idx += 2;
+            continue;
+        }
+        if (a == "--format" && hasValue) {
+            q.format = args[idx + 1];
+            caClientApp::OutputFormat f;
+            if (!caClientApp::parseOutputFormat(q.format, f)) {
+                std::cerr << "Invalid --format\n";
+                return false;
+            }
+            idx += 2;
+            continue;
+        }
+        if (a == "--info") {
+            q.info = true;
+            idx++;
+            continue;
+        }
+        if (q.path.empty()) {
+            q.path = a;
+        } else {
+            q.pvs.push_back(a);
+        }
+        idx++;
+    }
+    return !q.path.empty();
 }
 
 static int run(int argc, char **argv)
@@ -189,12 +753,16 @@ static int run(int argc, char **argv)
 
     try {
         if (cmd == "get") {
-            if (idx + 1 != args.size()) {
+            if (idx >= args.size()) {
                 printUsage(argv[0]);
                 return 2;
             }
-            cmdGet(opt, args[idx]);
-            return 0;
+            if (idx + 1 == args.size()) {
+                cmdGet(opt, args[idx]);
+                return 0;
+            }
+            const std::vector<std::string> pvs(args.begin() + idx, args.end());
+            return cmdGetMany(opt, pvs) ? 0 : 2;
         }
 
         if (cmd == "put") {
@@ -207,13 +775,82 @@ static int run(int argc, char **argv)
         }
 
         if (cmd == "monitor") {
-            if (idx >= args.size()) {
+            std::vector<std::string> pvs;
+            std::vector<std::string> listed; // from --file/--subst, subject to --glob
+            std::string glob;
+            caClientApp::OutputFormat format = caClientApp::OutputFormat::Text;
+
+            while (idx < args.size()) {
+                if (args[idx] == "--duration" && idx + 1 < args.size()) {
+                    double d;
+                    if (!parseDouble(args[idx + 1], d) || d <= 0.0) {
+                        std::cerr << "Invalid --duration\n";
+                        return 2;
+                    }
+                    opt.monitorDurationSec = d;
+                    idx += 2;
+                    continue;
+                }
+                if (args[idx] == "--count" && idx + 1 < args.size()) {
+                    int c;
+                    if (!parseInt(args[idx + 1], c) || c <= 0) {
+                        std::cerr << "Invalid --count\n";
+                        return 2;
+                    }
+                    opt.monitorCount = c;
+                    idx += 2;
+                    continue;
+                }
+                if (args[idx] == "--format" && idx + 1 < args.size()) {
+                    if (!caClientApp::parseOutputFormat(args[idx + 1], format)) {
+                        std::cerr << "Invalid --format\n";
+                        return 2;
+                    }
+                    idx += 2;
+                    continue;
+                }
+                if (args[idx] == "--file" && idx + 1 < args.size()) {
+                    const std::vector<std::string> names = caClientApp::readPvListFile(args[idx + 1]);
+                    listed.insert(listed.end(), names.begin(), names.end());
+                    idx += 2;
+                    continue;
+                }
+                if (args[idx] == "--subst" && idx + 1 < args.size()) {
+                    const std::vector<std::string> names = caClientApp::expandSubstitutions(args[idx + 1]);
+                    listed.insert(listed.end(), names.begin(), names.end());
+                    idx += 2;
+                    continue;
+                }
+                if (args[idx] == "--glob" && idx + 1 < args.size()) {
+                    glob = args[idx + 1];
+                    idx += 2;
+                    continue;
+                }
+                if (args[idx].rfind("--", 0) == 0) {
+                    std::cerr << "Unknown option: " << args[idx] << "\n";
+                    return 2;
+                }
+                pvs.push_back(args[idx++]);
+            }
+
+            if (!glob.empty()) {
+                if (listed.empty()) {
+                    std::cerr << "--glob needs --subst or --file\n";
+                    return 2;
+                }
+                listed = caClientApp::filterGlob(listed, fullPvName(opt, glob));
+            }
+            pvs.insert(pvs.end(), listed.begin(), listed.end());
+            if (pvs.empty()) {
                 printUsage(argv[0]);
                 return 2;
             }
 
-            const std::string pv = args[idx++];
+            return cmdMonitor(opt, pvs, format) ? 0 : 2;
+        }
 
+        if (cmd == "record") {
+            std::vector<std::string> pvs;
             while (idx < args.size()) {
                 if (args[idx] == "--duration" && idx + 1 < args.size()) {
                     double d;
@@ -235,15 +872,213 @@ static int run(int argc, char **argv)
                     idx += 2;
                     continue;
                 }
+                pvs.push_back(args[idx++]);
+            }
+            if (pvs.size() < 2) {
+                printUsage(argv[0]);
+                return 2;
+            }
+            const std::string path = pvs.front();
+            pvs.erase(pvs.begin());
+            cmdRecord(opt, path, pvs);
+            return 0;
+        }
 
-                std::cerr << "Unknown option: " << args[idx] << "\n";
+        if (cmd == "query" || cmd == "replay") {
+            CaptureQuery q;
+            if (!parseCaptureQuery(args, idx, q)) {
+                printUsage(argv[0]);
                 return 2;
             }
+            return (cmd == "query" ? cmdQuery(opt, q) : cmdReplay(opt, q)) ? 0 : 2;
+        }
 
-            cmdMonitor(opt, pv);
+        if (cmd == "publish") {
+            std::vector<std::string> pvs;
+            std::size_t capacity = 1024;
+            while (idx < args.size()) {
+                if (args[idx] == "--capacity" && idx + 1 < args.size()) {
+                    int n;
+                    if (!parseInt(args[idx + 1], n) || n <= 0) {
+                        std::cerr << "Invalid --capacity\n";
+                        return 2;
+                    }
+                    capacity = static_cast<std::size_t>(n);
+                    idx += 2;
+                    continue;
+                }
+                if (args[idx] == "--duration" && idx + 1 < args.size()) {
+                    double d;
+                    if (!parseDouble(args[idx + 1], d) || d <= 0.0) {
+                        std::cerr << "Invalid --duration\n";
+                        return 2;
+                    }
+                    opt.monitorDurationSec = d;
+                    idx += 2;
+                    continue;
+                }
+                pvs.push_back(args[idx++]);
+            }
+            if (pvs.empty()) {
+                printUsage(argv[0]);
+                return 2;
+            }
+            cmdPublish(opt, pvs, capacity);
             return 0;
         }
 
+        if (cmd == "shm") {
+            std::vector<std::string> pvs;
+            bool follow = false;
+            caClientApp::OutputFormat format = caClientApp::OutputFormat::Text;
+            while (idx < args.size()) {
+                if (args[idx] == "--follow") {
+                    follow = true;
+                    idx++;
+                    continue;
+                }
+                if (args[idx] == "--duration" && idx + 1 < args.size()) {
+                    double d;
+                    if (!parseDouble(args[idx + 1], d) || d <= 0.0) {
+                        std::cerr << "Invalid --duration\n";
+                        return 2;
+                    }
+                    opt.monitorDurationSec = d;
+                    idx += 2;
+                    continue;
+                }
+                if (args[idx] == "--format" && idx + 1 < args.size()) {
+                    if (!caClientApp::parseOutputFormat(args[idx + 1], format)) {
+                        std::cerr << "Invalid --format\n";
+                        return 2;
+                    }
+                    idx += 2;
+                    continue;
+                }
+                pvs.push_back(args[idx++]);
+            }
+            if (pvs.empty()) {
+                printUsage(argv[0]);
+                return 2;
+            }
+            return cmdShm(opt, pvs, follow, format) ? 0 : 2;
+        }
+
+        if (cmd == "snapshot") {
+            std::vector<std::string> pvs;
+            std::string trigger;
+            caClientLib::SnapshotOptions so;
+            bool json = false;
+            while (idx < args.size()) {
+                const std::string &a = args[idx];
+                const bool hasValue = idx + 1 < args.size();
+                double d;
+                if ((a == "--every" || a == "--tolerance" || a == "--lag" || a == "--duration") && hasValue) {
+                    if (!parseDouble(args[idx + 1], d) || d <= 0.0) {
+                        std::cerr << "Invalid " << a << "\n";
+                        return 2;
+                    }
+                    const std::int64_t ns = static_cast<std::int64_t>(d * 1e9);
+                    if (a == "--every") {
+                        so.gridNs = ns;
+                    } else if (a == "--tolerance") {
+                        so.toleranceNs = ns;
+                    } else if (a == "--lag") {
+                        so.lagNs = ns;
+                    } else {
+                        opt.monitorDurationSec = d;
+                    }
+                    idx += 2;
+                    continue;
+                }
+                if ((a == "--depth" || a == "--count") && hasValue) {
+                    int n;
+                    if (!parseInt(args[idx + 1], n) || n <= 0) {
+                        std::cerr << "Invalid " << a << "\n";
+                        return 2;
+                    }
+                    if (a == "--depth") {
+                        so.depth = static_cast<std::size_t>(n);
+                    } else {
+                        opt.monitorCount = n;
+                    }
+                    idx += 2;
+                    continue;
+                }
+                if (a == "--mode" && hasValue) {
+                    const std::string &m = args[idx + 1];
+                    if (m == "before") {
+                        so.mode = caClientLib::JoinMode::NearestBefore;
+                    } else if (m == "exact") {
+                        so.mode = caClientLib::JoinMode::Exact;
+                    } else if (m == "interp") {
+                        so.mode = caClientLib::JoinMode::Interpolate;
+                    } else {
+                        std::cerr << "Invalid --mode\n";
+                        return 2;
+                    }
+                    idx += 2;
+                    continue;
+                }
+                if (a == "--trigger" && hasValue) {
+                    trigger = args[idx + 1];
+                    idx += 2;
+                    continue;
+                }
+                if (a == "--format" && hasValue) {
+                    if (args[idx + 1] != "csv" && args[idx + 1] != "json") {
+                        std::cerr << "snapshot supports --format csv or json\n";
+                        return 2;
+                    }
+                    json = args[idx + 1] == "json";
+                    idx += 2;
+                    continue;
+                }
+                if (a.rfind("--", 0) == 0) {
+                    std::cerr << "Unknown option: " << a << "\n";
+                    return 2;
+                }
+                pvs.push_back(args[idx++]);
+            }
+            if ((pvs.empty() && trigger.empty()) || (so.gridNs <= 0 && trigger.empty())) {
+                printUsage(argv[0]);
+                return 2;
+            }
+            return cmdSnapshot(opt, pvs, trigger, so, json) ? 0 : 2;
+        }
+
+        if (cmd == "stats") {
+            std::vector<std::string> pvs;
+            while (idx < args.size()) {
+                if (args[idx] == "--rounds" && idx + 1 < args.size()) {
+                    int n;
+                    if (!parseInt(args[idx + 1], n) || n < 0) {
+                        std::cerr << "Invalid --rounds\n";
+                        return 2;
+                    }
+                    opt.statsRounds = n;
+                    idx += 2;
+                    continue;
+                }
+                if (args[idx] == "--duration" && idx + 1 < args.size()) {
+                    double d;
+                    if (!parseDouble(args[idx + 1], d) || d < 0.0) {
+                        std::cerr << "Invalid --duration\n";
+                        return 2;
+                    }
+                    opt.monitorDurationSec = d;
+                    idx += 2;
+                    continue;
+                }
+                pvs.push_back(args[idx++]);
+            }
+            if (pvs.empty()) {
+                printUsage(argv[0]);
+                return 2;
+            }
+            return cmdStats(opt, pvs) ? 0 : 2;
+        }
+
         printUsage(argv[0]);
         return 2;
     } catch (const std::exception &e) {
@@ -0,0 +1,98 @@
+// Runs the sequence CaCoroutine.h was written for, on one thread:
+//   put <prefix>period, wait for <prefix>period:rb to match, read <prefix>ai0:mean.
+// --count N starts N copies at once to show they share the event loop.
+// Needs a running IOC serving the PVs (e.g. iocBoot/iocEspCmd).
+
+#include "caClientLib/CaCoroutine.h"
+
+#ifndef CACL_HAVE_COROUTINES
+#error "coSequence needs C++20 coroutines and the epoll event loop"
+#endif
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+
+namespace {
+
+using namespace caClientLib;
+
+struct Options {
+    std::string prefix = "ESP:";
+    double period = 0.5;
+    unsigned long count = 1;
+    double timeoutSec = 5.0;
+};
+
+void usage(const char *argv0)
+{
+    std::fprintf(stderr, "Usage: %s [--prefix P] [--period SEC] [--count N] [--timeout SEC]\n", argv0);
+}
+
+CaTask<void> sequence(CaCoScope &scope, const Options &opt, unsigned long id)
+{
+    CaCoChannel set = co_await scope.connect(opt.prefix + "period", opt.timeoutSec);
+    CaCoChannel rb = co_await scope.connect(opt.prefix + "period:rb", opt.timeoutSec);
+    CaCoChannel mean = co_await scope.connect(opt.prefix + "ai0:mean", opt.timeoutSec);
+    CaCoMonitor<double> readback(rb);
+
+    co_await set.put(opt.period, opt.timeoutSec);
+    // period:rb is derived from the device's microsecond count.
+    while (std::fabs((co_await readback.next(opt.timeoutSec)).value - opt.period) > 1e-6) {
+    }
+
+    const TimedValue<double> v = co_await mean.getTimed<double>(opt.timeoutSec);
+    if (opt.count == 1 || id == 0) {
+        std::printf("%sai0:mean = %g (severity %d)\n", opt.prefix.c_str(), v.value, v.alarmSeverity);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        const bool more = i + 1 < argc;
+        if (std::strcmp(argv[i], "--prefix") == 0 && more) {
+            opt.prefix = argv[++i];
+        } else if (std::strcmp(argv[i], "--period") == 0 && more) {
+            opt.period = std::strtod(argv[++i], 0);
+        } else if (std::strcmp(argv[i], "--count") == 0 && more) {
+            opt.count = std::strtoul(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--timeout") == 0 && more) {
+            opt.timeoutSec = std::strtod(argv[++i], 0);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (opt.count == 0 || opt.period <= 0.0 || opt.timeoutSec <= 0.0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    try {
+        CaClient client;
+        CaCoScope scope(client);
+
+        const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (unsigned long i = 0; i < opt.count; i++) {
+            scope.spawn(sequence(scope, opt, i));
+        }
+        client.run([&]() { return scope.idle(); }, 4.0 * opt.timeoutSec);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        std::printf("%lu sequence(s) in %.3f s, %zu failed, %zu unfinished\n", opt.count, seconds, scope.failures(),
+                    scope.active());
+        scope.rethrow();
+        return scope.active() == 0 ? 0 : 1;
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "coSequence: %s\n", e.what());
+        return 1;
+    }
+}
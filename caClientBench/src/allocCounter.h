@@ -0,0 +1,8 @@
+#ifndef CACL_BENCH_ALLOC_COUNTER_H
+#define CACL_BENCH_ALLOC_COUNTER_H
+
+// Global operator new/new[] replacements in allocCounter.cpp count every heap
+// allocation made by the process; link that file into a benchmark to use it.
+unsigned long long allocationCount();
+
+#endif
@@ -0,0 +1,403 @@
+// End-to-end benchmark for caClientLib against a local softIoc. Generates a
+// database of N scalar (ao) and N waveform PVs, starts softIoc on it and
+// measures gets/puts/monitor events per second, p50/p99 latency and heap
+// allocations per operation for string and native types, single and batched
+// access, at each requested PV count. Results are written as JSON.
+
+#include "caClientLib/CaClient.h"
+#include "caClientLib/LatencyHistogram.h"
+
+#include "allocCounter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef CACL_SOFTIOC
+#define CACL_SOFTIOC "softIoc"
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    std::string softIoc = CACL_SOFTIOC;
+    std::vector<unsigned> pvCounts = {1, 10, 100};
+    unsigned long ops = 2000;
+    unsigned long nelm = 1024;
+    double monitorSec = 2.0;
+    double timeoutSec = 5.0;
+    std::string outPath; // empty = stdout
+    bool verbose = false;
+};
+
+struct CaseResult {
+    std::string name;
+    std::string type;
+    std::string mode;
+    unsigned pvs = 0;
+    unsigned long long ops = 0;
+    double seconds = 0.0;
+    caClientLib::LatencySummary latency;
+    unsigned long long allocations = 0;
+};
+
+static void printUsage(const char *prog)
+{
+    std::fprintf(stderr,
+        "Usage: %s [--softioc PATH] [--pvs N,N,...] [--ops N] [--nelm N]\n"
+        "          [--monitor-sec SEC] [--timeout SEC] [--out FILE] [--verbose]\n",
+        prog);
+}
+
+static bool parseCounts(const std::string &s, std::vector<unsigned> &out)
+{
+    out.clear();
+    const char *p = s.c_str();
+    while (*p) {
+        char *end = nullptr;
+        const unsigned long v = std::strtoul(p, &end, 10);
+        if (end == p || v == 0 || (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        out.push_back(static_cast<unsigned>(v));
+        p = *end ? end + 1 : end;
+    }
+    return !out.empty();
+}
+
+static std::string scalarPv(const std::string &prefix, unsigned i)
+{
+    return prefix + "s" + std::to_string(i);
+}
+
+static std::string waveformPv(const std::string &prefix, unsigned i)
+{
+    return prefix + "w" + std::to_string(i);
+}
+
+// softIoc child process serving a generated database; killed on destruction.
+class SoftIoc {
+public:
+    SoftIoc(const Options &opt, const std::string &prefix, unsigned count) : pid_(-1)
+    {
+        char path[] = "/tmp/caClientBench-XXXXXX.db";
+        const int fd = mkstemps(path, 3);
+        if (fd < 0) {
+            throw std::runtime_error("mkstemps failed");
+        }
+        dbPath_ = path;
+
+        FILE *f = fdopen(fd, "w");
+        for (unsigned i = 0; i < count; i++) {
+            std::fprintf(f, "record(ao, \"%s\") {\n    field(PREC, \"3\")\n}\n", scalarPv(prefix, i).c_str());
+            std::fprintf(f, "record(waveform, \"%s\") {\n    field(FTVL, \"DOUBLE\")\n    field(NELM, \"%lu\")\n}\n",
+                waveformPv(prefix, i).c_str(), opt.nelm);
+        }
+        std::fclose(f);
+
+        pid_ = fork();
+        if (pid_ < 0) {
+            std::remove(dbPath_.c_str());
+            throw std::runtime_error("fork failed");
+        }
+        if (pid_ == 0) {
+            if (!opt.verbose) {
+                const int devNull = open("/dev/null", O_RDWR);
+                if (devNull >= 0) {
+                    dup2(devNull, STDIN_FILENO);
+                    dup2(devNull, STDOUT_FILENO);
+                    dup2(devNull, STDERR_FILENO);
+                }
+            }
+            // -S: no interactive shell, so the IOC keeps running with stdin closed.
+            execlp(opt.softIoc.c_str(), opt.softIoc.c_str(), "-S", "-d", dbPath_.c_str(), (char *)0);
+            _exit(127);
+        }
+    }
+
+    ~SoftIoc()
+    {
+        if (pid_ > 0) {
+            kill(pid_, SIGTERM);
+            waitpid(pid_, 0, 0);
+        }
+        std::remove(dbPath_.c_str());
+    }
+
+    SoftIoc(const SoftIoc &) = delete;
+    SoftIoc &operator=(const SoftIoc &) = delete;
+
+    bool running()
+    {
+        return pid_ > 0 && waitpid(pid_, 0, WNOHANG) == 0;
+    }
+
+private:
+    pid_t pid_;
+    std::string dbPath_;
+};
+
+template <typename Op>
+static CaseResult measureOps(const char *name, const char *type, const char *mode, unsigned pvs,
+                             unsigned long ops, unsigned long perOp, Op op)
+{
+    caClientLib::LatencyHistogram h;
+
+    const unsigned long long a0 = allocationCount();
+    const Clock::time_point t0 = Clock::now();
+    for (unsigned long i = 0; i < ops; i++) {
+        const Clock::time_point s = Clock::now();
+        op(i);
+        h.record(static_cast<unsigned long long>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - s).count()));
+    }
+    const Clock::time_point t1 = Clock::now();
+
+    CaseResult r;
+    r.name = name;
+    r.type = type;
+    r.mode = mode;
+    r.pvs = pvs;
+    r.ops = static_cast<unsigned long long>(ops) * perOp;
+    r.seconds = std::chrono::duration<double>(t1 - t0).count();
+    r.latency = h.summary();
+    r.allocations = allocationCount() - a0;
+    return r;
+}
+
+class CountingHandler final : public caClientLib::ITypedMonitorHandler<double> {
+public:
+    void onUpdate(const caClientLib::TypedUpdate<double> &) override { ++seen_; }
+
+    unsigned long long seen() const { return seen_; }
+    void reset() { seen_ = 0; }
+
+private:
+    unsigned long long seen_ = 0;
+};
+
+static void waitForIoc(caClientLib::CaClient &client, SoftIoc &ioc, const std::string &pv, double timeoutSec)
+{
+    const Clock::time_point end = Clock::now() + std::chrono::seconds(10);
+    while (!client.tryGetString(pv, timeoutSec < 1.0 ? timeoutSec : 1.0)) {
+        if (!ioc.running()) {
+            throw std::runtime_error("softIoc exited during startup (check --softioc)");
+        }
+        if (Clock::now() >= end) {
+            throw std::runtime_error("timed out waiting for softIoc PVs");
+        }
+    }
+}
+
+static void runCases(const Options &opt, caClientLib::CaClient &client, const std::string &prefix, unsigned n,
+                     std::vector<CaseResult> &results)
+{
+    const double tmo = opt.timeoutSec;
+
+    std::vector<std::string> scalars;
+    std::vector<std::string> waveforms;
+    for (unsigned i = 0; i < n; i++) {
+        scalars.push_back(scalarPv(prefix, i));
+        waveforms.push_back(waveformPv(prefix, i));
+    }
+
+    // Connect everything and fill the waveforms outside the timed regions.
+    const std::vector<double> fill(opt.nelm, 1.5);
+    for (unsigned i = 0; i < n; i++) {
+        client.put<double>(scalars[i], static_cast<double>(i), tmo);
+        client.channelCache().acquire(waveforms[i], tmo)->putArray<double>(fill.data(), fill.size(), tmo);
+    }
+
+    results.push_back(measureOps("get", "string", "single", n, opt.ops, 1, [&](unsigned long i) {
+        client.getString(scalars[i % n], tmo);
+    }));
+    results.push_back(measureOps("get", "double", "single", n, opt.ops, 1, [&](unsigned long i) {
+        client.get<double>(scalars[i % n], tmo);
+    }));
+    results.push_back(measureOps("put", "string", "single", n, opt.ops, 1, [&](unsigned long i) {
+        client.putString(scalars[i % n], "1.5", tmo);
+    }));
+    results.push_back(measureOps("put", "double", "single", n, opt.ops, 1, [&](unsigned long i) {
+        client.put<double>(scalars[i % n], static_cast<double>(i), tmo);
+    }));
+    results.push_back(measureOps("get", "double_array", "single", n, opt.ops, 1, [&](unsigned long i) {
+        client.getArray<double>(waveforms[i % n], tmo);
+    }));
+
+    // Batched: one round trip per op covering all n PVs.
+    const unsigned long batches = opt.ops / n > 0 ? opt.ops / n : 1;
+    results.push_back(measureOps("get", "string", "batch", n, batches, n, [&](unsigned long) {
+        client.getStrings(scalars, tmo);
+    }));
+    results.push_back(measureOps("get", "double", "batch", n, batches, n, [&](unsigned long) {
+        unsigned done = 0;
+        for (const std::string &pv : scalars) {
+            client.getAsync<double>(pv, tmo, [&done](int, const caClientLib::TimedValue<double> &) { ++done; });
+        }
+        client.run([&]() { return done == n; }, tmo);
+    }));
+    results.push_back(measureOps("put", "double", "batch", n, batches, n, [&](unsigned long i) {
+        unsigned done = 0;
+        for (const std::string &pv : scalars) {
+            client.putAsync<double>(pv, static_cast<double>(i), tmo, [&done](int) { ++done; });
+        }
+        client.run([&]() { return done == n; }, tmo);
+    }));
+
+    // Monitor events: subscribe to every scalar, then keep all of them busy
+    // with async put bursts and count the delivered events.
+    CountingHandler handler;
+    std::vector<std::unique_ptr<caClientLib::CaTypedMonitor<double>>> monitors;
+    for (const std::string &pv : scalars) {
+        monitors.push_back(client.monitor<double>(pv, tmo, handler));
+    }
+    client.run([&]() { return handler.seen() >= n; }, tmo); // initial values
+    handler.reset();
+    client.resetStats();
+
+    const unsigned long long a0 = allocationCount();
+    const Clock::time_point t0 = Clock::now();
+    const Clock::time_point end = t0 + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(opt.monitorSec));
+    double value = 0.0;
+    while (Clock::now() < end) {
+        unsigned done = 0;
+        value += 1.0;
+        for (const std::string &pv : scalars) {
+            client.putAsync<double>(pv, value, tmo, [&done](int) { ++done; });
+        }
+        client.run([&]() { return done == n; }, tmo);
+    }
+    client.run(std::function<bool()>(), 0.1); // drain events still in flight
+    const Clock::time_point t1 = Clock::now();
+
+    CaseResult r;
+    r.name = "monitor";
+    r.type = "double";
+    r.mode = "events";
+    r.pvs = n;
+    r.ops = handler.seen();
+    r.seconds = std::chrono::duration<double>(t1 - t0).count();
+    r.latency = client.stats().monitorLag;
+    r.allocations = allocationCount() - a0;
+    results.push_back(r);
+}
+
+static void writeJson(FILE *out, const Options &opt, const std::vector<CaseResult> &results)
+{
+    std::fprintf(out, "{\n  \"bench\": \"caClientBench\",\n  \"ops\": %lu,\n  \"nelm\": %lu,\n  \"results\": [\n",
+        opt.ops, opt.nelm);
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const CaseResult &r = results[i];
+        const double perSec = r.seconds > 0.0 ? static_cast<double>(r.ops) / r.seconds : 0.0;
+        const double allocs = r.ops > 0 ? static_cast<double>(r.allocations) / static_cast<double>(r.ops) : 0.0;
+        std::fprintf(out,
+            "    {\"case\": \"%s\", \"type\": \"%s\", \"mode\": \"%s\", \"pvs\": %u, \"ops\": %llu, "
+            "\"seconds\": %.6f, \"ops_per_sec\": %.1f, \"p50_us\": %.3f, \"p99_us\": %.3f, "
+            "\"max_us\": %.3f, \"allocs_per_op\": %.3f}%s\n",
+            r.name.c_str(), r.type.c_str(), r.mode.c_str(), r.pvs, r.ops, r.seconds, perSec,
+            r.latency.p50Ns / 1e3, r.latency.p99Ns / 1e3, r.latency.maxNs / 1e3, allocs,
+            i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+static int run(int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        const std::string a(argv[i]);
+        const bool hasValue = i + 1 < argc;
+        if (a == "--softioc" && hasValue) {
+            opt.softIoc = argv[++i];
+        } else if (a == "--pvs" && hasValue) {
+            if (!parseCounts(argv[++i], opt.pvCounts)) {
+                std::fprintf(stderr, "Invalid --pvs\n");
+                return 2;
+            }
+        } else if (a == "--ops" && hasValue) {
+            opt.ops = std::strtoul(argv[++i], 0, 10);
+        } else if (a == "--nelm" && hasValue) {
+            opt.nelm = std::strtoul(argv[++i], 0, 10);
+        } else if (a == "--monitor-sec" && hasValue) {
+            opt.monitorSec = std::strtod(argv[++i], 0);
+        } else if (a == "--timeout" && hasValue) {
+            opt.timeoutSec = std::strtod(argv[++i], 0);
+        } else if (a == "--out" && hasValue) {
+            opt.outPath = argv[++i];
+        } else if (a == "--verbose") {
+            opt.verbose = true;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (opt.ops == 0 || opt.nelm == 0 || opt.timeoutSec <= 0.0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    // Keep searches on this host unless the user configured CA explicitly.
+    if (!std::getenv("EPICS_CA_ADDR_LIST")) {
+        setenv("EPICS_CA_ADDR_LIST", "127.0.0.1", 1);
+        setenv("EPICS_CA_AUTO_ADDR_LIST", "NO", 1);
+    }
+
+    unsigned maxPvs = 0;
+    for (unsigned c : opt.pvCounts) {
+        maxPvs = c > maxPvs ? c : maxPvs;
+    }
+
+    const std::string prefix = "BENCH" + std::to_string(static_cast<long>(getpid())) + ":";
+    std::vector<CaseResult> results;
+
+    try {
+        SoftIoc ioc(opt, prefix, maxPvs);
+        caClientLib::ChannelCacheOptions cacheOpt;
+        cacheOpt.capacity = 2 * maxPvs + 16;
+        caClientLib::CaClient client(cacheOpt);
+
+        waitForIoc(client, ioc, scalarPv(prefix, 0), opt.timeoutSec);
+        for (unsigned n : opt.pvCounts) {
+            runCases(opt, client, prefix, n, results);
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (!opt.outPath.empty()) {
+        out = std::fopen(opt.outPath.c_str(), "w");
+        if (!out) {
+            std::fprintf(stderr, "Error: cannot open %s\n", opt.outPath.c_str());
+            return 1;
+        }
+    }
+    writeJson(out, opt, results);
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    return run(argc, argv);
+}
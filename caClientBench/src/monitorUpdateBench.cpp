@@ -0,0 +1,122 @@
+// Micro-benchmark for the monitor delivery path: converts synthetic
+// DBR_TIME_STRING events into MonitorUpdates and hands them on, counting
+// heap allocations per delivered update. No IOC is needed.
+
+#include "caClientLib/CaMonitor.h"
+#include "caClientLib/MonitorUpdatePool.h"
+#include "caClientLib/BoundedRing.h"
+
+#include "allocCounter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+using caClientLib::MonitorUpdate;
+
+class CountingHandler final : public caClientLib::IMonitorHandler {
+public:
+    void onUpdate(const MonitorUpdate &u) override
+    {
+        bytes_ += u.value.size() + u.pvName.size();
+        ++seen_;
+    }
+
+    unsigned long long seen() const { return seen_; }
+
+private:
+    unsigned long long seen_ = 0;
+    unsigned long long bytes_ = 0;
+};
+
+struct Result {
+    unsigned long long updates;
+    unsigned long long allocations;
+    double seconds;
+};
+
+static void report(const char *name, const Result &r)
+{
+    std::printf("%-24s %10llu updates %8.1f ns/update %8llu allocs (%.3f/update)\n",
+                name, r.updates, r.seconds * 1e9 / static_cast<double>(r.updates),
+                r.allocations, static_cast<double>(r.allocations) / static_cast<double>(r.updates));
+}
+
+static void makeEvent(dbr_time_string &v, unsigned long i)
+{
+    std::memset(&v, 0, sizeof(v));
+    std::snprintf(v.value, sizeof(v.value), "%lu.%03lu", i / 1000, i % 1000);
+    v.stamp.secPastEpoch = static_cast<epicsUInt32>(1000000000u + i / 1000);
+    v.stamp.nsec = static_cast<epicsUInt32>((i % 1000) * 1000000u);
+}
+
+template <typename Body>
+static Result measure(unsigned long n, Body body)
+{
+    const unsigned long long a0 = allocationCount();
+    const auto t0 = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < n; i++) {
+        body(i);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    Result r;
+    r.updates = n;
+    r.allocations = allocationCount() - a0;
+    r.seconds = std::chrono::duration<double>(t1 - t0).count();
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned long n = 1000000;
+    if (argc >= 2) {
+        n = std::strtoul(argv[1], 0, 10);
+        if (n == 0) {
+            std::fprintf(stderr, "Usage: %s [updates]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const std::string pvName = "ESP:ai0:mean";
+    dbr_time_string ev;
+    makeEvent(ev, 0);
+
+    // What CaMonitor::callback does per event.
+    CountingHandler handler;
+    report("CaMonitor delivery", measure(n, [&](unsigned long i) {
+        ev.stamp.nsec = static_cast<epicsUInt32>(i);
+        MonitorUpdate u;
+        caClientLib::fillMonitorUpdate(pvName, ev, u);
+        handler.onUpdate(u);
+    }));
+
+    // What MonitorHub does per event: CA thread push, consumer thread pop.
+    caClientLib::BoundedRing<MonitorUpdate> ring(1024);
+    report("MonitorHub handoff", measure(n, [&](unsigned long i) {
+        ev.stamp.nsec = static_cast<epicsUInt32>(i);
+        MonitorUpdate u;
+        caClientLib::fillMonitorUpdate(pvName, ev, u);
+        ring.tryPush(u);
+        MonitorUpdate out;
+        ring.tryPop(out);
+        handler.onUpdate(out);
+    }));
+
+    // Handlers that keep updates: retain into the pool, release later.
+    caClientLib::MonitorUpdatePool pool(64);
+    report("pooled retain/release", measure(n, [&](unsigned long i) {
+        ev.stamp.nsec = static_cast<epicsUInt32>(i);
+        MonitorUpdate u;
+        caClientLib::fillMonitorUpdate(pvName, ev, u);
+        caClientLib::MonitorUpdatePool::Handle kept = pool.retain(u);
+        handler.onUpdate(kept->view());
+    }));
+
+    return handler.seen() == 3ull * n ? 0 : 1;
+}
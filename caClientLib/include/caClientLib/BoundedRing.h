@@ -0,0 +1,106 @@
+#ifndef CACL_BOUNDED_RING_H
+#define CACL_BOUNDED_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace caClientLib {
+
+// Bounded lock-free queue (D. Vyukov's sequence-numbered ring). Any thread
+// may push or pop; producers also pop to implement drop-oldest overflow.
+// Capacity is rounded up to a power of two. Neither call blocks: tryPush()
+// fails when the ring is full, tryPop() when it is empty.
+template <typename T>
+class BoundedRing {
+public:
+    explicit BoundedRing(std::size_t capacity)
+        : mask_(roundUp(capacity) - 1), cells_(new Cell[mask_ + 1]), head_(0), tail_(0)
+    {
+        for (std::size_t i = 0; i <= mask_; i++) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedRing(const BoundedRing &) = delete;
+    BoundedRing &operator=(const BoundedRing &) = delete;
+
+    template <typename U>
+    bool tryPush(U &&value)
+    {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[pos & mask_];
+            const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::forward<U>(value);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T &out)
+    {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[pos & mask_];
+            const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.value);
+                    cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate while producers are active.
+    std::size_t size() const
+    {
+        const std::size_t t = tail_.load(std::memory_order_relaxed);
+        const std::size_t h = head_.load(std::memory_order_relaxed);
+        return t >= h ? t - h : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+    std::size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> seq;
+        T value;
+    };
+
+    static std::size_t roundUp(std::size_t n)
+    {
+        std::size_t p = 2;
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    const std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<std::size_t> head_;
+    alignas(64) std::atomic<std::size_t> tail_;
+};
+
+} // namespace caClientLib
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef CACL_CA_ARRAY_MONITOR_H
+#define CACL_CA_ARRAY_MONITOR_H
+
+#include "caClientLib/CaLatencyStats.h"
+#include "caClientLib/CaStatus.h"
+#include "caClientLib/DbrTraits.h"
+
+#include <cadef.h>
+#include <epicsTime.h>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace caClientLib {
+
+// Read-only, non-owning view over contiguous elements (a minimal span).
+template <typename T>
+class ArrayView {
+public:
+    ArrayView() : data_(0), size_(0) {}
+    ArrayView(const T *data, std::size_t size) : data_(data), size_(size) {}
+
+    const T *data() const { return data_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T &operator[](std::size_t i) const { return data_[i]; }
+    const T *begin() const { return data_; }
+    const T *end() const { return data_ + size_; }
+
+private:
+    const T *data_;
+    std::size_t size_;
+};
+
+template <typename T>
+struct ArrayUpdate {
+    std::string_view pvName;
+    ArrayView<T> values; // points into CA's receive buffer: valid only during onUpdate()
+    short alarmStatus = 0;
+    short alarmSeverity = 0;
+    epicsTimeStamp ts{};
+};
+
+template <typename T>
+class IArrayMonitorHandler {
+public:
+    virtual ~IArrayMonitorHandler() = default;
+    virtual void onUpdate(const ArrayUpdate<T> &u) = 0;
+};
+
+// Opt-in copies of array views into recycled vectors, for handlers that need
+// the data after onUpdate() returns. Steady state reuses capacity instead
+// of allocating. Buffers may be released from any thread; the pool must
+// outlive them.
+template <typename T>
+class ArrayBufferPool {
+public:
+    struct Recycler {
+        ArrayBufferPool *pool;
+        void operator()(std::vector<T> *buf) const { pool->recycle(buf); }
+    };
+    typedef std::unique_ptr<std::vector<T>, Recycler> Buffer;
+
+    explicit ArrayBufferPool(std::size_t maxFree = 16) : maxFree_(maxFree) {}
+    ~ArrayBufferPool()
+    {
+        for (std::vector<T> *buf : free_) {
+            delete buf;
+        }
+    }
+
+    ArrayBufferPool(const ArrayBufferPool &) = delete;
+    ArrayBufferPool &operator=(const ArrayBufferPool &) = delete;
+
+    Buffer copy(const ArrayView<T> &view)
+    {
+        std::vector<T> *buf = 0;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (!free_.empty()) {
+                buf = free_.back();
+                free_.pop_back();
+            }
+        }
+        if (!buf) {
+            buf = new std::vector<T>;
+        }
+        buf->assign(view.begin(), view.end());
+        return Buffer(buf, Recycler{this});
+    }
+
+private:
+    void recycle(std::vector<T> *buf)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (free_.size() < maxFree_) {
+                free_.push_back(buf);
+                return;
+            }
+        }
+        delete buf;
+    }
+
+    const std::size_t maxFree_;
+    std::mutex lock_;
+    std::vector<std::vector<T> *> free_;
+};
+
+// Waveform monitor delivering native arrays (DBR_TIME_DOUBLE,
+// DBR_TIME_SHORT, ...) as views over CA's buffer, without per-element
+// copies or string conversion. count == 0 subscribes to the channel's
+// native element count (ca_element_count).
+template <typename T>
+class CaArrayMonitor {
+public:
+    CaArrayMonitor(const std::string &pvName, double timeoutSec, IArrayMonitorHandler<T> &handler,
+                   unsigned long count = 0, long mask = DBE_VALUE | DBE_ALARM);
+    ~CaArrayMonitor();
+
+    CaArrayMonitor(const CaArrayMonitor &) = delete;
+    CaArrayMonitor &operator=(const CaArrayMonitor &) = delete;
+
+    const std::string &pvName() const { return pvName_; }
+    unsigned long elementCount() const { return count_; }
+
+private:
+    static void callback(struct event_handler_args args);
+
+    std::string pvName_;
+    chid chid_;
+    evid evid_;
+    unsigned long count_;
+    IArrayMonitorHandler<T> *handler_;
+};
+
+template <typename T>
+CaArrayMonitor<T>::CaArrayMonitor(const std::string &pvName, double timeoutSec,
+                                  IArrayMonitorHandler<T> &handler, unsigned long count, long mask)
+    : pvName_(pvName), chid_(0), evid_(0), count_(0), handler_(&handler)
+{
+    int st = ca_create_channel(pvName_.c_str(), 0, 0, CA_PRIORITY_DEFAULT, &chid_);
+    CaStatus::requireOk(st, "ca_create_channel");
+
+    st = CaStatus::connectStatus(ca_pend_io(timeoutSec), chid_);
+    if (st != ECA_NORMAL) {
+        ca_clear_channel(chid_);
+        chid_ = 0;
+    }
+    CaStatus::requireOk(st, "ca_pend_io (connect)");
+
+    const unsigned long native = ca_element_count(chid_);
+    count_ = (count == 0 || count > native) ? native : count;
+
+    st = ca_create_subscription(
+        DbrTraits<T>::timeType,
+        count_,
+        chid_,
+        mask,
+        &CaArrayMonitor<T>::callback,
+        this,
+        &evid_);
+    if (st != ECA_NORMAL) {
+        ca_clear_channel(chid_);
+        chid_ = 0;
+    }
+    CaStatus::requireOk(st, "ca_create_subscription");
+}
+
+template <typename T>
+CaArrayMonitor<T>::~CaArrayMonitor()
+{
+    if (evid_) {
+        ca_clear_subscription(evid_);
+    }
+    if (chid_) {
+        ca_clear_channel(chid_);
+    }
+}
+
+template <typename T>
+void CaArrayMonitor<T>::callback(struct event_handler_args args)
+{
+    if (args.status != ECA_NORMAL || args.dbr == 0) {
+        return;
+    }
+
+    CaArrayMonitor<T> *self = static_cast<CaArrayMonitor<T> *>(args.usr);
+    if (!self || !self->handler_) {
+        return;
+    }
+
+    // Array elements follow the first value field contiguously.
+    const typename DbrTraits<T>::TimeDbr *dbr = static_cast<const typename DbrTraits<T>::TimeDbr *>(args.dbr);
+
+    ArrayUpdate<T> u;
+    u.pvName = self->pvName_;
+    u.values = ArrayView<T>(&dbr->value, args.count > 0 ? static_cast<std::size_t>(args.count) : 0);
+    u.alarmStatus = dbr->status;
+    u.alarmSeverity = dbr->severity;
+    u.ts.secPastEpoch = dbr->stamp.secPastEpoch;
+    u.ts.nsec = dbr->stamp.nsec;
+    CaLatencyStats::recordMonitorLag(u.ts);
+
+    self->handler_->onUpdate(u);
+}
+
+} // namespace caClientLib
+
+#endif
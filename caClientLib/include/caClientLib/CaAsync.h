@@ -0,0 +1,89 @@
+#ifndef CACL_CA_ASYNC_H
+#define CACL_CA_ASYNC_H
+
+#include "caClientLib/CaLatencyStats.h"
+#include "caClientLib/DbrTraits.h"
+
+#include <cadef.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+
+namespace caClientLib {
+
+class CaChannel;
+
+// Completion handlers for CaClient::getAsync / putAsync. status is
+// ECA_NORMAL on success, ECA_TIMEOUT when the deadline passed first, or the
+// CA error reported by the server.
+template <typename T>
+using GetHandler = std::function<void(int status, const TimedValue<T> &value)>;
+
+typedef std::function<void(int status)> PutHandler;
+
+// Tracks outstanding ca_array_get_callback / ca_array_put_callback requests
+// and their deadlines. Nothing here blocks: completions run from inside
+// ca_pend_event()/ca_poll(), and expire() fails overdue requests with
+// ECA_TIMEOUT. A reply that arrives after its deadline is dropped.
+//
+// Each request holds its channel until CA is done with it: clearing the
+// channel would cancel the request without a callback.
+class CaRequestTracker {
+public:
+    // status is ECA_NORMAL on success; dbr/count are only set for gets.
+    typedef std::function<void(int status, const void *dbr, long count)> Completion;
+
+    CaRequestTracker() = default;
+    ~CaRequestTracker();
+
+    CaRequestTracker(const CaRequestTracker &) = delete;
+    CaRequestTracker &operator=(const CaRequestTracker &) = delete;
+
+    // Returns the CA status of issuing the request. On failure the completion
+    // has already been invoked with that status.
+    int get(const std::shared_ptr<CaChannel> &ch, chtype type, unsigned long count, double timeoutSec,
+            Completion done);
+    int put(const std::shared_ptr<CaChannel> &ch, chtype type, unsigned long count, const void *value,
+            double timeoutSec, Completion done);
+
+    // Completes every request whose deadline has passed with ECA_TIMEOUT, and
+    // forgets timed-out requests whose channel has since disconnected.
+    void expire();
+
+    std::size_t pending() const;
+
+    // Seconds until the earliest deadline, or a negative value if idle.
+    double nextDeadlineIn() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    typedef std::uintptr_t RequestId; // passed to CA as the callback argument
+    typedef std::multimap<Clock::time_point, RequestId> DeadlineMap;
+
+    struct Request {
+        std::shared_ptr<CaChannel> channel;
+        Completion done;
+        bool live = true; // false once timed out
+        CaMetric metric = CaMetric::Get;
+        Clock::time_point issued;
+        DeadlineMap::iterator deadline;
+    };
+    typedef std::map<RequestId, Request> RequestMap;
+
+    RequestId enqueue(const std::shared_ptr<CaChannel> &ch, CaMetric metric, double timeoutSec, Completion done);
+    Completion cancel(RequestId id);
+    static void callback(struct event_handler_args args);
+
+    // Guarded by a lock shared by all trackers (see CaAsync.cpp).
+    RequestMap requests_;   // live requests plus late ones still owed a callback
+    DeadlineMap deadlines_; // live requests only
+    std::size_t late_ = 0;  // entries of requests_ that timed out
+};
+
+} // namespace caClientLib
+
+#endif
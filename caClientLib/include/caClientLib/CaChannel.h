@@ -1,31 +1,204 @@
 #ifndef CACL_CA_CHANNEL_H
 #define CACL_CA_CHANNEL_H
 
+#include "caClientLib/CaLatencyStats.h"
+#include "caClientLib/CaResult.h"
+#include "caClientLib/CaStatus.h"
+#include "caClientLib/DbrTraits.h"
+
 #include <cadef.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace caClientLib {
 
+// Blocking channel access. On a NonPreemptive context the calls use
+// ca_pend_io() and so must all come from the context's thread (CaContext
+// refuses to attach other threads). On a Preemptive context, where several
+// threads may share the context, each call waits for its own request only.
 class CaChannel {
 public:
     CaChannel(const std::string &pvName, double timeoutSec);
+
+    // Issues the search but does not wait for the connection; the caller is
+    // expected to call ca_pend_io() once for a whole batch of channels.
+    explicit CaChannel(const std::string &pvName);
     ~CaChannel();
 
     CaChannel(const CaChannel &) = delete;
     CaChannel &operator=(const CaChannel &) = delete;
 
+    // Non-throwing counterparts of the two constructors.
+    static CaResult<std::shared_ptr<CaChannel>> tryConnect(const std::string &pvName, double timeoutSec);
+    static CaResult<std::shared_ptr<CaChannel>> tryCreate(const std::string &pvName);
+
     const std::string &pvName() const { return pvName_; }
     chid chidHandle() const { return chid_; }
+    bool connected() const { return chid_ && ca_state(chid_) == cs_conn; }
+
+    // The try* calls report failures (disconnects, timeouts) through the
+    // returned CaResult without throwing or formatting a message; the plain
+    // calls throw the CaStatus exception instead.
+    CaResult<std::string> tryGetString(double timeoutSec) const;
+    CaResult<void> tryPutString(const std::string &value, double timeoutSec) const;
+
+    std::string getString(double timeoutSec) const { return tryGetString(timeoutSec).value(); }
+    void putString(const std::string &value, double timeoutSec) const { tryPutString(value, timeoutSec).value(); }
+
+    // Native typed access (see DbrTraits.h for the supported types).
+    template <typename T>
+    CaResult<T> tryGet(double timeoutSec) const;
+
+    template <typename T>
+    CaResult<TimedValue<T>> tryGetTimed(double timeoutSec) const;
+
+    // count == 0 reads the channel's native element count.
+    template <typename T>
+    CaResult<std::vector<T>> tryGetArray(double timeoutSec, unsigned long count = 0) const;
 
-    std::string getString(double timeoutSec) const;
-    void putString(const std::string &value, double timeoutSec) const;
+    template <typename T>
+    CaResult<void> tryPut(const T &value, double timeoutSec) const;
+
+    template <typename T>
+    CaResult<void> tryPutArray(const T *values, std::size_t count, double timeoutSec) const;
+
+    template <typename T>
+    T get(double timeoutSec) const
+    {
+        return tryGet<T>(timeoutSec).value();
+    }
+
+    template <typename T>
+    TimedValue<T> getTimed(double timeoutSec) const
+    {
+        return tryGetTimed<T>(timeoutSec).value();
+    }
+
+    template <typename T>
+    std::vector<T> getArray(double timeoutSec, unsigned long count = 0) const
+    {
+        return tryGetArray<T>(timeoutSec, count).value();
+    }
+
+    template <typename T>
+    void put(const T &value, double timeoutSec) const
+    {
+        tryPut<T>(value, timeoutSec).value();
+    }
+
+    template <typename T>
+    void putArray(const T *values, std::size_t count, double timeoutSec) const
+    {
+        tryPutArray<T>(values, count, timeoutSec).value();
+    }
 
 private:
+    friend class CaChannelGroup;
+
+    struct Unopened {};
+    CaChannel(const std::string &pvName, Unopened) : pvName_(pvName), chid_(0) {}
+
+    // ca_pend_io() with PendIo latency accounting.
+    static int pendIo(double timeoutSec);
+
+    // ca_pend_io() waits for every outstanding request of the context, so
+    // threads sharing a preemptive one would complete (or time out) each
+    // other's calls; there requests go through the callback API instead.
+    static bool sharedContext() { return ca_preemtive_callback_is_enabled() != 0; }
+
+    // Issues a get (buf receives the reply) or put (buf holds the value, and
+    // is not written) and waits for it.
+    CaResult<void> transfer(bool put, chtype type, unsigned long count, void *buf, double timeoutSec) const;
+
+    // A callback request that a blocking call waits for. It belongs to the
+    // channel: the waiter frees it once done, the callback if the waiter
+    // gave up, and ~CaChannel if no callback ever came.
+    struct Pending {
+        const CaChannel *owner = nullptr;
+        void *buf = nullptr; // get destination, dropped when the waiter gives up
+        std::size_t size = 0;
+        int status = ECA_TIMEOUT;
+        bool done = false;
+        bool abandoned = false;
+        std::list<Pending>::iterator self;
+        std::condition_variable cv;
+    };
+
+    int startRequest(bool put, chtype type, unsigned long count, void *buf, Pending *&req) const;
+    int waitRequest(Pending *req, std::chrono::steady_clock::time_point deadline) const;
+    static void requestDone(struct event_handler_args args);
+
     std::string pvName_;
     chid chid_;
+    mutable std::mutex pendingLock_;
+    mutable std::list<Pending> pending_;
 };
 
+template <typename T>
+CaResult<T> CaChannel::tryGet(double timeoutSec) const
+{
+    T value{};
+    CaResult<void> r = transfer(false, DbrTraits<T>::plainType, 1, &value, timeoutSec);
+    if (!r) {
+        return r.error();
+    }
+    return value;
+}
+
+template <typename T>
+CaResult<TimedValue<T>> CaChannel::tryGetTimed(double timeoutSec) const
+{
+    typename DbrTraits<T>::TimeDbr buf{};
+    CaResult<void> r = transfer(false, DbrTraits<T>::timeType, 1, &buf, timeoutSec);
+    if (!r) {
+        return r.error();
+    }
+
+    TimedValue<T> out;
+    fromTimeDbr<T>(buf, out);
+    return out;
+}
+
+template <typename T>
+CaResult<std::vector<T>> CaChannel::tryGetArray(double timeoutSec, unsigned long count) const
+{
+    const unsigned long native = ca_element_count(chid_);
+    if (count == 0 || count > native) {
+        count = native;
+    }
+
+    std::vector<T> values(count);
+    if (count == 0) {
+        return values;
+    }
+
+    CaResult<void> r = transfer(false, DbrTraits<T>::plainType, count, values.data(), timeoutSec);
+    if (!r) {
+        return r.error();
+    }
+    return values;
+}
+
+template <typename T>
+CaResult<void> CaChannel::tryPut(const T &value, double timeoutSec) const
+{
+    return transfer(true, DbrTraits<T>::plainType, 1, const_cast<T *>(&value), timeoutSec);
+}
+
+template <typename T>
+CaResult<void> CaChannel::tryPutArray(const T *values, std::size_t count, double timeoutSec) const
+{
+    return transfer(true, DbrTraits<T>::plainType, static_cast<unsigned long>(count), const_cast<T *>(values),
+                    timeoutSec);
+}
+
 } // namespace caClientLib
 
 #endif
@@ -0,0 +1,83 @@
+#ifndef CACL_CA_CHANNEL_CACHE_H
+#define CACL_CA_CHANNEL_CACHE_H
+
+#include "caClientLib/CaChannel.h"
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace caClientLib {
+
+struct ChannelCacheOptions {
+    std::size_t capacity = 256;    // 0 = unbounded
+    double idleTimeoutSec = 300.0; // 0 = never expire idle channels
+};
+
+struct ChannelCacheStats {
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+    unsigned long long evictions = 0;
+    unsigned long long reconnects = 0;
+};
+
+// Keeps connected channels alive between calls so repeated access to the same
+// PV costs one round trip instead of a search + connect + clear.
+// Least recently used channels are dropped once `capacity` is exceeded or
+// when they have not been used for `idleTimeoutSec`.
+// All methods are thread-safe; connects happen outside the internal lock.
+class CaChannelCache {
+public:
+    explicit CaChannelCache(const ChannelCacheOptions &opt = ChannelCacheOptions());
+
+    CaChannelCache(const CaChannelCache &) = delete;
+    CaChannelCache &operator=(const CaChannelCache &) = delete;
+
+    // Returns a connected channel, creating (and connecting) it on a miss.
+    // A cached channel that lost its connection is replaced by a fresh one.
+    std::shared_ptr<CaChannel> acquire(const std::string &pvName, double timeoutSec);
+
+    // As acquire(), but a failed connect is returned instead of thrown.
+    CaResult<std::shared_ptr<CaChannel>> tryAcquire(const std::string &pvName, double timeoutSec);
+
+    // Non-blocking lookup: returns a connected cached channel or nullptr.
+    std::shared_ptr<CaChannel> find(const std::string &pvName);
+
+    // Adds a channel that was connected elsewhere (e.g. by a CaChannelGroup).
+    void insert(const std::shared_ptr<CaChannel> &ch);
+
+    void evict(const std::string &pvName);
+    void evictIdle();
+    void clear();
+
+    std::size_t size() const;
+    ChannelCacheStats stats() const;
+    const ChannelCacheOptions &options() const { return opt_; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        std::shared_ptr<CaChannel> channel;
+        Clock::time_point lastUsed;
+    };
+
+    typedef std::list<Entry> LruList;
+
+    void evictIdle(Clock::time_point now);
+    void enforceCapacity();
+
+    const ChannelCacheOptions opt_;
+    mutable std::mutex lock_;
+    ChannelCacheStats stats_;
+    LruList lru_; // most recently used first
+    std::unordered_map<std::string, LruList::iterator> index_;
+};
+
+} // namespace caClientLib
+
+#endif
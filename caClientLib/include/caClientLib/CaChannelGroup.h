@@ -0,0 +1,71 @@
+#ifndef CACL_CA_CHANNEL_GROUP_H
+#define CACL_CA_CHANNEL_GROUP_H
+
+#include "caClientLib/CaChannel.h"
+
+#include <cadef.h>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace caClientLib {
+
+class CaChannelCache;
+
+struct CaGroupResult {
+    std::string pvName;
+    std::string value; // filled for gets only
+    int status = ECA_NORMAL;
+
+    bool ok() const { return status == ECA_NORMAL; }
+};
+
+// Batches connects, gets and puts for many PVs. execute() creates every
+// missing channel, waits once for all connections, issues all requests and
+// waits once more, so N PVs cost two ca_pend_io calls instead of 2N. On a
+// Preemptive context the requests are still issued together but waited for
+// one by one, as CaChannel does.
+// Per-PV failures are reported through CaGroupResult::status, not thrown.
+class CaChannelGroup {
+public:
+    // With a cache, connected channels are reused and new ones are added to it.
+    explicit CaChannelGroup(CaChannelCache *cache = nullptr);
+
+    CaChannelGroup(const CaChannelGroup &) = delete;
+    CaChannelGroup &operator=(const CaChannelGroup &) = delete;
+
+    std::size_t addGet(const std::string &pvName);
+    std::size_t addPut(const std::string &pvName, const std::string &value);
+
+    void execute(double timeoutSec);
+
+    std::size_t size() const { return ops_.size(); }
+    const CaGroupResult &result(std::size_t i) const { return results_[i]; }
+    const std::vector<CaGroupResult> &results() const { return results_; }
+    bool allOk() const;
+
+    void clear();
+
+private:
+    struct Op {
+        bool isPut = false;
+        std::string putValue;
+        std::shared_ptr<CaChannel> channel;
+        CaChannel::Pending *pending = nullptr; // shared context only
+        dbr_string_t buf;
+    };
+
+    std::shared_ptr<CaChannel> channelFor(const std::string &pvName, bool &created, int &status);
+
+    CaChannelCache *cache_;
+    std::vector<Op> ops_;
+    std::vector<CaGroupResult> results_;
+    std::map<std::string, std::shared_ptr<CaChannel>> channels_;
+};
+
+} // namespace caClientLib
+
+#endif
@@ -1,33 +1,313 @@
 #ifndef CACL_CA_CLIENT_H
 #define CACL_CA_CLIENT_H
 
+#include "caClientLib/CaArrayMonitor.h"
+#include "caClientLib/CaAsync.h"
 #include "caClientLib/CaChannel.h"
+#include "caClientLib/CaChannelCache.h"
+#include "caClientLib/CaChannelGroup.h"
 #include "caClientLib/CaContext.h"
+#include "caClientLib/CaEventLoop.h"
+#include "caClientLib/CaLatencyStats.h"
 #include "caClientLib/CaMonitor.h"
+#include "caClientLib/CaResult.h"
+#include "caClientLib/CaSubscriptionRegistry.h"
+#include "caClientLib/CaTypedMonitor.h"
 
+#include <atomic>
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace caClientLib {
 
+// Latency histograms are process-wide (shared by every CaClient); the cache
+// counters belong to this client.
+struct CaClientStats {
+    LatencySummary connect;
+    LatencySummary get;
+    LatencySummary put;
+    LatencySummary pendIo;
+    LatencySummary monitorLag;
+    ChannelCacheStats cache;
+};
+
+// A CaClient may be shared between threads when it is created with
+// CaContext::Preemptive: every call attaches the calling thread to the
+// client's CA context, so all threads reuse one set of channels and circuits.
+// Blocking gets and puts then wait for their own request rather than for
+// ca_pend_io(), so concurrent callers do not complete or time out each other.
+// A non-preemptive client must only be used from the thread that created it;
+// calls from any other thread throw std::logic_error.
 class CaClient {
 public:
     CaClient();
+    explicit CaClient(const ChannelCacheOptions &cacheOpt);
+    explicit CaClient(CaContext::CallbackMode mode, const ChannelCacheOptions &cacheOpt = ChannelCacheOptions());
 
     std::string getString(const std::string &pvName, double timeoutSec);
     void putString(const std::string &pvName, const std::string &value, double timeoutSec);
 
+    // Non-throwing variants for scans over many PVs: a disconnected or slow
+    // PV costs a CaResult holding the status, not an exception and a
+    // formatted message. The throwing calls are wrappers around these.
+    CaResult<std::string> tryGetString(const std::string &pvName, double timeoutSec);
+    CaResult<void> tryPutString(const std::string &pvName, const std::string &value, double timeoutSec);
+
+    template <typename T>
+    CaResult<T> tryGet(const std::string &pvName, double timeoutSec)
+    {
+        CaResult<std::shared_ptr<CaChannel>> ch = tryChannel(pvName, timeoutSec);
+        if (!ch) {
+            return ch.error();
+        }
+        return (*ch)->tryGet<T>(timeoutSec);
+    }
+
+    template <typename T>
+    CaResult<TimedValue<T>> tryGetTimed(const std::string &pvName, double timeoutSec)
+    {
+        CaResult<std::shared_ptr<CaChannel>> ch = tryChannel(pvName, timeoutSec);
+        if (!ch) {
+            return ch.error();
+        }
+        return (*ch)->tryGetTimed<T>(timeoutSec);
+    }
+
+    template <typename T>
+    CaResult<std::vector<T>> tryGetArray(const std::string &pvName, double timeoutSec, unsigned long count = 0)
+    {
+        CaResult<std::shared_ptr<CaChannel>> ch = tryChannel(pvName, timeoutSec);
+        if (!ch) {
+            return ch.error();
+        }
+        return (*ch)->tryGetArray<T>(timeoutSec, count);
+    }
+
+    template <typename T>
+    CaResult<void> tryPut(const std::string &pvName, const T &value, double timeoutSec)
+    {
+        CaResult<std::shared_ptr<CaChannel>> ch = tryChannel(pvName, timeoutSec);
+        if (!ch) {
+            return ch.error();
+        }
+        return (*ch)->tryPut<T>(value, timeoutSec);
+    }
+
+    // Batched variant: one connect wait and one get wait for all PVs.
+    std::vector<CaGroupResult> getStrings(const std::vector<std::string> &pvNames, double timeoutSec);
+
+    // Native typed access through the channel cache (no string conversion).
+    template <typename T>
+    T get(const std::string &pvName, double timeoutSec)
+    {
+        return tryGet<T>(pvName, timeoutSec).value();
+    }
+
+    template <typename T>
+    TimedValue<T> getTimed(const std::string &pvName, double timeoutSec)
+    {
+        return tryGetTimed<T>(pvName, timeoutSec).value();
+    }
+
+    template <typename T>
+    std::vector<T> getArray(const std::string &pvName, double timeoutSec, unsigned long count = 0)
+    {
+        return tryGetArray<T>(pvName, timeoutSec, count).value();
+    }
+
+    template <typename T>
+    void put(const std::string &pvName, const T &value, double timeoutSec)
+    {
+        tryPut<T>(pvName, value, timeoutSec).value();
+    }
+
+    // Non-blocking requests built on ca_array_get_callback/ca_array_put_callback.
+    // Only the first use of a PV blocks (to connect it through the cache);
+    // after that any number of requests can be in flight at once. Requests
+    // are sent on flush()/pendEvent()/poll() and their handlers run from
+    // there; overdue requests complete with ECA_TIMEOUT.
+    template <typename T>
+    void getAsync(const std::string &pvName, double timeoutSec, GetHandler<T> done);
+
+    template <typename T>
+    std::future<TimedValue<T>> getAsync(const std::string &pvName, double timeoutSec);
+
+    template <typename T>
+    void putAsync(const std::string &pvName, const T &value, double timeoutSec, PutHandler done);
+
+    template <typename T>
+    std::future<void> putAsync(const std::string &pvName, const T &value, double timeoutSec);
+
+    std::size_t pendingRequests() const { return requests_.pending(); }
+
+    // For layers issuing their own callback requests (see CaCoroutine.h);
+    // their deadlines are enforced by run()/pendEvent()/poll().
+    CaRequestTracker &requestTracker() { return requests_; }
+
     std::unique_ptr<CaMonitor> monitorStringTime(
         const std::string &pvName,
         double timeoutSec,
         IMonitorHandler &handler);
 
-    void pendEvent(double seconds) { ctx_.pendEvent(seconds); }
+    CaResult<std::unique_ptr<CaMonitor>> tryMonitorStringTime(
+        const std::string &pvName,
+        double timeoutSec,
+        IMonitorHandler &handler);
+
+    // Shared DBR_TIME_STRING subscription: every handler watching the same
+    // PV with the same mask is served by one CA subscription (see
+    // CaSubscriptionRegistry). Keep the returned handle to stay subscribed.
+    CaSubscription subscribe(const std::string &pvName, double timeoutSec, IMonitorHandler &handler,
+                             long mask = DBE_VALUE | DBE_ALARM)
+    {
+        ctx_.attach();
+        return subscriptions_.subscribe(pvName, timeoutSec, handler, mask);
+    }
+
+    CaResult<CaSubscription> trySubscribe(const std::string &pvName, double timeoutSec, IMonitorHandler &handler,
+                                          long mask = DBE_VALUE | DBE_ALARM)
+    {
+        ctx_.attach();
+        return subscriptions_.trySubscribe(pvName, timeoutSec, handler, mask);
+    }
+
+    CaSubscriptionRegistry &subscriptions() { return subscriptions_; }
+
+    template <typename T>
+    std::unique_ptr<CaTypedMonitor<T>> monitor(
+        const std::string &pvName,
+        double timeoutSec,
+        ITypedMonitorHandler<T> &handler,
+        const MonitorPolicy &policy = MonitorPolicy())
+    {
+        ctx_.attach();
+        return std::unique_ptr<CaTypedMonitor<T>>(new CaTypedMonitor<T>(pvName, timeoutSec, handler, policy));
+    }
+
+    template <typename T>
+    std::unique_ptr<CaArrayMonitor<T>> monitorArray(
+        const std::string &pvName,
+        double timeoutSec,
+        IArrayMonitorHandler<T> &handler,
+        unsigned long count = 0)
+    {
+        ctx_.attach();
+        return std::unique_ptr<CaArrayMonitor<T>>(new CaArrayMonitor<T>(pvName, timeoutSec, handler, count));
+    }
+
+    void pendEvent(double seconds);
+    void poll();
+    void flush();
+
+    // Dispatches CA callbacks and async deadlines until done() returns true
+    // (checked after every wakeup), stop() is called, or timeoutSec elapses
+    // (<= 0: no limit). Non-preemptive clients sleep on the CA file
+    // descriptors through eventLoop(); otherwise this falls back to short
+    // pendEvent() slices.
+    void run(const std::function<bool()> &done = std::function<bool()>(), double timeoutSec = 0.0);
+
+    // Makes run() return after its current wakeup; safe from any thread or
+    // from a handler.
+    void stop() { stopping_ = true; }
+
+#ifdef CACL_HAVE_EVENT_LOOP
+    // Only available for non-preemptive clients (throws otherwise). Use it to
+    // add timers or to embed the client's fd in another loop.
+    CaEventLoop &eventLoop();
+#endif
+
+    CaChannelCache &channelCache() { return cache_; }
+    ChannelCacheStats cacheStats() const { return cache_.stats(); }
+
+    CaClientStats stats() const;
+    void resetStats() { CaLatencyStats::reset(); }
+
+    // Attaches the calling thread to this client's context (no-op if already
+    // attached). Called implicitly by every CaClient method; only needed
+    // before using CaChannel/CaMonitor objects directly from a new thread.
+    void attachThread() { ctx_.attach(); }
 
 private:
+    void initEventLoop();
+
+    std::shared_ptr<CaChannel> channel(const std::string &pvName, double timeoutSec)
+    {
+        ctx_.attach();
+        return cache_.acquire(pvName, timeoutSec);
+    }
+
+    CaResult<std::shared_ptr<CaChannel>> tryChannel(const std::string &pvName, double timeoutSec)
+    {
+        ctx_.attach();
+        return cache_.tryAcquire(pvName, timeoutSec);
+    }
+
     CaContext ctx_;
+#ifdef CACL_HAVE_EVENT_LOOP
+    std::unique_ptr<CaEventLoop> loop_; // deregisters its fds before ctx_ goes
+#endif
+    std::atomic<bool> stopping_;
+    CaRequestTracker requests_; // holds its requests' channels; released before ctx_ goes
+    CaChannelCache cache_;      // declared after ctx_: channels are cleared before the context goes
+    CaSubscriptionRegistry subscriptions_; // cleared before the cache and the context
 };
 
+template <typename T>
+void CaClient::getAsync(const std::string &pvName, double timeoutSec, GetHandler<T> done)
+{
+    std::shared_ptr<CaChannel> ch = channel(pvName, timeoutSec);
+    requests_.get(ch, DbrTraits<T>::timeType, 1, timeoutSec,
+        [done](int status, const void *dbr, long) {
+            TimedValue<T> v;
+            if (status == ECA_NORMAL && dbr) {
+                fromTimeDbr<T>(*static_cast<const typename DbrTraits<T>::TimeDbr *>(dbr), v);
+            }
+            done(status, v);
+        });
+}
+
+template <typename T>
+std::future<TimedValue<T>> CaClient::getAsync(const std::string &pvName, double timeoutSec)
+{
+    std::shared_ptr<std::promise<TimedValue<T>>> p = std::make_shared<std::promise<TimedValue<T>>>();
+    std::future<TimedValue<T>> f = p->get_future();
+    getAsync<T>(pvName, timeoutSec, [p](int status, const TimedValue<T> &v) {
+        if (status == ECA_NORMAL) {
+            p->set_value(v);
+        } else {
+            p->set_exception(std::make_exception_ptr(CaStatus::error(status, "getAsync")));
+        }
+    });
+    return f;
+}
+
+template <typename T>
+void CaClient::putAsync(const std::string &pvName, const T &value, double timeoutSec, PutHandler done)
+{
+    std::shared_ptr<CaChannel> ch = channel(pvName, timeoutSec);
+    requests_.put(ch, DbrTraits<T>::plainType, 1, &value, timeoutSec,
+        [done](int status, const void *, long) { done(status); });
+}
+
+template <typename T>
+std::future<void> CaClient::putAsync(const std::string &pvName, const T &value, double timeoutSec)
+{
+    std::shared_ptr<std::promise<void>> p = std::make_shared<std::promise<void>>();
+    std::future<void> f = p->get_future();
+    putAsync<T>(pvName, value, timeoutSec, [p](int status) {
+        if (status == ECA_NORMAL) {
+            p->set_value();
+        } else {
+            p->set_exception(std::make_exception_ptr(CaStatus::error(status, "putAsync")));
+        }
+    });
+    return f;
+}
+
 } // namespace caClientLib
 
 #endif
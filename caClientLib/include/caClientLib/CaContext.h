@@ -5,9 +5,15 @@
 
 namespace caClientLib {
 
+// Owns (or joins) the CA client context of the constructing thread.
 class CaContext {
 public:
-    CaContext();
+    enum CallbackMode {
+        NonPreemptive, // callbacks only run inside ca_pend_event()/ca_poll()
+        Preemptive,    // callbacks run on CA's auxiliary threads
+    };
+
+    explicit CaContext(CallbackMode mode = NonPreemptive);
     ~CaContext();
 
     CaContext(const CaContext &) = delete;
@@ -15,8 +21,21 @@ public:
 
     void pendEvent(double seconds);
 
+    CallbackMode mode() const { return mode_; }
+
+    // Makes this context current on the calling thread. Other threads can
+    // only join a Preemptive context; calling from the owning thread (or an
+    // already attached one) is a cheap no-op. Throws std::logic_error for a
+    // thread that has a different context of its own, or for any other
+    // thread when the context is NonPreemptive.
+    void attach();
+
+    ca_client_context *handle() const { return context_; }
+
 private:
-    bool created_;
+    CallbackMode mode_;
+    ca_client_context *context_;
+    bool created_; // false when we joined a context the thread already had
 };
 
 } // namespace caClientLib
@@ -0,0 +1,661 @@
+#ifndef CACL_CA_COROUTINE_H
+#define CACL_CA_COROUTINE_H
+
+#include "caClientLib/CaClient.h"
+
+// Needs a C++20 build (e.g. USR_CXXFLAGS_Linux += -std=c++20) and the epoll
+// event loop; otherwise this header declares nothing.
+#if defined(CACL_HAVE_EVENT_LOOP) && defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define CACL_HAVE_COROUTINES 1
+#endif
+
+#ifdef CACL_HAVE_COROUTINES
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+
+namespace caClientLib {
+
+// Coroutine front end for a non-preemptive CaClient. Nothing here blocks:
+// gets and puts go out through the client's request tracker, connects and
+// monitor waits are bounded by event loop timers, and a suspended coroutine
+// is resumed from CaClient::run() once its reply, update or timeout arrives.
+// Any number of sequences can be in flight on the thread calling run().
+//
+//   CaTask<void> setPeriod(CaCoScope &s, double period)
+//   {
+//       CaCoChannel set = co_await s.connect("ESP:period", 2.0);
+//       CaCoChannel rb = co_await s.connect("ESP:period:rb", 2.0);
+//       CaCoMonitor<double> readback(rb);
+//       co_await set.put(period, 1.0);
+//       while ((co_await readback.next(5.0)).value != period) {
+//       }
+//   }
+//
+//   CaCoScope scope(client);
+//   scope.spawn(setPeriod(scope, 0.5));
+//   client.run([&]() { return scope.idle(); }, 10.0);
+//   scope.rethrow();
+//
+// Failures (including ECA_TIMEOUT) are thrown from co_await as the
+// std::runtime_error CaStatus::requireOk() produces.
+
+class CaCoScope;
+
+template <typename T = void>
+class CaTask;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    struct FinalAwaiter {
+        TaskPromiseBase *promise;
+
+        bool await_ready() noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) noexcept;
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return FinalAwaiter{this}; }
+    void unhandled_exception() { error = std::current_exception(); }
+
+    std::coroutine_handle<> continuation; // awaiting coroutine, if any
+    CaCoScope *scope = nullptr;           // set for spawned tasks
+    std::exception_ptr error;
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    CaTask<T> get_return_object();
+    void return_value(T v) { value = std::move(v); }
+
+    std::optional<T> value;
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    CaTask<void> get_return_object();
+    void return_void() {}
+};
+
+// State shared between a suspended awaiter and the callback completing it.
+// The awaiter clears `handle` when its frame is destroyed, so a completion
+// arriving later is dropped. Resumption is posted to the event loop and
+// never happens inside a CA callback.
+struct CoWaiter {
+    CaEventLoop *loop = nullptr;
+    std::coroutine_handle<> handle;
+    int status = ECA_NORMAL;
+    bool done = false;
+
+    static void complete(const std::shared_ptr<CoWaiter> &w, int status)
+    {
+        if (w->done) {
+            return;
+        }
+        w->done = true;
+        w->status = status;
+        w->loop->post([w]() {
+            if (w->handle) {
+                std::exchange(w->handle, std::coroutine_handle<>()).resume();
+            }
+        });
+    }
+};
+
+} // namespace detail
+
+// Lazily started coroutine returning T. co_await runs it to completion and
+// yields its result (or rethrows its exception); CaCoScope::spawn() runs it
+// detached.
+template <typename T>
+class CaTask {
+public:
+    typedef detail::TaskPromise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    CaTask(CaTask &&o) noexcept : h_(std::exchange(o.h_, Handle())) {}
+
+    CaTask &operator=(CaTask &&o) noexcept
+    {
+        if (this != &o) {
+            if (h_) {
+                h_.destroy();
+            }
+            h_ = std::exchange(o.h_, Handle());
+        }
+        return *this;
+    }
+
+    ~CaTask()
+    {
+        if (h_) {
+            h_.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+    {
+        h_.promise().continuation = caller;
+        return h_;
+    }
+
+    T await_resume()
+    {
+        promise_type &p = h_.promise();
+        if (p.error) {
+            std::rethrow_exception(p.error);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*p.value);
+        }
+    }
+
+private:
+    friend struct detail::TaskPromise<T>;
+    friend class CaCoScope;
+
+    explicit CaTask(Handle h) : h_(h) {}
+
+    Handle h_;
+};
+
+template <typename T>
+CaTask<T> detail::TaskPromise<T>::get_return_object()
+{
+    return CaTask<T>(CaTask<T>::Handle::from_promise(*this));
+}
+
+inline CaTask<void> detail::TaskPromise<void>::get_return_object()
+{
+    return CaTask<void>(CaTask<void>::Handle::from_promise(*this));
+}
+
+template <typename T, bool Timed>
+class CaCoGet {
+public:
+    typedef typename std::conditional<Timed, TimedValue<T>, T>::type Result;
+
+    CaCoGet(CaClient &client, std::shared_ptr<CaChannel> ch, double timeoutSec)
+        : client_(&client), ch_(std::move(ch)), timeoutSec_(timeoutSec)
+    {
+    }
+
+    ~CaCoGet()
+    {
+        if (state_) {
+            state_->handle = std::coroutine_handle<>();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        state_ = std::make_shared<State>();
+        state_->loop = &client_->eventLoop();
+        state_->handle = h;
+
+        std::shared_ptr<State> s = state_;
+        client_->requestTracker().get(ch_, DbrTraits<T>::timeType, 1, timeoutSec_,
+            [s](int status, const void *dbr, long) {
+                if (status == ECA_NORMAL && dbr) {
+                    fromTimeDbr<T>(*static_cast<const typename DbrTraits<T>::TimeDbr *>(dbr), s->value);
+                }
+                detail::CoWaiter::complete(s, status);
+            });
+    }
+
+    Result await_resume()
+    {
+        CaStatus::requireOk(state_->status, "co_await get");
+        if constexpr (Timed) {
+            return state_->value;
+        } else {
+            return state_->value.value;
+        }
+    }
+
+private:
+    struct State : detail::CoWaiter {
+        TimedValue<T> value;
+    };
+
+    CaClient *client_;
+    std::shared_ptr<CaChannel> ch_;
+    double timeoutSec_;
+    std::shared_ptr<State> state_;
+};
+
+template <typename T>
+class CaCoPut {
+public:
+    CaCoPut(CaClient &client, std::shared_ptr<CaChannel> ch, const T &value, double timeoutSec)
+        : client_(&client), ch_(std::move(ch)), value_(value), timeoutSec_(timeoutSec)
+    {
+    }
+
+    ~CaCoPut()
+    {
+        if (state_) {
+            state_->handle = std::coroutine_handle<>();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        state_ = std::make_shared<detail::CoWaiter>();
+        state_->loop = &client_->eventLoop();
+        state_->handle = h;
+
+        std::shared_ptr<detail::CoWaiter> s = state_;
+        client_->requestTracker().put(ch_, DbrTraits<T>::plainType, 1, &value_, timeoutSec_,
+            [s](int status, const void *, long) { detail::CoWaiter::complete(s, status); });
+    }
+
+    void await_resume() { CaStatus::requireOk(state_->status, "co_await put"); }
+
+private:
+    CaClient *client_;
+    std::shared_ptr<CaChannel> ch_;
+    T value_;
+    double timeoutSec_;
+    std::shared_ptr<detail::CoWaiter> state_;
+};
+
+// A connected channel for use from coroutines; cheap to copy.
+class CaCoChannel {
+public:
+    CaCoChannel() : client_(nullptr) {}
+    CaCoChannel(CaClient &client, std::shared_ptr<CaChannel> channel) : client_(&client), channel_(std::move(channel)) {}
+
+    const std::string &pvName() const { return channel_->pvName(); }
+    const std::shared_ptr<CaChannel> &channel() const { return channel_; }
+    CaClient &client() const { return *client_; }
+
+    template <typename T>
+    CaCoGet<T, false> get(double timeoutSec) const
+    {
+        return CaCoGet<T, false>(*client_, channel_, timeoutSec);
+    }
+
+    template <typename T>
+    CaCoGet<T, true> getTimed(double timeoutSec) const
+    {
+        return CaCoGet<T, true>(*client_, channel_, timeoutSec);
+    }
+
+    // Completes when the server has processed the put (ca_array_put_callback).
+    template <typename T>
+    CaCoPut<T> put(const T &value, double timeoutSec) const
+    {
+        return CaCoPut<T>(*client_, channel_, value, timeoutSec);
+    }
+
+private:
+    CaClient *client_;
+    std::shared_ptr<CaChannel> channel_;
+};
+
+// Resolves to a CaCoChannel: immediately when the PV is already in the
+// client's channel cache, otherwise after the search completes. The new
+// channel is added to the cache.
+class CaCoConnect {
+public:
+    CaCoConnect(CaClient &client, const std::string &pvName, double timeoutSec)
+        : client_(&client), pvName_(pvName), timeoutSec_(timeoutSec)
+    {
+    }
+
+    ~CaCoConnect()
+    {
+        if (state_) {
+            state_->handle = std::coroutine_handle<>();
+            if (state_->timer) {
+                state_->loop->cancelTimer(state_->timer);
+                state_->timer = 0;
+            }
+            state_->channel.reset();
+        }
+    }
+
+    bool await_ready()
+    {
+        channel_ = client_->channelCache().find(pvName_);
+        return channel_ != nullptr;
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        state_ = std::make_shared<State>();
+        state_->loop = &client_->eventLoop();
+        state_->handle = h;
+        state_->started = CaLatencyStats::Clock::now();
+        state_->channel.reset(new CaChannel(pvName_));
+
+        const chid id = state_->channel->chidHandle();
+        ca_set_puser(id, state_.get());
+        const int st = ca_change_connection_event(id, &CaCoConnect::connectionEvent);
+        if (st != ECA_NORMAL) {
+            state_->channel.reset();
+            detail::CoWaiter::complete(state_, st);
+            return;
+        }
+
+        std::shared_ptr<State> s = state_;
+        state_->timer = state_->loop->addTimer(timeoutSec_, [s]() {
+            s->timer = 0;
+            s->channel.reset();
+            detail::CoWaiter::complete(s, ECA_TIMEOUT);
+        });
+    }
+
+    CaCoChannel await_resume()
+    {
+        if (state_) {
+            CaStatus::requireOk(state_->status, "co_await connect");
+            channel_ = std::move(state_->channel);
+            client_->channelCache().insert(channel_);
+        }
+        return CaCoChannel(*client_, channel_);
+    }
+
+private:
+    struct State : detail::CoWaiter, std::enable_shared_from_this<State> {
+        std::shared_ptr<CaChannel> channel;
+        CaEventLoop::TimerId timer = 0;
+        CaLatencyStats::Clock::time_point started;
+    };
+
+    static void connectionEvent(struct connection_handler_args args)
+    {
+        State *s = static_cast<State *>(ca_puser(args.chid));
+        if (!s || args.op != CA_OP_CONN_UP) {
+            return;
+        }
+        // Later connection changes are tracked through ca_state() only.
+        ca_set_puser(args.chid, 0);
+        if (s->timer) {
+            s->loop->cancelTimer(s->timer);
+            s->timer = 0;
+        }
+        CaLatencyStats::record(CaMetric::Connect, s->started);
+        detail::CoWaiter::complete(s->shared_from_this(), ECA_NORMAL);
+    }
+
+    CaClient *client_;
+    std::string pvName_;
+    double timeoutSec_;
+    std::shared_ptr<CaChannel> channel_;
+    std::shared_ptr<State> state_;
+};
+
+// Suspends for a number of seconds on an event loop timer.
+class CaCoSleep {
+public:
+    CaCoSleep(CaEventLoop &loop, double seconds) : loop_(&loop), seconds_(seconds), timer_(0) {}
+
+    ~CaCoSleep()
+    {
+        if (state_) {
+            state_->handle = std::coroutine_handle<>();
+            if (timer_) {
+                loop_->cancelTimer(timer_);
+            }
+        }
+    }
+
+    bool await_ready() const noexcept { return seconds_ <= 0.0; }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        state_ = std::make_shared<detail::CoWaiter>();
+        state_->loop = loop_;
+        state_->handle = h;
+
+        std::shared_ptr<detail::CoWaiter> s = state_;
+        CaEventLoop::TimerId *timer = &timer_;
+        timer_ = loop_->addTimer(seconds_, [s, timer]() {
+            *timer = 0; // the awaiter cancels the timer if it goes first
+            detail::CoWaiter::complete(s, ECA_NORMAL);
+        });
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    CaEventLoop *loop_;
+    double seconds_;
+    CaEventLoop::TimerId timer_;
+    std::shared_ptr<detail::CoWaiter> state_;
+};
+
+// Subscription on a connected CaCoChannel whose updates are queued until a
+// coroutine takes them with co_await next(). The first update is the
+// current value. When more than queueLimit updates are waiting the oldest
+// is dropped.
+template <typename T>
+class CaCoMonitor {
+public:
+    class Next {
+    public:
+        Next(CaCoMonitor &m, double timeoutSec) : m_(&m), timeoutSec_(timeoutSec) {}
+
+        ~Next()
+        {
+            if (state_) {
+                state_->handle = std::coroutine_handle<>();
+                if (m_->waiter_ == state_) {
+                    m_->disarm();
+                }
+            }
+        }
+
+        bool await_ready() const noexcept { return !m_->queue_.empty(); }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            if (m_->waiter_) {
+                throw std::logic_error("CaCoMonitor::next: already awaited by another coroutine");
+            }
+            state_ = std::make_shared<detail::CoWaiter>();
+            state_->loop = m_->loop_;
+            state_->handle = h;
+            m_->waiter_ = state_;
+
+            CaCoMonitor *m = m_;
+            m_->timer_ = m_->loop_->addTimer(timeoutSec_, [m]() {
+                m->timer_ = 0;
+                std::shared_ptr<detail::CoWaiter> w = std::move(m->waiter_);
+                detail::CoWaiter::complete(w, ECA_TIMEOUT);
+            });
+        }
+
+        TimedValue<T> await_resume()
+        {
+            if (m_->queue_.empty()) {
+                throw CaStatus::error(ECA_TIMEOUT, "co_await next");
+            }
+            TimedValue<T> v = m_->queue_.front();
+            m_->queue_.pop_front();
+            return v;
+        }
+
+    private:
+        CaCoMonitor *m_;
+        double timeoutSec_;
+        std::shared_ptr<detail::CoWaiter> state_;
+    };
+
+    explicit CaCoMonitor(const CaCoChannel &channel, std::size_t queueLimit = 64, long mask = DBE_VALUE | DBE_ALARM)
+        : loop_(&channel.client().eventLoop()), channel_(channel.channel()), evid_(0),
+          limit_(queueLimit > 0 ? queueLimit : 1), dropped_(0), timer_(0)
+    {
+        const int st = ca_create_subscription(DbrTraits<T>::timeType, 1, channel_->chidHandle(), mask,
+            &CaCoMonitor<T>::callback, this, &evid_);
+        CaStatus::requireOk(st, "ca_create_subscription");
+    }
+
+    ~CaCoMonitor()
+    {
+        disarm();
+        if (evid_) {
+            ca_clear_subscription(evid_);
+        }
+    }
+
+    CaCoMonitor(const CaCoMonitor &) = delete;
+    CaCoMonitor &operator=(const CaCoMonitor &) = delete;
+
+    // Next queued update; throws ECA_TIMEOUT if none arrives within timeoutSec.
+    Next next(double timeoutSec) { return Next(*this, timeoutSec); }
+
+    std::size_t queued() const { return queue_.size(); }
+    unsigned long long dropped() const { return dropped_; }
+
+private:
+    static void callback(struct event_handler_args args)
+    {
+        if (args.status != ECA_NORMAL || args.dbr == 0) {
+            return;
+        }
+        CaCoMonitor<T> *self = static_cast<CaCoMonitor<T> *>(args.usr);
+
+        TimedValue<T> v;
+        fromTimeDbr<T>(*static_cast<const typename DbrTraits<T>::TimeDbr *>(args.dbr), v);
+        CaLatencyStats::recordMonitorLag(v.ts);
+
+        if (self->queue_.size() >= self->limit_) {
+            self->queue_.pop_front();
+            self->dropped_++;
+        }
+        self->queue_.push_back(v);
+
+        if (self->waiter_) {
+            std::shared_ptr<detail::CoWaiter> w = self->waiter_;
+            self->disarm();
+            detail::CoWaiter::complete(w, ECA_NORMAL);
+        }
+    }
+
+    void disarm()
+    {
+        if (timer_) {
+            loop_->cancelTimer(timer_);
+            timer_ = 0;
+        }
+        waiter_.reset();
+    }
+
+    CaEventLoop *loop_;
+    std::shared_ptr<CaChannel> channel_;
+    evid evid_;
+    std::deque<TimedValue<T>> queue_;
+    std::size_t limit_;
+    unsigned long long dropped_;
+    std::shared_ptr<detail::CoWaiter> waiter_;
+    CaEventLoop::TimerId timer_;
+};
+
+// Owns detached tasks started with spawn(). Tasks still suspended when the
+// scope goes away are destroyed, cancelling whatever they were waiting for.
+// Create it after the CaClient so it is destroyed first.
+class CaCoScope {
+public:
+    explicit CaCoScope(CaClient &client) : client_(&client), failures_(0) {}
+
+    ~CaCoScope()
+    {
+        std::unordered_set<void *> tasks;
+        tasks.swap(tasks_);
+        for (void *address : tasks) {
+            std::coroutine_handle<>::from_address(address).destroy();
+        }
+    }
+
+    CaCoScope(const CaCoScope &) = delete;
+    CaCoScope &operator=(const CaCoScope &) = delete;
+
+    CaClient &client() { return *client_; }
+
+    // Runs task up to its first suspension point.
+    void spawn(CaTask<void> task)
+    {
+        CaTask<void>::Handle h = std::exchange(task.h_, CaTask<void>::Handle());
+        h.promise().scope = this;
+        tasks_.insert(h.address());
+        h.resume();
+    }
+
+    std::size_t active() const { return tasks_.size(); }
+    bool idle() const { return tasks_.empty(); }
+
+    // Number of spawned tasks that ended with an exception; rethrow() throws
+    // the first of them (once).
+    std::size_t failures() const { return failures_; }
+
+    void rethrow()
+    {
+        if (firstError_) {
+            std::rethrow_exception(std::exchange(firstError_, std::exception_ptr()));
+        }
+    }
+
+    CaCoConnect connect(const std::string &pvName, double timeoutSec)
+    {
+        return CaCoConnect(*client_, pvName, timeoutSec);
+    }
+
+    CaCoSleep sleep(double seconds) { return CaCoSleep(client_->eventLoop(), seconds); }
+
+private:
+    friend struct detail::TaskPromiseBase::FinalAwaiter;
+
+    void finished(std::coroutine_handle<> h, std::exception_ptr error)
+    {
+        if (error) {
+            failures_++;
+            if (!firstError_) {
+                firstError_ = error;
+            }
+        }
+        tasks_.erase(h.address());
+        h.destroy();
+    }
+
+    CaClient *client_;
+    std::unordered_set<void *> tasks_;
+    std::size_t failures_;
+    std::exception_ptr firstError_;
+};
+
+inline std::coroutine_handle<> detail::TaskPromiseBase::FinalAwaiter::await_suspend(std::coroutine_handle<> h) noexcept
+{
+    if (promise->continuation) {
+        return promise->continuation;
+    }
+    if (promise->scope) {
+        promise->scope->finished(h, promise->error);
+    }
+    return std::noop_coroutine();
+}
+
+} // namespace caClientLib
+
+#endif // CACL_HAVE_COROUTINES
+
+#endif
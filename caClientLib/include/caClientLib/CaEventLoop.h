@@ -0,0 +1,79 @@
+#ifndef CACL_CA_EVENT_LOOP_H
+#define CACL_CA_EVENT_LOOP_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#define CACL_HAVE_EVENT_LOOP 1
+#endif
+
+namespace caClientLib {
+
+#ifdef CACL_HAVE_EVENT_LOOP
+
+// epoll-based event loop for a non-preemptive CA context. CA's file
+// descriptors are added through ca_add_fd_registration(), so the thread
+// sleeps until CA has work instead of polling ca_pend_event() on a fixed
+// period. Timers are multiplexed through a timerfd in the same epoll set.
+//
+// fd() can be added to an external epoll/asio loop: whenever it is readable,
+// call dispatch(). Must be created on the thread owning the CA context.
+class CaEventLoop {
+public:
+    typedef std::function<void()> TimerCallback;
+    typedef unsigned long TimerId;
+
+    CaEventLoop();
+    ~CaEventLoop();
+
+    CaEventLoop(const CaEventLoop &) = delete;
+    CaEventLoop &operator=(const CaEventLoop &) = delete;
+
+    int fd() const { return epollFd_; }
+
+    // periodSec > 0 re-arms the timer after each expiry.
+    TimerId addTimer(double delaySec, TimerCallback cb, double periodSec = 0.0);
+    void cancelTimer(TimerId id);
+
+    // Runs cb from the next runOnce(), after CA callbacks and timers, without
+    // waiting. For work that must not run inside a CA callback.
+    void post(TimerCallback cb) { posted_.push_back(std::move(cb)); }
+
+    // Waits up to maxWaitSec (< 0: no limit) for CA activity or a timer and
+    // handles whatever is ready. Returns the number of ready descriptors.
+    int runOnce(double maxWaitSec);
+
+    // Handles ready descriptors without waiting (for external loops).
+    void dispatch() { runOnce(0.0); }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Timer {
+        Clock::time_point due;
+        Clock::duration period;
+        TimerCallback cb;
+    };
+
+    static void fdRegistration(void *arg, int fd, int opened);
+    void armTimerFd();
+    void runTimers();
+    void runPosted();
+
+    int epollFd_;
+    int timerFd_;
+    TimerId nextId_;
+    std::map<TimerId, Timer> timers_;
+    std::vector<TimerCallback> posted_;
+};
+
+#endif // CACL_HAVE_EVENT_LOOP
+
+} // namespace caClientLib
+
+#endif
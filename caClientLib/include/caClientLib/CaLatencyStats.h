@@ -0,0 +1,45 @@
+#ifndef CACL_CA_LATENCY_STATS_H
+#define CACL_CA_LATENCY_STATS_H
+
+#include "caClientLib/LatencyHistogram.h"
+
+#include <epicsTime.h>
+
+#include <chrono>
+
+namespace caClientLib {
+
+enum class CaMetric {
+    Connect,    // ca_create_channel .. connected
+    Get,        // request .. value received
+    Put,        // request .. put callback (preemptive context, async, group), or
+                // .. ca_pend_io returned after ca_put, which confirms nothing
+    PendIo,     // time spent blocked in ca_pend_io
+    MonitorLag, // client receive time - server dbr_time_* stamp
+};
+
+// Process-wide latency histograms, recorded by CaChannel, CaChannelGroup,
+// CaRequestTracker and the monitor classes. Only successful operations are
+// recorded. MonitorLag compares the local clock with the IOC's, so it
+// includes any clock offset between the two hosts.
+class CaLatencyStats {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static LatencyHistogram &histogram(CaMetric m);
+    static const char *name(CaMetric m);
+
+    static void record(CaMetric m, Clock::time_point start)
+    {
+        histogram(m).record(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()));
+    }
+
+    static void recordMonitorLag(const epicsTimeStamp &serverStamp);
+
+    static void reset();
+};
+
+} // namespace caClientLib
+
+#endif
@@ -1,21 +1,33 @@
 #ifndef CACL_CA_MONITOR_H
 #define CACL_CA_MONITOR_H
 
+#include "caClientLib/CaResult.h"
+#include "caClientLib/InlineString.h"
+
 #include <cadef.h>
 #include <epicsTime.h>
 
+#include <memory>
 #include <string>
+#include <string_view>
 
 namespace caClientLib {
 
+// Delivered without any heap allocation: the PV name refers to storage owned
+// by the monitor (valid for the monitor's lifetime) and the value is held
+// inline. Handlers that keep updates beyond onUpdate() should copy them,
+// e.g. into a MonitorUpdatePool.
 struct MonitorUpdate {
-    std::string pvName;
-    std::string value;
+    std::string_view pvName;
+    InlineString<MAX_STRING_SIZE> value;
     short alarmStatus = 0;
     short alarmSeverity = 0;
     epicsTimeStamp ts{};
 };
 
+// Copies a DBR_TIME_STRING event into u.
+void fillMonitorUpdate(std::string_view pvName, const dbr_time_string &v, MonitorUpdate &u);
+
 class IMonitorHandler {
 public:
     virtual ~IMonitorHandler() = default;
@@ -30,7 +42,13 @@ public:
     CaMonitor(const CaMonitor &) = delete;
     CaMonitor &operator=(const CaMonitor &) = delete;
 
+    // Non-throwing construction; nothing stays subscribed on failure.
+    static CaResult<std::unique_ptr<CaMonitor>> tryCreate(const std::string &pvName, double timeoutSec,
+                                                         IMonitorHandler &handler);
+
 private:
+    CaMonitor(const std::string &pvName, IMonitorHandler &handler);
+    CaError open(double timeoutSec);
     static void callback(struct event_handler_args args);
 
     std::string pvName_;
@@ -0,0 +1,105 @@
+#ifndef CACL_CA_RESULT_H
+#define CACL_CA_RESULT_H
+
+#include "caClientLib/CaStatus.h"
+
+#include <cadef.h>
+
+#include <string>
+#include <utility>
+
+namespace caClientLib {
+
+// A CA status plus the name of the step that produced it (a string literal).
+// Holds no heap state; message() formats the text CaStatus::requireOk()
+// would have thrown, only when it is asked for.
+class CaError {
+public:
+    CaError() : status_(ECA_NORMAL), what_(nullptr) {}
+    CaError(int status, const char *what) : status_(status), what_(what) {}
+
+    bool ok() const { return status_ == ECA_NORMAL; }
+    int status() const { return status_; }
+    const char *what() const { return what_; }
+    const char *caMessage() const { return ca_message(status_); }
+    std::string message() const { return CaStatus::message(status_, what_); }
+
+    void throwIfError() const
+    {
+        if (status_ != ECA_NORMAL) {
+            throw CaStatus::error(status_, what_);
+        }
+    }
+
+private:
+    int status_;
+    const char *what_;
+};
+
+// Non-throwing result of the try* calls: either a value or a CaError.
+// value() throws the usual CaStatus exception when there is none, which is
+// how the throwing wrappers are implemented.
+template <typename T>
+class CaResult {
+public:
+    CaResult(T value) : value_(std::move(value)) {}
+    CaResult(const CaError &error) : error_(error), value_() {}
+
+    bool ok() const { return error_.ok(); }
+    explicit operator bool() const { return ok(); }
+    int status() const { return error_.status(); }
+    const CaError &error() const { return error_; }
+    std::string message() const { return error_.message(); }
+
+    T &value() &
+    {
+        error_.throwIfError();
+        return value_;
+    }
+
+    const T &value() const &
+    {
+        error_.throwIfError();
+        return value_;
+    }
+
+    T value() &&
+    {
+        error_.throwIfError();
+        return std::move(value_);
+    }
+
+    T valueOr(T fallback) const { return ok() ? value_ : fallback; }
+
+    // Unchecked access; only meaningful when ok().
+    T &operator*() { return value_; }
+    const T &operator*() const { return value_; }
+    T *operator->() { return &value_; }
+    const T *operator->() const { return &value_; }
+
+private:
+    CaError error_;
+    T value_;
+};
+
+template <>
+class CaResult<void> {
+public:
+    CaResult() {}
+    CaResult(const CaError &error) : error_(error) {}
+
+    bool ok() const { return error_.ok(); }
+    explicit operator bool() const { return ok(); }
+    int status() const { return error_.status(); }
+    const CaError &error() const { return error_; }
+    std::string message() const { return error_.message(); }
+
+    void value() const { error_.throwIfError(); }
+
+private:
+    CaError error_;
+};
+
+} // namespace caClientLib
+
+#endif
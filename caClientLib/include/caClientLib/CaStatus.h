@@ -3,11 +3,25 @@
 
 #include <cadef.h>
 
+#include <stdexcept>
+#include <string>
+
 namespace caClientLib {
 
 class CaStatus {
 public:
     static void requireOk(int status, const char *what);
+
+    // The exception requireOk() would throw, for handing to a std::promise.
+    static std::runtime_error error(int status, const char *what);
+
+    // "what: <ca_message(status)>", the text carried by error().
+    static std::string message(int status, const char *what);
+
+    // Result of the ca_pend_io() that waited for ch to connect. On a shared
+    // (preemptive) context the wait also covers other threads' requests and
+    // may time out on them; ECA_TIMEOUT with ch connected counts as success.
+    static int connectStatus(int pendStatus, chid ch);
 };
 
 } // namespace caClientLib
@@ -0,0 +1,111 @@
+#ifndef CACL_CA_SUBSCRIPTION_REGISTRY_H
+#define CACL_CA_SUBSCRIPTION_REGISTRY_H
+
+#include "caClientLib/CaChannelCache.h"
+#include "caClientLib/CaMonitor.h"
+#include "caClientLib/CaResult.h"
+
+#include <cadef.h>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace caClientLib {
+
+class CaSubscriptionRegistry;
+
+// One handler's share of a registry subscription; unsubscribes when reset
+// or destroyed. Must not outlive the registry (i.e. the CaClient).
+class CaSubscription {
+public:
+    CaSubscription() : registry_(nullptr), entry_(nullptr), handler_(nullptr) {}
+    ~CaSubscription() { reset(); }
+
+    CaSubscription(CaSubscription &&o) noexcept;
+    CaSubscription &operator=(CaSubscription &&o) noexcept;
+
+    CaSubscription(const CaSubscription &) = delete;
+    CaSubscription &operator=(const CaSubscription &) = delete;
+
+    explicit operator bool() const { return entry_ != nullptr; }
+    void reset();
+
+private:
+    friend class CaSubscriptionRegistry;
+
+    CaSubscription(CaSubscriptionRegistry *registry, void *entry, IMonitorHandler *handler)
+        : registry_(registry), entry_(entry), handler_(handler)
+    {
+    }
+
+    CaSubscriptionRegistry *registry_;
+    void *entry_;
+    IMonitorHandler *handler_;
+};
+
+// Shares CA subscriptions between handlers: one ca_create_subscription per
+// (PV, DBR type, event mask), on the channel from the cache, whose events
+// are fanned out to every registered IMonitorHandler. A handler joining an
+// existing subscription first receives the latest update (CA only sends the
+// current value when a subscription is created). The subscription is
+// cleared when its last handler unsubscribes.
+//
+// Handlers run with the registry lock held, so after unsubscribe returns on
+// another thread the handler will not be called again; a handler may
+// subscribe or unsubscribe from within onUpdate().
+class CaSubscriptionRegistry {
+public:
+    explicit CaSubscriptionRegistry(CaChannelCache &cache);
+    ~CaSubscriptionRegistry();
+
+    CaSubscriptionRegistry(const CaSubscriptionRegistry &) = delete;
+    CaSubscriptionRegistry &operator=(const CaSubscriptionRegistry &) = delete;
+
+    CaResult<CaSubscription> trySubscribe(const std::string &pvName, double timeoutSec, IMonitorHandler &handler,
+                                          long mask = DBE_VALUE | DBE_ALARM);
+
+    CaSubscription subscribe(const std::string &pvName, double timeoutSec, IMonitorHandler &handler,
+                             long mask = DBE_VALUE | DBE_ALARM)
+    {
+        return trySubscribe(pvName, timeoutSec, handler, mask).value();
+    }
+
+    // CA subscriptions held, and handlers attached to them.
+    std::size_t subscriptions() const;
+    std::size_t handlers() const;
+
+private:
+    friend class CaSubscription;
+
+    typedef std::tuple<std::string, chtype, long> Key;
+
+    struct Entry {
+        CaSubscriptionRegistry *registry = nullptr;
+        Key key;
+        std::shared_ptr<CaChannel> channel;
+        evid evid_ = 0;
+        std::vector<IMonitorHandler *> handlers;
+        std::vector<IMonitorHandler *> dispatching; // snapshot taken per event
+        bool inCallback = false;
+        bool released = false; // last handler left during the callback
+        bool haveLast = false;
+        MonitorUpdate last; // pvName refers to channel->pvName()
+    };
+
+    static void callback(struct event_handler_args args);
+    void unsubscribe(void *entry, IMonitorHandler *handler);
+    static void release(Entry *e);
+
+    CaChannelCache &cache_;
+    mutable std::recursive_mutex lock_;
+    std::map<Key, Entry *> entries_;
+};
+
+} // namespace caClientLib
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef CACL_CA_TYPED_MONITOR_H
+#define CACL_CA_TYPED_MONITOR_H
+
+#include "caClientLib/CaLatencyStats.h"
+#include "caClientLib/CaStatus.h"
+#include "caClientLib/DbrTraits.h"
+#include "caClientLib/MonitorPolicy.h"
+
+#include <cadef.h>
+
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace caClientLib {
+
+template <typename T>
+struct TypedUpdate : TimedValue<T> {
+    std::string_view pvName; // owned by the monitor
+};
+
+template <typename T>
+class ITypedMonitorHandler {
+public:
+    virtual ~ITypedMonitorHandler() = default;
+    virtual void onUpdate(const TypedUpdate<T> &u) = 0;
+};
+
+// Scalar monitor delivering native values (DBR_TIME_DOUBLE, DBR_TIME_LONG,
+// DBR_TIME_ENUM, ...) selected at compile time from T.
+//
+// An optional MonitorPolicy adds a client-side deadband and rate limit.
+// A rate-limited update is held and goes out with the next event after the
+// interval, or from poll() if no further event arrives.
+template <typename T>
+class CaTypedMonitor {
+public:
+    CaTypedMonitor(const std::string &pvName, double timeoutSec, ITypedMonitorHandler<T> &handler,
+                   const MonitorPolicy &policy = MonitorPolicy(), long mask = DBE_VALUE | DBE_ALARM);
+    ~CaTypedMonitor();
+
+    CaTypedMonitor(const CaTypedMonitor &) = delete;
+    CaTypedMonitor &operator=(const CaTypedMonitor &) = delete;
+
+    const std::string &pvName() const { return pvName_; }
+
+    // Delivers a held (rate-limited) update whose interval has elapsed.
+    void poll();
+
+    bool holding() const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return gate_.holding();
+    }
+
+    MonitorGate::Clock::time_point nextFlush() const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return gate_.nextAllowed();
+    }
+
+    MonitorGateStats policyStats() const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return gate_.stats();
+    }
+
+private:
+    static void callback(struct event_handler_args args);
+    void offer(const TypedUpdate<T> &u);
+
+    std::string pvName_;
+    chid chid_;
+    evid evid_;
+    ITypedMonitorHandler<T> *handler_;
+
+    mutable std::mutex lock_; // callback vs poll() on preemptive contexts
+    MonitorGate gate_;
+    TypedUpdate<T> held_;
+};
+
+template <typename T>
+CaTypedMonitor<T>::CaTypedMonitor(const std::string &pvName, double timeoutSec,
+                                  ITypedMonitorHandler<T> &handler, const MonitorPolicy &policy,
+                                  long mask)
+    : pvName_(pvName), chid_(0), evid_(0), handler_(&handler), gate_(policy)
+{
+    int st = ca_create_channel(pvName_.c_str(), 0, 0, CA_PRIORITY_DEFAULT, &chid_);
+    CaStatus::requireOk(st, "ca_create_channel");
+
+    st = CaStatus::connectStatus(ca_pend_io(timeoutSec), chid_);
+    if (st != ECA_NORMAL) {
+        ca_clear_channel(chid_);
+        chid_ = 0;
+    }
+    CaStatus::requireOk(st, "ca_pend_io (connect)");
+
+    st = ca_create_subscription(
+        DbrTraits<T>::timeType,
+        1,
+        chid_,
+        mask,
+        &CaTypedMonitor<T>::callback,
+        this,
+        &evid_);
+    if (st != ECA_NORMAL) {
+        ca_clear_channel(chid_);
+        chid_ = 0;
+    }
+    CaStatus::requireOk(st, "ca_create_subscription");
+}
+
+template <typename T>
+CaTypedMonitor<T>::~CaTypedMonitor()
+{
+    if (evid_) {
+        ca_clear_subscription(evid_);
+    }
+    if (chid_) {
+        ca_clear_channel(chid_);
+    }
+}
+
+template <typename T>
+void CaTypedMonitor<T>::callback(struct event_handler_args args)
+{
+    if (args.status != ECA_NORMAL || args.dbr == 0) {
+        return;
+    }
+
+    CaTypedMonitor<T> *self = static_cast<CaTypedMonitor<T> *>(args.usr);
+    if (!self || !self->handler_) {
+        return;
+    }
+
+    TypedUpdate<T> u;
+    fromTimeDbr<T>(*static_cast<const typename DbrTraits<T>::TimeDbr *>(args.dbr), u);
+    u.pvName = self->pvName_;
+    CaLatencyStats::recordMonitorLag(u.ts);
+
+    if (!self->gate_.policy().active()) {
+        self->handler_->onUpdate(u);
+        return;
+    }
+    self->offer(u);
+}
+
+template <typename T>
+void CaTypedMonitor<T>::offer(const TypedUpdate<T> &u)
+{
+    const MonitorGate::Clock::time_point now = MonitorGate::Clock::now();
+    std::unique_lock<std::mutex> guard(lock_);
+
+    TypedUpdate<T> due;
+    bool flushHeld = false;
+    if (gate_.holdDue(now)) {
+        due = held_;
+        gate_.takeHeld(now);
+        flushHeld = true;
+    }
+
+    const MonitorGate::Decision d = gate_.offer(true, static_cast<double>(u.value), u.alarmSeverity, now);
+    if (d == MonitorGate::Hold) {
+        held_ = u;
+    }
+    guard.unlock();
+
+    if (flushHeld) {
+        handler_->onUpdate(due);
+    }
+    if (d == MonitorGate::Deliver) {
+        handler_->onUpdate(u);
+    }
+}
+
+template <typename T>
+void CaTypedMonitor<T>::poll()
+{
+    const MonitorGate::Clock::time_point now = MonitorGate::Clock::now();
+    std::unique_lock<std::mutex> guard(lock_);
+    if (!gate_.holdDue(now)) {
+        return;
+    }
+    TypedUpdate<T> due = held_;
+    gate_.takeHeld(now);
+    guard.unlock();
+
+    handler_->onUpdate(due);
+}
+
+} // namespace caClientLib
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef CACL_CAPTURE_FORMAT_H
+#define CACL_CAPTURE_FORMAT_H
+
+#include <epicsTime.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace caClientLib {
+namespace capture {
+
+// On-disk layout of a monitor capture file (host byte order):
+//
+//   FileHeader                      padded to kHeaderBytes
+//   block, block, ...               each BlockHeader + payload, 8-byte aligned
+//
+// Block payloads by kind:
+//   Dictionary  count names, each u16 length + bytes; ids pvId .. pvId+count-1
+//   Data        one PV, count samples stored column by column:
+//               i64 ns[count], f64 value[count], i16 status[count], i16 severity[count]
+//               Rows are sorted by ns within a block. IOC stamps are not
+//               monotonic, so blocks of one PV may overlap in time; their
+//               firstNs/lastNs are the block's min/max ns.
+//   Index       u64 offset of the previous index block (0 = none), then
+//               count IndexEntry records for the blocks written since it
+//
+// FileHeader::lastIndex points at the newest index block, so a reader finds
+// every block by following the chain without scanning the data.
+const char kMagic[8] = {'C', 'A', 'C', 'A', 'P', 'T', 'R', '1'};
+const std::uint32_t kVersion = 1;
+const std::size_t kHeaderBytes = 4096;
+
+enum BlockKind : std::uint32_t {
+    Dictionary = 1,
+    Data = 2,
+    Index = 3,
+};
+
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t headerBytes;
+    std::uint64_t dataEnd;   // end of the last complete block
+    std::uint64_t lastIndex; // offset of the newest index block, 0 = none
+    std::uint64_t samples;
+    std::uint32_t pvCount;
+    std::uint32_t reserved;
+    std::int64_t firstNs; // INT64_MAX while empty
+    std::int64_t lastNs;  // INT64_MIN while empty
+};
+
+struct BlockHeader {
+    std::uint32_t kind;
+    std::uint32_t pvId;
+    std::uint32_t count;
+    std::uint32_t bytes; // header + payload + padding
+    std::int64_t firstNs;
+    std::int64_t lastNs;
+};
+
+struct IndexEntry {
+    std::uint64_t offset;
+    std::uint32_t kind;
+    std::uint32_t pvId;
+    std::uint32_t count;
+    std::uint32_t reserved;
+    std::int64_t firstNs;
+    std::int64_t lastNs;
+};
+
+static_assert(sizeof(FileHeader) == 64, "capture FileHeader layout");
+static_assert(sizeof(BlockHeader) == 32, "capture BlockHeader layout");
+static_assert(sizeof(IndexEntry) == 40, "capture IndexEntry layout");
+
+inline std::size_t align8(std::size_t n)
+{
+    return (n + 7) & ~static_cast<std::size_t>(7);
+}
+
+inline std::size_t dataBlockBytes(std::size_t count)
+{
+    return sizeof(BlockHeader) + align8(count * (sizeof(std::int64_t) + sizeof(double) + 2 * sizeof(std::int16_t)));
+}
+
+// Timestamps are stored as nanoseconds past the EPICS epoch.
+inline std::int64_t toNs(const epicsTimeStamp &ts)
+{
+    return static_cast<std::int64_t>(ts.secPastEpoch) * 1000000000LL + ts.nsec;
+}
+
+inline epicsTimeStamp fromNs(std::int64_t ns)
+{
+    epicsTimeStamp ts;
+    ts.secPastEpoch = static_cast<std::uint32_t>(ns / 1000000000LL);
+    ts.nsec = static_cast<std::uint32_t>(ns % 1000000000LL);
+    return ts;
+}
+
+} // namespace capture
+} // namespace caClientLib
+
+#endif
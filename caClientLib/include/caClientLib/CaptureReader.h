@@ -0,0 +1,148 @@
+#ifndef CACL_CAPTURE_READER_H
+#define CACL_CAPTURE_READER_H
+
+#include "caClientLib/CaMonitor.h"
+#include "caClientLib/CaptureFormat.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace caClientLib {
+
+struct CaptureSample {
+    std::int64_t ns;
+    double value;
+    short status;
+    short severity;
+};
+
+struct CaptureBin {
+    std::int64_t startNs;
+    std::uint64_t count;
+    double min;
+    double max;
+    double mean;
+};
+
+struct ReplayOptions {
+    double speed = 1.0; // 1 = original pacing, 2 = twice as fast, 0 = no delays
+    std::int64_t fromNs = std::numeric_limits<std::int64_t>::min();
+    std::int64_t toNs = std::numeric_limits<std::int64_t>::max();
+};
+
+// Read-only view of a capture file written by CaptureWriter. The file is
+// memory-mapped and only the index chain is read up front; scan() picks the
+// blocks whose time range overlaps the requested window from the index and
+// binary-searches their (sorted) timestamp columns, so only the touched
+// blocks are paged in. Blocks of one PV may overlap in time (IOC stamps are
+// not monotonic); scan() merges them, so no sample is skipped or repeated.
+class CaptureReader {
+public:
+    explicit CaptureReader(const std::string &path);
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader &operator=(const CaptureReader &) = delete;
+
+    std::size_t pvCount() const { return names_.size(); }
+    const std::string &pvName(std::uint32_t pvId) const { return names_[pvId]; }
+    bool findPv(const std::string &pvName, std::uint32_t &pvId) const;
+
+    std::uint64_t samples() const { return header_.samples; }
+    std::uint64_t samples(std::uint32_t pvId) const;
+    std::int64_t firstNs() const { return header_.firstNs; }
+    std::int64_t lastNs() const { return header_.lastNs; }
+
+    // Calls fn(pvId, sample) for every sample of pvIds with fromNs <= ns < toNs
+    // in time order (merged across PVs). fn returns false to stop early.
+    template <typename Fn>
+    void scan(const std::vector<std::uint32_t> &pvIds, std::int64_t fromNs, std::int64_t toNs, Fn fn) const;
+
+    // min/max/mean per binNs-wide bucket of one PV; empty buckets are omitted.
+    std::vector<CaptureBin> bins(std::uint32_t pvId, std::int64_t fromNs, std::int64_t toNs, std::int64_t binNs) const;
+
+    // Feeds the samples to handler as MonitorUpdates (value formatted with
+    // %.15g), sleeping between them to reproduce the recorded spacing divided
+    // by opt.speed. Returns the number of updates delivered.
+    std::uint64_t replay(const std::vector<std::uint32_t> &pvIds, IMonitorHandler &handler,
+                         const ReplayOptions &opt = ReplayOptions()) const;
+
+private:
+    struct BlockRef {
+        std::uint64_t offset;
+        std::uint32_t count;
+        std::int64_t firstNs;
+        std::int64_t lastNs;
+    };
+
+    // Position inside one block of a PV.
+    struct Cursor {
+        std::uint32_t pvId;
+        std::size_t block;
+        std::size_t row;
+    };
+
+    struct Columns {
+        const std::int64_t *ns;
+        const double *value;
+        const std::int16_t *status;
+        const std::int16_t *severity;
+        std::size_t count;
+    };
+
+    Columns columns(const BlockRef &b) const;
+    // Cursors at the first in-window row of every block overlapping
+    // [fromNs, toNs), ordered by that row's time.
+    std::vector<Cursor> openBlocks(const std::vector<std::uint32_t> &pvIds, std::int64_t fromNs,
+                                   std::int64_t toNs) const;
+    bool valid(const Cursor &c, std::int64_t toNs) const;
+    void advance(Cursor &c) const;
+    CaptureSample sample(const Cursor &c) const;
+    std::int64_t timeOf(const Cursor &c) const;
+
+    std::string path_;
+    const char *data_;
+    std::size_t size_;
+    capture::FileHeader header_;
+    std::vector<std::string> names_;
+    std::vector<std::vector<BlockRef>> blocks_; // per PV, ordered by firstNs
+};
+
+template <typename Fn>
+void CaptureReader::scan(const std::vector<std::uint32_t> &pvIds, std::int64_t fromNs, std::int64_t toNs, Fn fn) const
+{
+    const std::vector<Cursor> blocks = openBlocks(pvIds, fromNs, toNs);
+    std::size_t next = 0;
+
+    // k-way merge on the next timestamp of each open block. A block is only
+    // opened once the merge reaches its first row, which keeps the heap
+    // small when blocks follow each other in time.
+    std::vector<Cursor> cursors;
+    auto later = [this](const Cursor &a, const Cursor &b) { return timeOf(a) > timeOf(b); };
+    while (next < blocks.size() || !cursors.empty()) {
+        while (next < blocks.size() && (cursors.empty() || timeOf(blocks[next]) <= timeOf(cursors.front()))) {
+            cursors.push_back(blocks[next++]);
+            std::push_heap(cursors.begin(), cursors.end(), later);
+        }
+
+        std::pop_heap(cursors.begin(), cursors.end(), later);
+        Cursor &c = cursors.back();
+        if (!fn(c.pvId, sample(c))) {
+            return;
+        }
+        advance(c);
+        if (valid(c, toNs)) {
+            std::push_heap(cursors.begin(), cursors.end(), later);
+        } else {
+            cursors.pop_back();
+        }
+    }
+}
+
+} // namespace caClientLib
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef CACL_CAPTURE_WRITER_H
+#define CACL_CAPTURE_WRITER_H
+
+#include "caClientLib/CaptureFormat.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace caClientLib {
+
+struct CaptureWriterOptions {
+    std::size_t blockSamples = 1024;       // samples per PV before a block is sealed
+    std::size_t indexEvery = 64;           // sealed blocks per index block
+    std::size_t mapBytes = 16u << 20;      // size of the mapped tail window
+};
+
+// Append-only writer for the capture format in CaptureFormat.h. Each PV
+// fills a fixed-size column buffer; full buffers are copied into a mapped
+// window at the file tail, so memory stays at roughly
+// pvCount * dataBlockBytes(blockSamples) + mapBytes regardless of file size.
+// Not thread-safe: call from the thread that dispatches the monitors.
+class CaptureWriter {
+public:
+    explicit CaptureWriter(const std::string &path, const CaptureWriterOptions &opt = CaptureWriterOptions());
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+    std::uint32_t addPv(const std::string &pvName);
+
+    void append(std::uint32_t pvId, const epicsTimeStamp &ts, double value, short status, short severity)
+    {
+        Column &c = columns_[pvId];
+        if (c.count == opt_.blockSamples) {
+            sealBlock(pvId);
+        }
+        const std::size_t i = c.count++;
+        c.ns[i] = capture::toNs(ts);
+        c.value[i] = value;
+        c.status[i] = status;
+        c.severity[i] = severity;
+    }
+
+    // Seals every partially filled block and writes an index block, so that
+    // everything appended so far is visible to readers.
+    void flush();
+    void close();
+
+    std::uint64_t samples() const;
+    std::uint64_t bytes() const { return tail_; }
+
+private:
+    struct Column {
+        std::size_t count = 0;
+        std::vector<std::int64_t> ns;
+        std::vector<double> value;
+        std::vector<std::int16_t> status;
+        std::vector<std::int16_t> severity;
+    };
+
+    char *reserve(std::size_t bytes);
+    void sealBlock(std::uint32_t pvId);
+    void writeIndex();
+    void writeHeader();
+
+    CaptureWriterOptions opt_;
+    std::string path_;
+    int fd_;
+    std::size_t pageBytes_;
+    capture::FileHeader header_;
+    std::uint64_t tail_;        // next block offset
+    std::uint64_t fileBytes_;   // current file length
+    char *window_;
+    std::uint64_t windowStart_;
+    std::size_t windowBytes_;
+    std::vector<Column> columns_;
+    std::vector<capture::IndexEntry> pendingIndex_;
+};
+
+} // namespace caClientLib
+
+#endif
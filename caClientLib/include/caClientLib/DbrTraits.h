@@ -0,0 +1,78 @@
+#ifndef CACL_DBR_TRAITS_H
+#define CACL_DBR_TRAITS_H
+
+#include <cadef.h>
+#include <epicsTime.h>
+
+namespace caClientLib {
+
+// Compile-time mapping from C++ value types to native CA DBR types, so typed
+// requests travel as binary values instead of DBR_STRING text.
+// Unsupported types fail to compile (no primary definition).
+template <typename T>
+struct DbrTraits;
+
+template <>
+struct DbrTraits<dbr_double_t> {
+    static const chtype plainType = DBR_DOUBLE;
+    static const chtype timeType = DBR_TIME_DOUBLE;
+    typedef dbr_time_double TimeDbr;
+};
+
+template <>
+struct DbrTraits<dbr_float_t> {
+    static const chtype plainType = DBR_FLOAT;
+    static const chtype timeType = DBR_TIME_FLOAT;
+    typedef dbr_time_float TimeDbr;
+};
+
+template <>
+struct DbrTraits<dbr_long_t> {
+    static const chtype plainType = DBR_LONG;
+    static const chtype timeType = DBR_TIME_LONG;
+    typedef dbr_time_long TimeDbr;
+};
+
+template <>
+struct DbrTraits<dbr_short_t> {
+    static const chtype plainType = DBR_SHORT;
+    static const chtype timeType = DBR_TIME_SHORT;
+    typedef dbr_time_short TimeDbr;
+};
+
+template <>
+struct DbrTraits<dbr_enum_t> {
+    static const chtype plainType = DBR_ENUM;
+    static const chtype timeType = DBR_TIME_ENUM;
+    typedef dbr_time_enum TimeDbr;
+};
+
+template <>
+struct DbrTraits<dbr_char_t> {
+    static const chtype plainType = DBR_CHAR;
+    static const chtype timeType = DBR_TIME_CHAR;
+    typedef dbr_time_char TimeDbr;
+};
+
+template <typename T>
+struct TimedValue {
+    T value{};
+    short alarmStatus = 0;
+    short alarmSeverity = 0;
+    epicsTimeStamp ts{};
+};
+
+// Copies value, alarm and time stamp out of a DBR_TIME_* structure.
+template <typename T>
+inline void fromTimeDbr(const typename DbrTraits<T>::TimeDbr &dbr, TimedValue<T> &out)
+{
+    out.value = dbr.value;
+    out.alarmStatus = dbr.status;
+    out.alarmSeverity = dbr.severity;
+    out.ts.secPastEpoch = dbr.stamp.secPastEpoch;
+    out.ts.nsec = dbr.stamp.nsec;
+}
+
+} // namespace caClientLib
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef CACL_INLINE_STRING_H
+#define CACL_INLINE_STRING_H
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace caClientLib {
+
+// Fixed-capacity, NUL-terminated string stored inline (no heap). Longer
+// input is truncated to N - 1 characters.
+template <std::size_t N>
+class InlineString {
+    static_assert(N > 0 && N <= 256, "InlineString capacity must fit the length byte");
+
+public:
+    InlineString() : len_(0) { buf_[0] = '\0'; }
+    InlineString(std::string_view s) { assign(s); }
+
+    InlineString &operator=(std::string_view s)
+    {
+        assign(s);
+        return *this;
+    }
+
+    void assign(std::string_view s)
+    {
+        const std::size_t n = s.size() < N - 1 ? s.size() : N - 1;
+        std::memcpy(buf_, s.data(), n);
+        buf_[n] = '\0';
+        len_ = static_cast<unsigned char>(n);
+    }
+
+    // Bounded copy of a C buffer that may lack a terminator (e.g. dbr_string_t).
+    void assign(const char *s, std::size_t maxLen)
+    {
+        const std::size_t limit = maxLen < N - 1 ? maxLen : N - 1;
+        const void *nul = std::memchr(s, '\0', limit);
+        assign(std::string_view(s, nul ? static_cast<const char *>(nul) - s : limit));
+    }
+
+    const char *c_str() const { return buf_; }
+    const char *data() const { return buf_; }
+    std::size_t size() const { return len_; }
+    bool empty() const { return len_ == 0; }
+    static constexpr std::size_t capacity() { return N - 1; }
+
+    std::string_view view() const { return std::string_view(buf_, len_); }
+    operator std::string_view() const { return view(); }
+    std::string str() const { return std::string(buf_, len_); }
+
+private:
+    char buf_[N];
+    unsigned char len_;
+};
+
+template <std::size_t N>
+inline bool operator==(const InlineString<N> &a, std::string_view b)
+{
+    return a.view() == b;
+}
+
+template <std::size_t N>
+inline std::ostream &operator<<(std::ostream &os, const InlineString<N> &s)
+{
+    return os.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+} // namespace caClientLib
+
+#endif
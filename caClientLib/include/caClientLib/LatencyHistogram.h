@@ -0,0 +1,58 @@
+#ifndef CACL_LATENCY_HISTOGRAM_H
+#define CACL_LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace caClientLib {
+
+struct LatencySummary {
+    std::uint64_t count = 0;
+    std::uint64_t minNs = 0;
+    std::uint64_t maxNs = 0;
+    double meanNs = 0.0;
+    std::uint64_t p50Ns = 0;
+    std::uint64_t p90Ns = 0;
+    std::uint64_t p99Ns = 0;
+    std::uint64_t p999Ns = 0;
+};
+
+// HDR-style log-linear histogram of nanosecond latencies: 16 linear
+// sub-buckets per power of two (relative error < 1/16), values above ~36 min
+// clamp into the top bucket. record() is lock-free and allocation-free and may
+// be called from any thread, including CA callback threads.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    void record(std::uint64_t ns);
+
+    std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+    // q in [0, 1]; returns the upper bound of the bucket holding that rank.
+    std::uint64_t percentile(double q) const;
+    LatencySummary summary() const;
+
+    // Not atomic with respect to concurrent record() calls.
+    void reset();
+
+private:
+    enum { kSubBits = 4, kSub = 1 << kSubBits, kMaxBit = 41, kBuckets = (kMaxBit - 1 - kSubBits) * kSub + 2 * kSub };
+
+    static std::size_t bucketIndex(std::uint64_t ns);
+    static std::uint64_t bucketUpper(std::size_t idx);
+
+    std::atomic<std::uint64_t> buckets_[kBuckets];
+    std::atomic<std::uint64_t> count_;
+    std::atomic<std::uint64_t> sum_;
+    std::atomic<std::uint64_t> min_;
+    std::atomic<std::uint64_t> max_;
+};
+
+} // namespace caClientLib
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef CACL_MONITOR_HUB_H
+#define CACL_MONITOR_HUB_H
+
+#include "caClientLib/BoundedRing.h"
+#include "caClientLib/CaMonitor.h"
+#include "caClientLib/MonitorPolicy.h"
+
+#include <cadef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace caClientLib {
+
+struct MonitorHubStats {
+    std::size_t queueDepth = 0;
+    std::size_t queueHighWater = 0;
+    std::size_t queueCapacity = 0;
+    unsigned long long received = 0;   // events taken from CA
+    unsigned long long delivered = 0;  // events handed to the consumer
+    unsigned long long dropped = 0;    // events lost to queue overflow
+    unsigned long long suppressed = 0; // filtered by a deadband
+    unsigned long long coalesced = 0;  // superseded while rate limited
+};
+
+// Subscribes to many PVs and decouples CA from the consumer: CA callbacks
+// (running preemptively on CA's threads) only push into a bounded lock-free
+// ring, and a dedicated thread calls IMonitorHandler::onUpdate(). What
+// happens when the consumer falls behind is chosen by OverflowPolicy.
+//
+// Each subscription may carry a MonitorPolicy (deadband on the numeric
+// value, maximum delivery rate with latest-value coalescing). Held values
+// are flushed by the consumer thread when their interval elapses.
+//
+// Requires the calling thread's CA context to be preemptive
+// (CaContext::Preemptive / CaClient(CaContext::Preemptive)).
+class MonitorHub {
+public:
+    explicit MonitorHub(IMonitorHandler &consumer, std::size_t queueCapacity = 4096,
+                        OverflowPolicy overflow = OverflowPolicy::DropNewest);
+    ~MonitorHub();
+
+    MonitorHub(const MonitorHub &) = delete;
+    MonitorHub &operator=(const MonitorHub &) = delete;
+
+    void subscribe(const std::string &pvName, double timeoutSec, const MonitorPolicy &policy = MonitorPolicy());
+
+    // Connects all PVs with a single wait. PVs that fail to connect are
+    // returned; the rest are subscribed. Delivery continues during the wait,
+    // and subscribing from onUpdate() is allowed (that thread must be
+    // attached to the CA context).
+    std::vector<std::string> subscribe(const std::vector<std::string> &pvNames, double timeoutSec,
+                                       const MonitorPolicy &policy = MonitorPolicy());
+
+    void start();
+    void stop(); // drains what is already queued, then joins the consumer
+
+    MonitorHubStats stats() const;
+
+private:
+    struct Subscription {
+        MonitorHub *hub = nullptr;
+        std::string pvName;
+        chid chid_ = 0;
+        evid evid_ = 0;
+
+        mutable std::mutex lock; // gate + held, shared by the CA thread and the consumer
+        MonitorGate gate;
+        MonitorUpdate held;
+    };
+
+    static void callback(struct event_handler_args args);
+    void enqueue(Subscription &sub, const dbr_time_string &v);
+    void push(const MonitorUpdate &u);
+    void deliver(const MonitorUpdate &u);
+    void wakeConsumer();
+    MonitorGate::Clock::time_point flushHeld();
+    void consumerLoop();
+    int subscribeConnected(Subscription &sub);
+    void unsubscribeAll();
+
+    IMonitorHandler *consumer_;
+    const OverflowPolicy overflow_;
+    BoundedRing<MonitorUpdate> ring_;
+
+    mutable std::mutex subsLock_;  // guards the list structure
+    std::list<Subscription> subs_; // stable addresses: used as CA user pointers
+
+    std::vector<MonitorUpdate> flushing_; // consumer thread only; reused by flushHeld()
+
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<bool> sleeping_;
+    std::atomic<bool> anyHeld_;
+    std::mutex wakeLock_;
+    std::condition_variable wake_;
+
+    std::atomic<unsigned long long> received_;
+    std::atomic<unsigned long long> delivered_;
+    std::atomic<unsigned long long> dropped_;
+    std::atomic<std::size_t> highWater_;
+};
+
+} // namespace caClientLib
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef CACL_MONITOR_POLICY_H
+#define CACL_MONITOR_POLICY_H
+
+#include <chrono>
+
+namespace caClientLib {
+
+// What a queue does when its consumer falls behind.
+enum class OverflowPolicy {
+    DropNewest, // discard the incoming update
+    DropOldest, // discard the oldest queued update to make room
+    Block,      // wait for room (stalls the CA thread delivering the event)
+};
+
+// Client-side filtering applied per monitor before delivery.
+struct MonitorPolicy {
+    double absDeadband = 0.0; // suppress changes with |v - last| <= absDeadband
+    double relDeadband = 0.0; // ... or <= relDeadband * |last| (e.g. 0.01 = 1 %)
+    double maxRateHz = 0.0;   // deliver at most this often; extra updates coalesce
+                              // to the latest value (0 = unlimited)
+
+    bool active() const { return absDeadband > 0.0 || relDeadband > 0.0 || maxRateHz > 0.0; }
+};
+
+struct MonitorGateStats {
+    unsigned long long passed = 0;     // delivered (including flushed held values)
+    unsigned long long suppressed = 0; // inside the deadband
+    unsigned long long coalesced = 0;  // superseded by a newer value while rate limited
+};
+
+// Per-monitor deadband and rate-limit state. Not thread-safe: callers
+// serialize offer()/takeHeld() for one monitor.
+//
+// offer() decides what happens to an incoming update: deliver it now, hold
+// it as the latest pending value until the rate limit allows, or suppress
+// it. A held value is delivered by the caller once holdDue() turns true
+// (the caller then reports it via takeHeld()). Any newer update supersedes
+// the held value, including one suppressed by the deadband.
+class MonitorGate {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum Decision { Deliver, Hold, Suppress };
+
+    explicit MonitorGate(const MonitorPolicy &policy = MonitorPolicy());
+
+    // numeric == false disables the deadband check for this update (e.g.
+    // a string value that does not parse). An alarm severity change always
+    // passes the deadband.
+    Decision offer(bool numeric, double value, short severity, Clock::time_point now);
+
+    bool holding() const { return holding_; }
+    bool holdDue(Clock::time_point now) const { return holding_ && now >= nextAllowed_; }
+    Clock::time_point nextAllowed() const { return nextAllowed_; }
+
+    // The held value has been delivered.
+    void takeHeld(Clock::time_point now);
+
+    const MonitorPolicy &policy() const { return policy_; }
+    const MonitorGateStats &stats() const { return stats_; }
+
+private:
+    void delivered(Clock::time_point now);
+
+    MonitorPolicy policy_;
+    Clock::duration minInterval_;
+    MonitorGateStats stats_;
+
+    bool hasLast_;
+    double last_;
+    short lastSeverity_;
+
+    bool holding_;
+    bool heldNumeric_;
+    double heldValue_;
+    short heldSeverity_;
+    Clock::time_point nextAllowed_;
+};
+
+} // namespace caClientLib
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef CACL_MONITOR_UPDATE_POOL_H
+#define CACL_MONITOR_UPDATE_POOL_H
+
+#include "caClientLib/CaMonitor.h"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace caClientLib {
+
+// Owning copy of a MonitorUpdate for handlers that keep updates after
+// onUpdate() returns.
+struct RetainedMonitorUpdate {
+    std::string pvName;
+    InlineString<MAX_STRING_SIZE> value;
+    short alarmStatus = 0;
+    short alarmSeverity = 0;
+    epicsTimeStamp ts{};
+
+    void assign(const MonitorUpdate &u);
+    MonitorUpdate view() const; // non-owning view, valid while *this lives
+};
+
+// Recycles RetainedMonitorUpdate objects so retaining an update does not
+// allocate in steady state (the name's capacity is reused as well).
+// Handles may be released from any thread; the pool must outlive them.
+//
+// The free list holds at most max(preallocate, maxFree) entries and is
+// reserved up front, so releasing a handle never allocates. retain()
+// allocates only while the free list is empty; handles released while it is
+// full are deleted.
+class MonitorUpdatePool {
+public:
+    struct Recycler {
+        MonitorUpdatePool *pool;
+        void operator()(RetainedMonitorUpdate *p) const { pool->recycle(p); }
+    };
+    typedef std::unique_ptr<RetainedMonitorUpdate, Recycler> Handle;
+
+    explicit MonitorUpdatePool(std::size_t preallocate = 0, std::size_t maxFree = 256);
+    ~MonitorUpdatePool();
+
+    MonitorUpdatePool(const MonitorUpdatePool &) = delete;
+    MonitorUpdatePool &operator=(const MonitorUpdatePool &) = delete;
+
+    Handle retain(const MonitorUpdate &u);
+
+    std::size_t available() const;
+    std::size_t capacity() const { return capacity_; }
+
+private:
+    void recycle(RetainedMonitorUpdate *p);
+
+    std::size_t capacity_;
+    mutable std::mutex lock_;
+    std::vector<RetainedMonitorUpdate *> free_;
+};
+
+} // namespace caClientLib
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef CACL_SHM_RING_H
+#define CACL_SHM_RING_H
+
+#include "caClientLib/CaMonitor.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace caClientLib {
+namespace shm {
+
+// Layout of one POSIX shared-memory object per PV (host byte order, same
+// host only):
+//
+//   SegmentHeader                   64-byte aligned
+//   Slot[capacity]                  capacity is a power of two
+//
+// Update i (0-based) goes to slot i & (capacity - 1). The single writer sets
+// the slot's seq to 2i+1, fills the payload, sets seq to 2i+2 and then
+// publishes head = i+1. A reader copies a slot and accepts it only if seq was
+// 2i+2 both before and after the copy, so it never blocks the writer and
+// detects slots overwritten while it was reading.
+const char kMagic[8] = {'C', 'A', 'S', 'H', 'M', 'R', 'G', '1'};
+const std::uint32_t kVersion = 1;
+const std::size_t kPvNameBytes = 64;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared-memory ring needs lock-free 64-bit atomics");
+
+enum SegmentState : std::uint32_t {
+    Live = 1,
+    Closed = 2, // no writer attached; a reopened writer sets Live again unless it replaced the segment
+};
+
+struct alignas(64) SegmentHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t capacity;
+    std::atomic<std::uint64_t> generation; // writer start time (ns); changes when a writer re-initializes the ring
+    std::atomic<std::uint32_t> state;
+    std::uint32_t reserved;
+    char pvName[kPvNameBytes];
+    alignas(64) std::atomic<std::uint64_t> head; // updates published so far
+};
+
+struct alignas(64) Slot {
+    std::atomic<std::uint64_t> seq;
+    std::uint32_t secPastEpoch;
+    std::uint32_t nsec;
+    std::int16_t status;
+    std::int16_t severity;
+    std::uint16_t length;
+    std::uint16_t reserved;
+    char value[MAX_STRING_SIZE];
+};
+
+static_assert(sizeof(Slot) == 64, "Slot must fill one cache line");
+
+} // namespace shm
+
+// Name of the shared-memory object for pvName ("/cacl.<pv>", '/' replaced).
+std::string shmRingName(const std::string &pvName);
+
+// Publishes MonitorUpdates of one PV into its shared-memory ring; use it as
+// the handler of a monitor or subscription. Only one writer per PV may exist
+// on a host (enforced with flock); a restarted writer re-initializes the
+// existing segment, so attached readers keep following it. A segment with a
+// different capacity is unlinked and replaced instead; its readers must reopen.
+class ShmRingWriter final : public IMonitorHandler {
+public:
+    // capacity is rounded up to a power of two.
+    explicit ShmRingWriter(const std::string &pvName, std::size_t capacity = 1024, bool unlinkOnClose = false);
+    ~ShmRingWriter() override;
+
+    ShmRingWriter(const ShmRingWriter &) = delete;
+    ShmRingWriter &operator=(const ShmRingWriter &) = delete;
+
+    void onUpdate(const MonitorUpdate &u) override { publish(u); }
+    void publish(const MonitorUpdate &u);
+
+    const std::string &name() const { return name_; }
+    std::size_t capacity() const { return mask_ + 1; }
+    std::uint64_t published() const { return next_; }
+
+private:
+    std::string pvName_;
+    std::string name_;
+    bool unlinkOnClose_;
+    int fd_;
+    void *map_;
+    std::size_t mapBytes_;
+    shm::SegmentHeader *header_;
+    shm::Slot *slots_;
+    std::size_t mask_;
+    std::uint64_t next_;
+};
+
+// Lock-free view of a PV's ring published by a ShmRingWriter, possibly in
+// another process. latest() costs a few loads and a 64-byte copy; next()
+// tails the ring with a private cursor and reports updates it missed.
+// A reader is not thread-safe; use one per thread.
+class ShmRingReader {
+public:
+    explicit ShmRingReader(const std::string &pvName);
+    ~ShmRingReader();
+
+    ShmRingReader(const ShmRingReader &) = delete;
+    ShmRingReader &operator=(const ShmRingReader &) = delete;
+
+    const std::string &pvName() const { return pvName_; }
+    std::size_t capacity() const { return mask_ + 1; }
+    std::uint64_t published() const { return header_->head.load(std::memory_order_acquire); }
+    bool writerClosed() const { return header_->state.load(std::memory_order_acquire) == shm::Closed; }
+
+    // Most recent update; false if nothing has been published yet.
+    bool latest(MonitorUpdate &out) const;
+
+    // Next update after the cursor; false when caught up. Updates overwritten
+    // before they could be read are skipped and added to *lost. The cursor
+    // starts at the current head (only new updates) and restarts at 0 when a
+    // new writer re-initializes the ring.
+    bool next(MonitorUpdate &out, std::uint64_t *lost = nullptr);
+
+    void seekToLatest() { cursor_ = published(); }
+    void seekToOldest();
+
+private:
+    bool read(std::uint64_t index, MonitorUpdate &out) const;
+    void checkGeneration();
+
+    std::string pvName_;
+    std::string name_;
+    const void *map_;
+    std::size_t mapBytes_;
+    const shm::SegmentHeader *header_;
+    const shm::Slot *slots_;
+    std::size_t mask_;
+    std::uint64_t generation_;
+    std::uint64_t cursor_;
+};
+
+} // namespace caClientLib
+
+#endif
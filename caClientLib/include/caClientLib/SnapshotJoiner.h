@@ -0,0 +1,145 @@
+#ifndef CACL_SNAPSHOT_JOINER_H
+#define CACL_SNAPSHOT_JOINER_H
+
+#include "caClientLib/CaTypedMonitor.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace caClientLib {
+
+enum class JoinMode {
+    NearestBefore, // newest sample at or before the row time
+    Exact,         // sample nearest to the row time, if within toleranceNs
+    Interpolate,   // linear between the samples around the row time; past the newest sample it is held
+};
+
+// Row times are EPICS-epoch nanoseconds, compared with the DBR_TIME_* stamps
+// set by the IOC.
+struct SnapshotOptions {
+    JoinMode mode = JoinMode::NearestBefore;
+    std::size_t depth = 1024;     // samples kept per PV
+    std::int64_t toleranceNs = 0; // Exact: max |sample - row|; otherwise max sample age (0 = unlimited)
+    std::int64_t gridNs = 0;      // > 0: one row per multiple of gridNs
+    int trigger = -1;             // >= 0: one row at each update of this column
+    std::int64_t lagNs = 0;       // rows are emitted once advance() is this far past them
+};
+
+struct SnapshotCell {
+    double value = 0.0;
+    std::int64_t ns = 0; // stamp of the sample used (the earlier one when interpolated)
+    short status = 0;
+    short severity = 0;
+    bool valid = false;
+};
+
+struct Snapshot {
+    std::int64_t ns = 0;
+    std::vector<SnapshotCell> cells; // one per column
+};
+
+struct SnapshotStats {
+    unsigned long long samples = 0;
+    unsigned long long outOfOrder = 0; // older than the column's newest sample; dropped
+    unsigned long long rows = 0;
+    unsigned long long triggersDropped = 0; // pending trigger rows beyond depth
+};
+
+class ISnapshotHandler {
+public:
+    virtual ~ISnapshotHandler() = default;
+    virtual void onSnapshot(const Snapshot &row) = 0;
+};
+
+// Joins scalar monitor streams into time-aligned rows. Each column keeps the
+// last opt.depth samples in a ring ordered by time stamp, so memory is fixed
+// and a row costs one binary search per column.
+//
+// Rows are produced on a time grid and/or at each update of a trigger
+// column. Grid rows (and trigger rows when lagNs > 0) are emitted from
+// advance() once the clock passed them by lagNs, which leaves time for the
+// other PVs' updates to arrive; interpolation needs a sample after the row.
+// The grid starts at the first advance().
+//
+// Not thread-safe: feed and advance it from the thread that dispatches the
+// monitors. The handler runs from add()/advance() and gets a reused row.
+class SnapshotJoiner {
+public:
+    SnapshotJoiner(const std::vector<std::string> &pvNames, ISnapshotHandler &handler,
+                   const SnapshotOptions &opt = SnapshotOptions());
+    ~SnapshotJoiner();
+
+    SnapshotJoiner(const SnapshotJoiner &) = delete;
+    SnapshotJoiner &operator=(const SnapshotJoiner &) = delete;
+
+    std::size_t columns() const { return columns_.size(); }
+    const std::string &pvName(std::size_t col) const { return columns_[col].name; }
+
+    // Monitor handler feeding column col, e.g. for CaClient::monitor<double>().
+    ITypedMonitorHandler<double> &input(std::size_t col);
+
+    void add(std::size_t col, std::int64_t ns, double value, short status = 0, short severity = 0);
+
+    // Emits the grid and pending trigger rows up to nowNs - lagNs; the
+    // overload without arguments uses the host clock.
+    void advance(std::int64_t nowNs);
+    void advance();
+
+    // Fills row for time ns without emitting it.
+    void join(std::int64_t ns, Snapshot &row) const;
+
+    const SnapshotStats &stats() const { return stats_; }
+
+private:
+    struct Sample {
+        std::int64_t ns;
+        double value;
+        short status;
+        short severity;
+    };
+
+    // Fixed-capacity ring of samples in time order.
+    class Series {
+    public:
+        explicit Series(std::size_t capacity) : buf_(capacity), start_(0), size_(0) {}
+
+        std::size_t size() const { return size_; }
+        const Sample &at(std::size_t i) const { return buf_[(start_ + i) % buf_.size()]; }
+        const Sample &back() const { return at(size_ - 1); }
+        void push(const Sample &s);
+        // Index of the first sample later than ns (size() if none).
+        std::size_t upperBound(std::int64_t ns) const;
+
+    private:
+        std::vector<Sample> buf_;
+        std::size_t start_;
+        std::size_t size_;
+    };
+
+    class Input;
+
+    struct Column {
+        std::string name;
+        Series series;
+        std::unique_ptr<Input> input;
+    };
+
+    void cell(const Series &s, std::int64_t ns, SnapshotCell &out) const;
+    void emit(std::int64_t ns);
+
+    ISnapshotHandler &handler_;
+    SnapshotOptions opt_;
+    std::vector<Column> columns_;
+    std::deque<std::int64_t> triggers_; // pending trigger row times
+    std::int64_t nextGridNs_;           // 0 until the first advance()
+    Snapshot row_;
+    SnapshotStats stats_;
+};
+
+} // namespace caClientLib
+
+#endif
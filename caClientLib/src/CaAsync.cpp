@@ -0,0 +1,205 @@
+#include "caClientLib/CaAsync.h"
+
+#include "caClientLib/CaChannel.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace caClientLib {
+
+namespace {
+
+// CA is handed a request id rather than a pointer: a reply for a request that
+// was already forgotten (timed out on a channel that then disconnected, or
+// whose tracker is gone) finds nothing here instead of freed memory. One lock
+// covers the index and every tracker's maps, so a reply cannot race the
+// removal of its entry.
+std::mutex g_lock;
+std::unordered_map<std::uintptr_t, CaRequestTracker *> g_owners;
+std::uintptr_t g_nextId = 0;
+
+} // namespace
+
+CaRequestTracker::~CaRequestTracker()
+{
+    RequestMap requests;
+    {
+        std::lock_guard<std::mutex> guard(g_lock);
+        for (const RequestMap::value_type &r : requests_) {
+            g_owners.erase(r.first);
+        }
+        requests.swap(requests_);
+        deadlines_.clear();
+    }
+    // Channels held by the requests are released here, outside the lock.
+}
+
+CaRequestTracker::RequestId CaRequestTracker::enqueue(const std::shared_ptr<CaChannel> &ch, CaMetric metric,
+                                                      double timeoutSec, Completion done)
+{
+    const Clock::time_point issued = Clock::now();
+    const Clock::time_point deadline = issued +
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeoutSec));
+
+    std::lock_guard<std::mutex> guard(g_lock);
+    const RequestId id = ++g_nextId;
+    Request &req = requests_[id];
+    req.channel = ch;
+    req.done = std::move(done);
+    req.metric = metric;
+    req.issued = issued;
+    req.deadline = deadlines_.emplace(deadline, id);
+    g_owners.emplace(id, this);
+    return id;
+}
+
+CaRequestTracker::Completion CaRequestTracker::cancel(RequestId id)
+{
+    std::shared_ptr<CaChannel> channel;
+    Completion done;
+    {
+        std::lock_guard<std::mutex> guard(g_lock);
+        RequestMap::iterator it = requests_.find(id);
+        if (it == requests_.end()) {
+            return done;
+        }
+        deadlines_.erase(it->second.deadline);
+        done = std::move(it->second.done);
+        channel = std::move(it->second.channel);
+        requests_.erase(it);
+        g_owners.erase(id);
+    }
+    return done;
+}
+
+int CaRequestTracker::get(const std::shared_ptr<CaChannel> &ch, chtype type, unsigned long count, double timeoutSec,
+                          Completion done)
+{
+    const RequestId id = enqueue(ch, CaMetric::Get, timeoutSec, std::move(done));
+
+    const int st = ca_array_get_callback(type, count, ch->chidHandle(), &CaRequestTracker::callback,
+                                         reinterpret_cast<void *>(id));
+    if (st != ECA_NORMAL) {
+        Completion cb = cancel(id);
+        if (cb) {
+            cb(st, 0, 0);
+        }
+    }
+    return st;
+}
+
+int CaRequestTracker::put(const std::shared_ptr<CaChannel> &ch, chtype type, unsigned long count, const void *value,
+                          double timeoutSec, Completion done)
+{
+    const RequestId id = enqueue(ch, CaMetric::Put, timeoutSec, std::move(done));
+
+    const int st = ca_array_put_callback(type, count, ch->chidHandle(), value, &CaRequestTracker::callback,
+                                         reinterpret_cast<void *>(id));
+    if (st != ECA_NORMAL) {
+        Completion cb = cancel(id);
+        if (cb) {
+            cb(st, 0, 0);
+        }
+    }
+    return st;
+}
+
+void CaRequestTracker::callback(struct event_handler_args args)
+{
+    const RequestId id = reinterpret_cast<RequestId>(args.usr);
+
+    std::shared_ptr<CaChannel> channel; // may be the last reference: dropped after the lock
+    Completion done;
+    CaMetric metric = CaMetric::Get;
+    Clock::time_point issued;
+    {
+        std::lock_guard<std::mutex> guard(g_lock);
+        std::unordered_map<RequestId, CaRequestTracker *>::iterator owner = g_owners.find(id);
+        if (owner == g_owners.end()) {
+            return;
+        }
+        CaRequestTracker *self = owner->second;
+        g_owners.erase(owner);
+
+        RequestMap::iterator it = self->requests_.find(id);
+        if (it == self->requests_.end()) {
+            return;
+        }
+        Request &req = it->second;
+        if (req.live) {
+            self->deadlines_.erase(req.deadline);
+            done = std::move(req.done);
+            metric = req.metric;
+            issued = req.issued;
+        } else {
+            --self->late_;
+        }
+        channel = std::move(req.channel);
+        self->requests_.erase(it);
+    }
+
+    if (done) {
+        if (args.status == ECA_NORMAL) {
+            CaLatencyStats::record(metric, issued);
+        }
+        done(args.status, args.status == ECA_NORMAL ? args.dbr : 0, args.count);
+    }
+}
+
+void CaRequestTracker::expire()
+{
+    std::vector<Completion> overdue;
+    std::vector<std::shared_ptr<CaChannel>> released;
+    {
+        std::lock_guard<std::mutex> guard(g_lock);
+        const Clock::time_point now = Clock::now();
+        while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+            Request &req = requests_[deadlines_.begin()->second];
+            deadlines_.erase(deadlines_.begin());
+            // Keep the entry until CA calls back, so a late reply is
+            // recognised and dropped.
+            req.live = false;
+            ++late_;
+            overdue.push_back(std::move(req.done));
+        }
+
+        // A disconnect fails the channel's outstanding requests, so nothing
+        // more is coming for a late request once its channel is down.
+        for (RequestMap::iterator it = requests_.begin(); late_ > 0 && it != requests_.end();) {
+            if (!it->second.live && !it->second.channel->connected()) {
+                released.push_back(std::move(it->second.channel));
+                g_owners.erase(it->first);
+                it = requests_.erase(it);
+                --late_;
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (Completion &done : overdue) {
+        if (done) {
+            done(ECA_TIMEOUT, 0, 0);
+        }
+    }
+}
+
+std::size_t CaRequestTracker::pending() const
+{
+    std::lock_guard<std::mutex> guard(g_lock);
+    return deadlines_.size();
+}
+
+double CaRequestTracker::nextDeadlineIn() const
+{
+    std::lock_guard<std::mutex> guard(g_lock);
+    if (deadlines_.empty()) {
+        return -1.0;
+    }
+    const double dt = std::chrono::duration<double>(deadlines_.begin()->first - Clock::now()).count();
+    return dt > 0.0 ? dt : 0.0;
+}
+
+} // namespace caClientLib
@@ -8,45 +8,186 @@ namespace caClientLib {
 CaChannel::CaChannel(const std::string &pvName, double timeoutSec)
     : pvName_(pvName), chid_(0)
 {
+    const CaLatencyStats::Clock::time_point t0 = CaLatencyStats::Clock::now();
+
     int st = ca_create_channel(pvName_.c_str(), 0, 0, CA_PRIORITY_DEFAULT, &chid_);
     CaStatus::requireOk(st, "ca_create_channel");
 
-    st = ca_pend_io(timeoutSec);
+    st = CaStatus::connectStatus(pendIo(timeoutSec), chid_);
+    if (st != ECA_NORMAL) {
+        ca_clear_channel(chid_);
+        chid_ = 0;
+    }
     CaStatus::requireOk(st, "ca_pend_io (connect)");
+    CaLatencyStats::record(CaMetric::Connect, t0);
+}
+
+CaChannel::CaChannel(const std::string &pvName)
+    : pvName_(pvName), chid_(0)
+{
+    int st = ca_create_channel(pvName_.c_str(), 0, 0, CA_PRIORITY_DEFAULT, &chid_);
+    CaStatus::requireOk(st, "ca_create_channel");
+}
+
+CaResult<std::shared_ptr<CaChannel>> CaChannel::tryCreate(const std::string &pvName)
+{
+    std::shared_ptr<CaChannel> ch(new CaChannel(pvName, Unopened()));
+    const int st = ca_create_channel(ch->pvName_.c_str(), 0, 0, CA_PRIORITY_DEFAULT, &ch->chid_);
+    if (st != ECA_NORMAL) {
+        ch->chid_ = 0;
+        return CaError(st, "ca_create_channel");
+    }
+    return ch;
+}
+
+CaResult<std::shared_ptr<CaChannel>> CaChannel::tryConnect(const std::string &pvName, double timeoutSec)
+{
+    const CaLatencyStats::Clock::time_point t0 = CaLatencyStats::Clock::now();
+
+    CaResult<std::shared_ptr<CaChannel>> ch = tryCreate(pvName);
+    if (!ch) {
+        return ch;
+    }
+
+    const int st = CaStatus::connectStatus(pendIo(timeoutSec), (*ch)->chidHandle());
+    if (st != ECA_NORMAL) {
+        return CaError(st, "ca_pend_io (connect)");
+    }
+    CaLatencyStats::record(CaMetric::Connect, t0);
+    return ch;
+}
+
+int CaChannel::pendIo(double timeoutSec)
+{
+    const CaLatencyStats::Clock::time_point t0 = CaLatencyStats::Clock::now();
+    const int st = ca_pend_io(timeoutSec);
+    if (st == ECA_NORMAL) {
+        CaLatencyStats::record(CaMetric::PendIo, t0);
+    }
+    return st;
 }
 
 CaChannel::~CaChannel()
 {
+    // No callbacks arrive after the clear; requests whose waiters gave up
+    // go with pending_.
     if (chid_) {
         ca_clear_channel(chid_);
     }
 }
 
-std::string CaChannel::getString(double timeoutSec) const
+CaResult<void> CaChannel::transfer(bool put, chtype type, unsigned long count, void *buf, double timeoutSec) const
 {
-    dbr_string_t buf;
-    std::memset(buf, 0, sizeof(buf));
+    const CaLatencyStats::Clock::time_point t0 = CaLatencyStats::Clock::now();
+
+    if (sharedContext()) {
+        const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeoutSec));
 
-    int st = ca_get(DBR_STRING, chid_, buf);
-    CaStatus::requireOk(st, "ca_get");
+        Pending *req = nullptr;
+        int st = startRequest(put, type, count, buf, req);
+        if (st != ECA_NORMAL) {
+            return CaError(st, put ? "ca_array_put_callback" : "ca_array_get_callback");
+        }
+        ca_flush_io();
 
-    st = ca_pend_io(timeoutSec);
-    CaStatus::requireOk(st, "ca_pend_io (get)");
+        st = waitRequest(req, deadline);
+        if (st != ECA_NORMAL) {
+            return CaError(st, put ? "put callback" : "get callback");
+        }
+    } else {
+        int st = put ? ca_array_put(type, count, chid_, buf) : ca_array_get(type, count, chid_, buf);
+        if (st != ECA_NORMAL) {
+            return CaError(st, put ? "ca_put" : "ca_get");
+        }
 
+        st = pendIo(timeoutSec);
+        if (st != ECA_NORMAL) {
+            return CaError(st, put ? "ca_pend_io (put)" : "ca_pend_io (get)");
+        }
+    }
+
+    CaLatencyStats::record(put ? CaMetric::Put : CaMetric::Get, t0);
+    return CaResult<void>();
+}
+
+int CaChannel::startRequest(bool put, chtype type, unsigned long count, void *buf, Pending *&req) const
+{
+    {
+        std::lock_guard<std::mutex> guard(pendingLock_);
+        pending_.emplace_back();
+        req = &pending_.back();
+        req->owner = this;
+        req->self = std::prev(pending_.end());
+        if (!put) {
+            req->buf = buf;
+            req->size = dbr_size_n(type, count);
+        }
+    }
+
+    const int st = put ? ca_array_put_callback(type, count, chid_, buf, &CaChannel::requestDone, req)
+                       : ca_array_get_callback(type, count, chid_, &CaChannel::requestDone, req);
+    if (st != ECA_NORMAL) {
+        std::lock_guard<std::mutex> guard(pendingLock_);
+        pending_.erase(req->self);
+        req = nullptr;
+    }
+    return st;
+}
+
+int CaChannel::waitRequest(Pending *req, std::chrono::steady_clock::time_point deadline) const
+{
+    std::unique_lock<std::mutex> lock(pendingLock_);
+    if (!req->cv.wait_until(lock, deadline, [req] { return req->done; })) {
+        // The reply may still come; requestDone() frees the entry then.
+        req->abandoned = true;
+        req->buf = nullptr;
+        return ECA_TIMEOUT;
+    }
+    const int st = req->status;
+    pending_.erase(req->self);
+    return st;
+}
+
+void CaChannel::requestDone(struct event_handler_args args)
+{
+    Pending *req = static_cast<Pending *>(args.usr);
+    const CaChannel *self = req->owner;
+
+    std::lock_guard<std::mutex> guard(self->pendingLock_);
+    if (req->abandoned) {
+        self->pending_.erase(req->self);
+        return;
+    }
+    req->status = args.status;
+    if (args.status == ECA_NORMAL && req->buf && args.dbr) {
+        const std::size_t size = dbr_size_n(args.type, args.count);
+        std::memcpy(req->buf, args.dbr, size < req->size ? size : req->size);
+    }
+    req->done = true;
+    req->cv.notify_one();
+}
+
+CaResult<std::string> CaChannel::tryGetString(double timeoutSec) const
+{
+    dbr_string_t buf;
+    std::memset(buf, 0, sizeof(buf));
+
+    CaResult<void> r = transfer(false, DBR_STRING, 1, buf, timeoutSec);
+    if (!r) {
+        return r.error();
+    }
+    buf[sizeof(buf) - 1] = '\0';
     return std::string(buf);
 }
 
-void CaChannel::putString(const std::string &value, double timeoutSec) const
+CaResult<void> CaChannel::tryPutString(const std::string &value, double timeoutSec) const
 {
     dbr_string_t buf;
     std::memset(buf, 0, sizeof(buf));
     std::strncpy(buf, value.c_str(), sizeof(buf) - 1);
 
-    int st = ca_put(DBR_STRING, chid_, buf);
-    CaStatus::requireOk(st, "ca_put");
-
-    st = ca_pend_io(timeoutSec);
-    CaStatus::requireOk(st, "ca_pend_io (put)");
+    return transfer(true, DBR_STRING, 1, buf, timeoutSec);
 }
 
 } // namespace caClientLib
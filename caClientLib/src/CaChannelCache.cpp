@@ -0,0 +1,138 @@
+#include "caClientLib/CaChannelCache.h"
+
+namespace caClientLib {
+
+CaChannelCache::CaChannelCache(const ChannelCacheOptions &opt) : opt_(opt)
+{
+}
+
+std::shared_ptr<CaChannel> CaChannelCache::acquire(const std::string &pvName, double timeoutSec)
+{
+    return tryAcquire(pvName, timeoutSec).value();
+}
+
+CaResult<std::shared_ptr<CaChannel>> CaChannelCache::tryAcquire(const std::string &pvName, double timeoutSec)
+{
+    std::shared_ptr<CaChannel> ch = find(pvName);
+    if (ch) {
+        return ch;
+    }
+
+    CaResult<std::shared_ptr<CaChannel>> created = CaChannel::tryConnect(pvName, timeoutSec);
+    if (created) {
+        insert(*created);
+    }
+    return created;
+}
+
+std::shared_ptr<CaChannel> CaChannelCache::find(const std::string &pvName)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    const Clock::time_point now = Clock::now();
+    evictIdle(now);
+
+    auto it = index_.find(pvName);
+    if (it == index_.end()) {
+        ++stats_.misses;
+        return std::shared_ptr<CaChannel>();
+    }
+
+    LruList::iterator e = it->second;
+    if (e->channel->connected()) {
+        ++stats_.hits;
+        e->lastUsed = now;
+        lru_.splice(lru_.begin(), lru_, e);
+        return e->channel;
+    }
+
+    // CA lost the circuit; start over with a fresh search rather than
+    // handing out a channel that would fail the next request.
+    ++stats_.reconnects;
+    lru_.erase(e);
+    index_.erase(it);
+    return std::shared_ptr<CaChannel>();
+}
+
+void CaChannelCache::insert(const std::shared_ptr<CaChannel> &ch)
+{
+    if (!ch) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = index_.find(ch->pvName());
+    if (it != index_.end()) {
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    lru_.push_front(Entry{ch, Clock::now()});
+    index_[ch->pvName()] = lru_.begin();
+    enforceCapacity();
+}
+
+void CaChannelCache::evict(const std::string &pvName)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = index_.find(pvName);
+    if (it == index_.end()) {
+        return;
+    }
+    lru_.erase(it->second);
+    index_.erase(it);
+    ++stats_.evictions;
+}
+
+void CaChannelCache::evictIdle()
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    evictIdle(Clock::now());
+}
+
+void CaChannelCache::evictIdle(Clock::time_point now)
+{
+    if (opt_.idleTimeoutSec <= 0.0) {
+        return;
+    }
+    const Clock::duration maxIdle = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(opt_.idleTimeoutSec));
+
+    while (!lru_.empty() && now - lru_.back().lastUsed > maxIdle) {
+        index_.erase(lru_.back().channel->pvName());
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+void CaChannelCache::enforceCapacity()
+{
+    if (opt_.capacity == 0) {
+        return;
+    }
+    while (index_.size() > opt_.capacity) {
+        index_.erase(lru_.back().channel->pvName());
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+void CaChannelCache::clear()
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    index_.clear();
+    lru_.clear();
+}
+
+std::size_t CaChannelCache::size() const
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    return index_.size();
+}
+
+ChannelCacheStats CaChannelCache::stats() const
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    return stats_;
+}
+
+} // namespace caClientLib
@@ -0,0 +1,205 @@
+#include "caClientLib/CaChannelGroup.h"
+#include "caClientLib/CaChannelCache.h"
+#include "caClientLib/CaLatencyStats.h"
+
+#include <cstring>
+
+namespace caClientLib {
+
+namespace {
+
+// A completed DBR_STRING get always contains a terminating NUL. Filling the
+// buffer with a non-zero pattern beforehand lets us tell, per request, which
+// gets finished when ca_pend_io() reports a timeout for the batch. Only the
+// single-threaded (non-preemptive) path relies on this; on a shared context
+// ca_pend_io() could also return early or late because of other threads'
+// requests, so each request is waited for on its own there.
+const unsigned char kUnfilled = 0xff;
+
+bool getCompleted(const dbr_string_t &buf)
+{
+    return std::memchr(buf, '\0', sizeof(buf)) != 0;
+}
+
+} // namespace
+
+CaChannelGroup::CaChannelGroup(CaChannelCache *cache) : cache_(cache)
+{
+}
+
+std::size_t CaChannelGroup::addGet(const std::string &pvName)
+{
+    ops_.emplace_back();
+    CaGroupResult r;
+    r.pvName = pvName;
+    results_.push_back(r);
+    return ops_.size() - 1;
+}
+
+std::size_t CaChannelGroup::addPut(const std::string &pvName, const std::string &value)
+{
+    ops_.emplace_back();
+    ops_.back().isPut = true;
+    ops_.back().putValue = value;
+    CaGroupResult r;
+    r.pvName = pvName;
+    results_.push_back(r);
+    return ops_.size() - 1;
+}
+
+bool CaChannelGroup::allOk() const
+{
+    for (const CaGroupResult &r : results_) {
+        if (!r.ok()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CaChannelGroup::clear()
+{
+    ops_.clear();
+    results_.clear();
+    channels_.clear();
+}
+
+std::shared_ptr<CaChannel> CaChannelGroup::channelFor(const std::string &pvName, bool &created, int &status)
+{
+    auto it = channels_.find(pvName);
+    if (it != channels_.end()) {
+        return it->second;
+    }
+
+    std::shared_ptr<CaChannel> ch;
+    if (cache_) {
+        ch = cache_->find(pvName);
+    }
+    if (!ch) {
+        CaResult<std::shared_ptr<CaChannel>> r = CaChannel::tryCreate(pvName);
+        if (!r) {
+            status = r.status();
+            return std::shared_ptr<CaChannel>();
+        }
+        ch = *r;
+        created = true;
+    }
+
+    channels_[pvName] = ch;
+    return ch;
+}
+
+void CaChannelGroup::execute(double timeoutSec)
+{
+    // Phase 1: resolve channels, waiting once for all new connections.
+    bool anyCreated = false;
+    for (std::size_t i = 0; i < ops_.size(); i++) {
+        results_[i].status = ECA_NORMAL;
+        results_[i].value.clear();
+        ops_[i].channel = channelFor(results_[i].pvName, anyCreated, results_[i].status);
+    }
+
+    if (anyCreated) {
+        const CaLatencyStats::Clock::time_point t0 = CaLatencyStats::Clock::now();
+        if (ca_pend_io(timeoutSec) == ECA_NORMAL) {
+            CaLatencyStats::record(CaMetric::PendIo, t0);
+            CaLatencyStats::record(CaMetric::Connect, t0);
+        }
+    }
+
+    // Phase 2: queue every request on its circuit, then wait once.
+    const CaLatencyStats::Clock::time_point t0 = CaLatencyStats::Clock::now();
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeoutSec));
+    const bool shared = CaChannel::sharedContext();
+    bool anyQueued = false;
+    for (std::size_t i = 0; i < ops_.size(); i++) {
+        Op &op = ops_[i];
+        CaGroupResult &r = results_[i];
+        if (!op.channel) {
+            continue;
+        }
+        if (!op.channel->connected()) {
+            r.status = (ca_state(op.channel->chidHandle()) == cs_prev_conn) ? ECA_DISCONN : ECA_TIMEOUT;
+            continue;
+        }
+
+        int st;
+        if (shared) {
+            std::memset(op.buf, 0, sizeof(op.buf));
+            if (op.isPut) {
+                std::strncpy(op.buf, op.putValue.c_str(), sizeof(op.buf) - 1);
+            }
+            st = op.channel->startRequest(op.isPut, DBR_STRING, 1, op.buf, op.pending);
+        } else if (op.isPut) {
+            std::memset(op.buf, 0, sizeof(op.buf));
+            std::strncpy(op.buf, op.putValue.c_str(), sizeof(op.buf) - 1);
+            st = ca_put(DBR_STRING, op.channel->chidHandle(), op.buf);
+        } else {
+            std::memset(op.buf, kUnfilled, sizeof(op.buf));
+            st = ca_get(DBR_STRING, op.channel->chidHandle(), op.buf);
+        }
+        r.status = st;
+        if (st == ECA_NORMAL) {
+            anyQueued = true;
+        }
+    }
+
+    if (anyQueued && shared) {
+        ca_flush_io();
+        for (std::size_t i = 0; i < ops_.size(); i++) {
+            Op &op = ops_[i];
+            CaGroupResult &r = results_[i];
+            if (!op.channel || r.status != ECA_NORMAL) {
+                continue;
+            }
+            r.status = op.channel->waitRequest(op.pending, deadline);
+            op.pending = nullptr;
+            if (r.status != ECA_NORMAL) {
+                continue;
+            }
+            if (op.isPut) {
+                CaLatencyStats::record(CaMetric::Put, t0);
+            } else {
+                CaLatencyStats::record(CaMetric::Get, t0);
+                op.buf[sizeof(op.buf) - 1] = '\0';
+                r.value.assign(op.buf);
+            }
+        }
+    } else if (anyQueued) {
+        const CaLatencyStats::Clock::time_point pendStart = CaLatencyStats::Clock::now();
+        const int st = ca_pend_io(timeoutSec);
+        if (st == ECA_NORMAL) {
+            CaLatencyStats::record(CaMetric::PendIo, pendStart);
+        }
+        for (std::size_t i = 0; i < ops_.size(); i++) {
+            Op &op = ops_[i];
+            CaGroupResult &r = results_[i];
+            if (!op.channel || r.status != ECA_NORMAL) {
+                continue;
+            }
+            if (op.isPut) {
+                if (st == ECA_NORMAL) {
+                    CaLatencyStats::record(CaMetric::Put, t0);
+                }
+                continue;
+            }
+            if (st != ECA_NORMAL && !getCompleted(op.buf)) {
+                r.status = st;
+                continue;
+            }
+            CaLatencyStats::record(CaMetric::Get, t0);
+            r.value.assign(op.buf);
+        }
+    }
+
+    if (cache_) {
+        for (const auto &kv : channels_) {
+            if (kv.second->connected()) {
+                cache_->insert(kv.second);
+            }
+        }
+    }
+}
+
+} // namespace caClientLib
@@ -1,21 +1,162 @@
 #include "caClientLib/CaClient.h"
 
+#include <chrono>
+#include <stdexcept>
+
 namespace caClientLib {
 
-CaClient::CaClient() : ctx_()
+CaClient::CaClient() : ctx_(), stopping_(false), requests_(), cache_(), subscriptions_(cache_)
+{
+    initEventLoop();
+}
+
+CaClient::CaClient(const ChannelCacheOptions &cacheOpt) : ctx_(), stopping_(false), requests_(), cache_(cacheOpt), subscriptions_(cache_)
+{
+    initEventLoop();
+}
+
+CaClient::CaClient(CaContext::CallbackMode mode, const ChannelCacheOptions &cacheOpt)
+    : ctx_(mode), stopping_(false), requests_(), cache_(cacheOpt), subscriptions_(cache_)
+{
+    initEventLoop();
+}
+
+void CaClient::initEventLoop()
+{
+#ifdef CACL_HAVE_EVENT_LOOP
+    if (ctx_.mode() == CaContext::NonPreemptive) {
+        loop_.reset(new CaEventLoop());
+    }
+#endif
+}
+
+#ifdef CACL_HAVE_EVENT_LOOP
+CaEventLoop &CaClient::eventLoop()
+{
+    if (!loop_) {
+        throw std::logic_error("CaClient::eventLoop: only available with a non-preemptive context");
+    }
+    return *loop_;
+}
+#endif
+
+void CaClient::run(const std::function<bool()> &done, double timeoutSec)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    ctx_.attach();
+    stopping_ = false;
+    ca_flush_io();
+
+    const bool bounded = timeoutSec > 0.0;
+    const Clock::time_point end = Clock::now()
+        + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(bounded ? timeoutSec : 0.0));
+
+    while (!stopping_ && !(done && done())) {
+        double wait = -1.0;
+        if (bounded) {
+            wait = std::chrono::duration<double>(end - Clock::now()).count();
+            if (wait <= 0.0) {
+                break;
+            }
+        }
+        const double next = requests_.nextDeadlineIn();
+        if (next >= 0.0 && (wait < 0.0 || next < wait)) {
+            wait = next;
+        }
+
+#ifdef CACL_HAVE_EVENT_LOOP
+        if (loop_) {
+            loop_->runOnce(wait);
+            requests_.expire();
+            ca_flush_io();
+            continue;
+        }
+#endif
+        // No fd registration: sleep in short slices so done()/stop() are seen.
+        pendEvent(wait < 0.0 || wait > 0.1 ? 0.1 : (wait > 0.0 ? wait : 1e-6));
+    }
+}
+
+CaClientStats CaClient::stats() const
 {
+    CaClientStats s;
+    s.connect = CaLatencyStats::histogram(CaMetric::Connect).summary();
+    s.get = CaLatencyStats::histogram(CaMetric::Get).summary();
+    s.put = CaLatencyStats::histogram(CaMetric::Put).summary();
+    s.pendIo = CaLatencyStats::histogram(CaMetric::PendIo).summary();
+    s.monitorLag = CaLatencyStats::histogram(CaMetric::MonitorLag).summary();
+    s.cache = cache_.stats();
+    return s;
+}
+
+void CaClient::pendEvent(double seconds)
+{
+    ctx_.attach();
+    const double next = requests_.nextDeadlineIn();
+    if (next >= 0.0 && next < seconds) {
+        // Wake up in time to fail the earliest request on its deadline.
+        ctx_.pendEvent(next > 0.0 ? next : 1e-6);
+        requests_.expire();
+        seconds -= next;
+        if (seconds <= 0.0) {
+            return;
+        }
+    }
+    ctx_.pendEvent(seconds);
+    requests_.expire();
+}
+
+void CaClient::poll()
+{
+    ctx_.attach();
+    ca_poll();
+    requests_.expire();
+}
+
+void CaClient::flush()
+{
+    ctx_.attach();
+    ca_flush_io();
 }
 
 std::string CaClient::getString(const std::string &pvName, double timeoutSec)
 {
-    CaChannel ch(pvName, timeoutSec);
-    return ch.getString(timeoutSec);
+    return tryGetString(pvName, timeoutSec).value();
 }
 
 void CaClient::putString(const std::string &pvName, const std::string &value, double timeoutSec)
 {
-    CaChannel ch(pvName, timeoutSec);
-    ch.putString(value, timeoutSec);
+    tryPutString(pvName, value, timeoutSec).value();
+}
+
+CaResult<std::string> CaClient::tryGetString(const std::string &pvName, double timeoutSec)
+{
+    CaResult<std::shared_ptr<CaChannel>> ch = tryChannel(pvName, timeoutSec);
+    if (!ch) {
+        return ch.error();
+    }
+    return (*ch)->tryGetString(timeoutSec);
+}
+
+CaResult<void> CaClient::tryPutString(const std::string &pvName, const std::string &value, double timeoutSec)
+{
+    CaResult<std::shared_ptr<CaChannel>> ch = tryChannel(pvName, timeoutSec);
+    if (!ch) {
+        return ch.error();
+    }
+    return (*ch)->tryPutString(value, timeoutSec);
+}
+
+std::vector<CaGroupResult> CaClient::getStrings(const std::vector<std::string> &pvNames, double timeoutSec)
+{
+    ctx_.attach();
+    CaChannelGroup group(&cache_);
+    for (const std::string &pv : pvNames) {
+        group.addGet(pv);
+    }
+    group.execute(timeoutSec);
+    return group.results();
 }
 
 std::unique_ptr<CaMonitor> CaClient::monitorStringTime(
@@ -23,7 +164,17 @@ std::unique_ptr<CaMonitor> CaClient::monitorStringTime(
     double timeoutSec,
     IMonitorHandler &handler)
 {
+    ctx_.attach();
     return std::unique_ptr<CaMonitor>(new CaMonitor(pvName, timeoutSec, handler));
 }
 
+CaResult<std::unique_ptr<CaMonitor>> CaClient::tryMonitorStringTime(
+    const std::string &pvName,
+    double timeoutSec,
+    IMonitorHandler &handler)
+{
+    ctx_.attach();
+    return CaMonitor::tryCreate(pvName, timeoutSec, handler);
+}
+
 } // namespace caClientLib
@@ -1,20 +1,55 @@
 #include "caClientLib/CaContext.h"
 #include "caClientLib/CaStatus.h"
 
+#include <stdexcept>
+
 namespace caClientLib {
 
-CaContext::CaContext() : created_(false)
+CaContext::CaContext(CallbackMode mode) : mode_(mode), context_(0), created_(false)
 {
-    int st = ca_context_create(ca_disable_preemptive_callback);
+    // ca_context_create() is a no-op when the thread already has a context
+    // with the same mode; in that case it is not ours to destroy.
+    const bool existed = ca_current_context() != 0;
+
+    int st = ca_context_create(mode == Preemptive ? ca_enable_preemptive_callback
+                                                  : ca_disable_preemptive_callback);
     CaStatus::requireOk(st, "ca_context_create");
-    created_ = true;
+
+    context_ = ca_current_context();
+    created_ = !existed;
 }
 
 CaContext::~CaContext()
 {
-    if (created_) {
-        ca_context_destroy();
+    if (!created_) {
+        return;
+    }
+    if (ca_current_context() != context_) {
+        if (ca_current_context() != 0) {
+            ca_detach_context();
+        }
+        ca_attach_context(context_);
+    }
+    ca_context_destroy();
+}
+
+void CaContext::attach()
+{
+    ca_client_context *current = ca_current_context();
+    if (current == context_) {
+        return;
+    }
+    // Switching the thread over behind its owner's back would leave that
+    // context's requests unserviced, so this is left to the caller.
+    if (current != 0) {
+        throw std::logic_error("CaContext::attach: the calling thread already has its own CA context; "
+                               "call ca_detach_context() first");
+    }
+    if (mode_ != Preemptive) {
+        throw std::logic_error("CaContext::attach: a NonPreemptive context can only be used from the "
+                               "thread that created it");
     }
+    CaStatus::requireOk(ca_attach_context(context_), "ca_attach_context");
 }
 
 void CaContext::pendEvent(double seconds)
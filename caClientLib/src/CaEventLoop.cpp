@@ -0,0 +1,212 @@
+#include "caClientLib/CaEventLoop.h"
+
+#ifdef CACL_HAVE_EVENT_LOOP
+
+#include "caClientLib/CaStatus.h"
+
+#include <cadef.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace caClientLib {
+
+namespace {
+
+std::runtime_error sysError(const char *what)
+{
+    return std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+CaEventLoop::CaEventLoop() : epollFd_(-1), timerFd_(-1), nextId_(1)
+{
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd_ < 0) {
+        throw sysError("epoll_create1");
+    }
+
+    timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerFd_ < 0) {
+        const std::runtime_error e = sysError("timerfd_create");
+        close(epollFd_);
+        throw e;
+    }
+
+    struct epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = timerFd_;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, timerFd_, &ev);
+
+    const int st = ca_add_fd_registration(&CaEventLoop::fdRegistration, this);
+    if (st != ECA_NORMAL) {
+        close(timerFd_);
+        close(epollFd_);
+        CaStatus::requireOk(st, "ca_add_fd_registration");
+    }
+}
+
+CaEventLoop::~CaEventLoop()
+{
+    ca_add_fd_registration(0, 0);
+    close(timerFd_);
+    close(epollFd_);
+}
+
+void CaEventLoop::fdRegistration(void *arg, int fd, int opened)
+{
+    CaEventLoop *self = static_cast<CaEventLoop *>(arg);
+    if (!self) {
+        return;
+    }
+
+    if (opened) {
+        struct epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(self->epollFd_, EPOLL_CTL_ADD, fd, &ev);
+    } else {
+        epoll_ctl(self->epollFd_, EPOLL_CTL_DEL, fd, 0);
+    }
+}
+
+CaEventLoop::TimerId CaEventLoop::addTimer(double delaySec, TimerCallback cb, double periodSec)
+{
+    Timer t;
+    t.due = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(delaySec));
+    t.period = periodSec > 0.0
+        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(periodSec))
+        : Clock::duration::zero();
+    t.cb = cb;
+
+    const TimerId id = nextId_++;
+    timers_[id] = t;
+    armTimerFd();
+    return id;
+}
+
+void CaEventLoop::cancelTimer(TimerId id)
+{
+    timers_.erase(id);
+    armTimerFd();
+}
+
+void CaEventLoop::armTimerFd()
+{
+    struct itimerspec spec;
+    std::memset(&spec, 0, sizeof(spec));
+
+    if (!timers_.empty()) {
+        Clock::time_point next = Clock::time_point::max();
+        for (const auto &kv : timers_) {
+            if (kv.second.due < next) {
+                next = kv.second.due;
+            }
+        }
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(next - Clock::now()).count();
+        if (ns < 1) {
+            ns = 1; // all-zero would disarm
+        }
+        spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000LL);
+        spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000LL);
+    }
+
+    timerfd_settime(timerFd_, 0, &spec, 0);
+}
+
+void CaEventLoop::runTimers()
+{
+    unsigned long long expirations;
+    while (read(timerFd_, &expirations, sizeof(expirations)) > 0) {
+    }
+
+    const Clock::time_point now = Clock::now();
+    std::vector<TimerId> due;
+    for (const auto &kv : timers_) {
+        if (kv.second.due <= now) {
+            due.push_back(kv.first);
+        }
+    }
+
+    for (TimerId id : due) {
+        auto it = timers_.find(id);
+        if (it == timers_.end()) {
+            continue; // cancelled by an earlier callback
+        }
+        TimerCallback cb = it->second.cb;
+        if (it->second.period > Clock::duration::zero()) {
+            it->second.due += it->second.period;
+            if (it->second.due < now) {
+                it->second.due = now + it->second.period;
+            }
+        } else {
+            timers_.erase(it);
+        }
+        cb();
+    }
+
+    armTimerFd();
+}
+
+void CaEventLoop::runPosted()
+{
+    // Callbacks posted from here run on the next pass.
+    std::vector<TimerCallback> ready;
+    ready.swap(posted_);
+    for (TimerCallback &cb : ready) {
+        cb();
+    }
+}
+
+int CaEventLoop::runOnce(double maxWaitSec)
+{
+    int timeoutMs = -1;
+    if (!posted_.empty()) {
+        timeoutMs = 0;
+    } else if (maxWaitSec >= 0.0) {
+        timeoutMs = static_cast<int>(std::ceil(maxWaitSec * 1000.0));
+    }
+
+    struct epoll_event events[16];
+    const int n = epoll_wait(epollFd_, events, 16, timeoutMs);
+    if (n < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        throw sysError("epoll_wait");
+    }
+
+    bool caReady = false;
+    bool timerReady = false;
+    for (int i = 0; i < n; i++) {
+        if (events[i].data.fd == timerFd_) {
+            timerReady = true;
+        } else {
+            caReady = true;
+        }
+    }
+
+    if (caReady) {
+        ca_poll();
+    }
+    if (timerReady) {
+        runTimers();
+    }
+    runPosted();
+    return n;
+}
+
+} // namespace caClientLib
+
+#endif // CACL_HAVE_EVENT_LOOP
@@ -0,0 +1,57 @@
+#include "caClientLib/CaLatencyStats.h"
+
+namespace caClientLib {
+
+namespace {
+
+const int kMetricCount = static_cast<int>(CaMetric::MonitorLag) + 1;
+
+LatencyHistogram g_histograms[kMetricCount];
+
+} // namespace
+
+LatencyHistogram &CaLatencyStats::histogram(CaMetric m)
+{
+    return g_histograms[static_cast<int>(m)];
+}
+
+const char *CaLatencyStats::name(CaMetric m)
+{
+    switch (m) {
+    case CaMetric::Connect:
+        return "connect";
+    case CaMetric::Get:
+        return "get";
+    case CaMetric::Put:
+        return "put";
+    case CaMetric::PendIo:
+        return "pend_io";
+    case CaMetric::MonitorLag:
+        return "monitor_lag";
+    }
+    return "?";
+}
+
+void CaLatencyStats::recordMonitorLag(const epicsTimeStamp &serverStamp)
+{
+    if (serverStamp.secPastEpoch == 0 && serverStamp.nsec == 0) {
+        return; // record never processed
+    }
+
+    epicsTimeStamp now;
+    if (epicsTimeGetCurrent(&now) != 0) {
+        return;
+    }
+
+    const double lag = epicsTimeDiffInSeconds(&now, &serverStamp);
+    histogram(CaMetric::MonitorLag).record(lag > 0.0 ? static_cast<std::uint64_t>(lag * 1e9) : 0);
+}
+
+void CaLatencyStats::reset()
+{
+    for (int i = 0; i < kMetricCount; i++) {
+        g_histograms[i].reset();
+    }
+}
+
+} // namespace caClientLib
@@ -1,18 +1,56 @@
 #include "caClientLib/CaMonitor.h"
+#include "caClientLib/CaLatencyStats.h"
 #include "caClientLib/CaStatus.h"
 
 #include <cstring>
 
 namespace caClientLib {
 
-CaMonitor::CaMonitor(const std::string &pvName, double timeoutSec, IMonitorHandler &handler)
+void fillMonitorUpdate(std::string_view pvName, const dbr_time_string &v, MonitorUpdate &u)
+{
+    u.pvName = pvName;
+    u.value.assign(v.value, sizeof(v.value));
+    u.alarmStatus = v.status;
+    u.alarmSeverity = v.severity;
+    u.ts.secPastEpoch = v.stamp.secPastEpoch;
+    u.ts.nsec = v.stamp.nsec;
+}
+
+CaMonitor::CaMonitor(const std::string &pvName, IMonitorHandler &handler)
     : pvName_(pvName), chid_(0), evid_(0), handler_(&handler)
+{
+}
+
+// Delegating: the destructor releases whatever open() got to on failure.
+CaMonitor::CaMonitor(const std::string &pvName, double timeoutSec, IMonitorHandler &handler)
+    : CaMonitor(pvName, handler)
+{
+    open(timeoutSec).throwIfError();
+}
+
+CaResult<std::unique_ptr<CaMonitor>> CaMonitor::tryCreate(const std::string &pvName, double timeoutSec,
+                                                         IMonitorHandler &handler)
+{
+    std::unique_ptr<CaMonitor> m(new CaMonitor(pvName, handler));
+    const CaError e = m->open(timeoutSec);
+    if (!e.ok()) {
+        return e;
+    }
+    return CaResult<std::unique_ptr<CaMonitor>>(std::move(m));
+}
+
+CaError CaMonitor::open(double timeoutSec)
 {
     int st = ca_create_channel(pvName_.c_str(), 0, 0, CA_PRIORITY_DEFAULT, &chid_);
-    CaStatus::requireOk(st, "ca_create_channel");
+    if (st != ECA_NORMAL) {
+        chid_ = 0;
+        return CaError(st, "ca_create_channel");
+    }
 
-    st = ca_pend_io(timeoutSec);
-    CaStatus::requireOk(st, "ca_pend_io (connect)");
+    st = CaStatus::connectStatus(ca_pend_io(timeoutSec), chid_);
+    if (st != ECA_NORMAL) {
+        return CaError(st, "ca_pend_io (connect)");
+    }
 
     st = ca_create_subscription(
         DBR_TIME_STRING,
@@ -22,7 +60,11 @@ CaMonitor::CaMonitor(const std::string &pvName, double timeoutSec, IMonitorHandl
         &CaMonitor::callback,
         this,
         &evid_);
-    CaStatus::requireOk(st, "ca_create_subscription");
+    if (st != ECA_NORMAL) {
+        evid_ = 0;
+        return CaError(st, "ca_create_subscription");
+    }
+    return CaError();
 }
 
 CaMonitor::~CaMonitor()
@@ -49,12 +91,8 @@ void CaMonitor::callback(struct event_handler_args args)
     const dbr_time_string *v = static_cast<const dbr_time_string *>(args.dbr);
 
     MonitorUpdate u;
-    u.pvName = self->pvName_;
-    u.value = std::string(v->value);
-    u.alarmStatus = v->status;
-    u.alarmSeverity = v->severity;
-    u.ts.secPastEpoch = v->stamp.secPastEpoch;
-    u.ts.nsec = v->stamp.nsec;
+    fillMonitorUpdate(self->pvName_, *v, u);
+    CaLatencyStats::recordMonitorLag(u.ts);
 
     self->handler_->onUpdate(u);
 }
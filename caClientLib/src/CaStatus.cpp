@@ -10,10 +10,25 @@ void CaStatus::requireOk(int status, const char *what)
     if (status == ECA_NORMAL) {
         return;
     }
+    throw error(status, what);
+}
+
+std::runtime_error CaStatus::error(int status, const char *what)
+{
+    return std::runtime_error(message(status, what));
+}
+
+std::string CaStatus::message(int status, const char *what)
+{
     std::string msg = what ? what : "CA error";
     msg += ": ";
     msg += ca_message(status);
-    throw std::runtime_error(msg);
+    return msg;
+}
+
+int CaStatus::connectStatus(int pendStatus, chid ch)
+{
+    return pendStatus == ECA_TIMEOUT && ch && ca_state(ch) == cs_conn ? ECA_NORMAL : pendStatus;
 }
 
 } // namespace caClientLib
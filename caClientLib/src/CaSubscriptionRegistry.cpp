@@ -0,0 +1,198 @@
+#include "caClientLib/CaSubscriptionRegistry.h"
+#include "caClientLib/CaLatencyStats.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace caClientLib {
+
+CaSubscription::CaSubscription(CaSubscription &&o) noexcept
+    : registry_(o.registry_), entry_(o.entry_), handler_(o.handler_)
+{
+    o.registry_ = nullptr;
+    o.entry_ = nullptr;
+    o.handler_ = nullptr;
+}
+
+CaSubscription &CaSubscription::operator=(CaSubscription &&o) noexcept
+{
+    if (this != &o) {
+        reset();
+        std::swap(registry_, o.registry_);
+        std::swap(entry_, o.entry_);
+        std::swap(handler_, o.handler_);
+    }
+    return *this;
+}
+
+void CaSubscription::reset()
+{
+    if (entry_) {
+        registry_->unsubscribe(entry_, handler_);
+        registry_ = nullptr;
+        entry_ = nullptr;
+        handler_ = nullptr;
+    }
+}
+
+CaSubscriptionRegistry::CaSubscriptionRegistry(CaChannelCache &cache) : cache_(cache)
+{
+}
+
+CaSubscriptionRegistry::~CaSubscriptionRegistry()
+{
+    std::map<Key, Entry *> entries;
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock_);
+        entries.swap(entries_);
+        for (auto &kv : entries) {
+            kv.second->handlers.clear();
+        }
+    }
+    for (auto &kv : entries) {
+        release(kv.second);
+    }
+}
+
+CaResult<CaSubscription> CaSubscriptionRegistry::trySubscribe(const std::string &pvName, double timeoutSec,
+                                                             IMonitorHandler &handler, long mask)
+{
+    const Key key(pvName, DBR_TIME_STRING, mask);
+
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            Entry *e = it->second;
+            e->handlers.push_back(&handler);
+            if (e->haveLast) {
+                handler.onUpdate(e->last);
+            }
+            return CaSubscription(this, e, &handler);
+        }
+    }
+
+    // Connect and subscribe without the lock: ca_pend_io() may block, and
+    // callbacks for other entries need the lock meanwhile.
+    CaResult<std::shared_ptr<CaChannel>> ch = cache_.tryAcquire(pvName, timeoutSec);
+    if (!ch) {
+        return ch.error();
+    }
+
+    std::unique_ptr<Entry> created(new Entry);
+    created->registry = this;
+    created->key = key;
+    created->channel = *ch;
+    created->handlers.push_back(&handler);
+
+    std::unique_lock<std::recursive_mutex> guard(lock_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        // Another thread subscribed the same key while we were connecting.
+        Entry *e = it->second;
+        e->handlers.push_back(&handler);
+        if (e->haveLast) {
+            handler.onUpdate(e->last);
+        }
+        return CaSubscription(this, e, &handler);
+    }
+
+    // Registered before the subscription exists so the first event (the
+    // current value) finds the entry; CA only delivers it from a later
+    // ca_pend_event()/ca_poll(), or from another thread after we unlock.
+    Entry *e = created.release();
+    entries_[key] = e;
+    const int st = ca_create_subscription(DBR_TIME_STRING, 1, e->channel->chidHandle(), mask,
+        &CaSubscriptionRegistry::callback, e, &e->evid_);
+    if (st != ECA_NORMAL) {
+        entries_.erase(key);
+        guard.unlock();
+        e->evid_ = 0;
+        release(e);
+        return CaError(st, "ca_create_subscription");
+    }
+    return CaSubscription(this, e, &handler);
+}
+
+void CaSubscriptionRegistry::unsubscribe(void *entry, IMonitorHandler *handler)
+{
+    Entry *e = static_cast<Entry *>(entry);
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock_);
+        auto h = std::find(e->handlers.begin(), e->handlers.end(), handler);
+        if (h != e->handlers.end()) {
+            e->handlers.erase(h);
+        }
+        if (!e->handlers.empty()) {
+            return;
+        }
+        entries_.erase(e->key);
+        if (e->inCallback) {
+            // Called from one of e's handlers; the callback releases it.
+            e->released = true;
+            return;
+        }
+    }
+    // ca_clear_subscription() waits for a callback running on another
+    // thread, which may itself be waiting for lock_; so clear unlocked.
+    release(e);
+}
+
+void CaSubscriptionRegistry::release(Entry *e)
+{
+    if (e->evid_) {
+        ca_clear_subscription(e->evid_);
+    }
+    delete e;
+}
+
+void CaSubscriptionRegistry::callback(struct event_handler_args args)
+{
+    if (args.status != ECA_NORMAL || args.dbr == 0) {
+        return;
+    }
+    Entry *e = static_cast<Entry *>(args.usr);
+    if (!e) {
+        return;
+    }
+
+    std::unique_lock<std::recursive_mutex> guard(e->registry->lock_);
+    fillMonitorUpdate(e->channel->pvName(), *static_cast<const dbr_time_string *>(args.dbr), e->last);
+    e->haveLast = true;
+    CaLatencyStats::recordMonitorLag(e->last.ts);
+
+    // Handlers may unsubscribe (themselves or others) from onUpdate(), so walk
+    // a snapshot and skip the ones that left. The snapshot keeps its capacity
+    // between events.
+    e->inCallback = true;
+    e->dispatching = e->handlers;
+    for (IMonitorHandler *h : e->dispatching) {
+        if (std::find(e->handlers.begin(), e->handlers.end(), h) != e->handlers.end()) {
+            h->onUpdate(e->last);
+        }
+    }
+    e->inCallback = false;
+
+    if (e->released) {
+        guard.unlock();
+        release(e);
+    }
+}
+
+std::size_t CaSubscriptionRegistry::subscriptions() const
+{
+    std::lock_guard<std::recursive_mutex> guard(lock_);
+    return entries_.size();
+}
+
+std::size_t CaSubscriptionRegistry::handlers() const
+{
+    std::lock_guard<std::recursive_mutex> guard(lock_);
+    std::size_t n = 0;
+    for (const auto &kv : entries_) {
+        n += kv.second->handlers.size();
+    }
+    return n;
+}
+
+} // namespace caClientLib
@@ -0,0 +1,285 @@
+#include "caClientLib/CaptureReader.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace caClientLib {
+
+namespace {
+
+std::runtime_error sysError(const std::string &what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+CaptureReader::CaptureReader(const std::string &path) : path_(path), data_(0), size_(0)
+{
+    const int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw sysError("open " + path_);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        const std::runtime_error e = sysError("stat " + path_);
+        ::close(fd);
+        throw e;
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ < sizeof(header_)) {
+        ::close(fd);
+        throw std::runtime_error(path_ + ": not a capture file");
+    }
+
+    void *m = mmap(0, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        throw sysError("mmap " + path_);
+    }
+    data_ = static_cast<const char *>(m);
+
+    std::memcpy(&header_, data_, sizeof(header_));
+    if (std::memcmp(header_.magic, capture::kMagic, sizeof(header_.magic)) != 0 ||
+        header_.version != capture::kVersion) {
+        munmap(const_cast<char *>(data_), size_);
+        throw std::runtime_error(path_ + ": not a capture file (or unsupported version)");
+    }
+
+    // Walk the index chain newest to oldest.
+    std::uint64_t at = header_.lastIndex;
+    while (at != 0) {
+        capture::BlockHeader h;
+        if (at + sizeof(h) + sizeof(std::uint64_t) > size_) {
+            break;
+        }
+        std::memcpy(&h, data_ + at, sizeof(h));
+        if (h.kind != capture::Index || at + h.bytes > size_) {
+            break;
+        }
+
+        const char *p = data_ + at + sizeof(h);
+        std::uint64_t prev;
+        std::memcpy(&prev, p, sizeof(prev));
+        p += sizeof(prev);
+
+        for (std::uint32_t i = 0; i < h.count; i++) {
+            capture::IndexEntry e;
+            std::memcpy(&e, p + i * sizeof(e), sizeof(e));
+            if (e.offset + sizeof(capture::BlockHeader) > size_) {
+                continue;
+            }
+            if (e.pvId >= names_.size()) {
+                names_.resize(e.pvId + 1);
+                blocks_.resize(e.pvId + 1);
+            }
+
+            if (e.kind == capture::Dictionary) {
+                const char *name = data_ + e.offset + sizeof(capture::BlockHeader);
+                std::uint16_t len;
+                std::memcpy(&len, name, sizeof(len));
+                if (e.offset + sizeof(capture::BlockHeader) + sizeof(len) + len <= size_) {
+                    names_[e.pvId].assign(name + sizeof(len), len);
+                }
+            } else if (e.kind == capture::Data && e.offset + capture::dataBlockBytes(e.count) <= size_) {
+                BlockRef b;
+                b.offset = e.offset;
+                b.count = e.count;
+                b.firstNs = e.firstNs;
+                b.lastNs = e.lastNs;
+                blocks_[e.pvId].push_back(b);
+            }
+        }
+
+        if (prev >= at) {
+            break; // corrupt chain; keep what was read
+        }
+        at = prev;
+    }
+
+    for (std::vector<BlockRef> &bl : blocks_) {
+        std::stable_sort(bl.begin(), bl.end(),
+            [](const BlockRef &a, const BlockRef &b) { return a.firstNs < b.firstNs; });
+    }
+}
+
+CaptureReader::~CaptureReader()
+{
+    if (data_) {
+        munmap(const_cast<char *>(data_), size_);
+    }
+}
+
+bool CaptureReader::findPv(const std::string &pvName, std::uint32_t &pvId) const
+{
+    for (std::size_t i = 0; i < names_.size(); i++) {
+        if (names_[i] == pvName) {
+            pvId = static_cast<std::uint32_t>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::uint64_t CaptureReader::samples(std::uint32_t pvId) const
+{
+    std::uint64_t n = 0;
+    for (const BlockRef &b : blocks_[pvId]) {
+        n += b.count;
+    }
+    return n;
+}
+
+CaptureReader::Columns CaptureReader::columns(const BlockRef &b) const
+{
+    const char *p = data_ + b.offset + sizeof(capture::BlockHeader);
+    Columns c;
+    c.count = b.count;
+    c.ns = reinterpret_cast<const std::int64_t *>(p);
+    c.value = reinterpret_cast<const double *>(p + b.count * sizeof(std::int64_t));
+    c.status = reinterpret_cast<const std::int16_t *>(p + b.count * (sizeof(std::int64_t) + sizeof(double)));
+    c.severity = c.status + b.count;
+    return c;
+}
+
+std::vector<CaptureReader::Cursor> CaptureReader::openBlocks(const std::vector<std::uint32_t> &pvIds,
+                                                             std::int64_t fromNs, std::int64_t toNs) const
+{
+    std::vector<Cursor> out;
+    for (std::uint32_t id : pvIds) {
+        if (id >= blocks_.size()) {
+            continue;
+        }
+        // Blocks are ordered by firstNs, but lastNs is not monotonic when
+        // blocks overlap, so only the upper end can be cut by binary search.
+        const std::vector<BlockRef> &bl = blocks_[id];
+        const std::vector<BlockRef>::const_iterator end = std::partition_point(bl.begin(), bl.end(),
+            [toNs](const BlockRef &b) { return b.firstNs < toNs; });
+        for (std::vector<BlockRef>::const_iterator it = bl.begin(); it != end; ++it) {
+            if (it->lastNs < fromNs) {
+                continue;
+            }
+            const Columns cols = columns(*it);
+            Cursor c;
+            c.pvId = id;
+            c.block = static_cast<std::size_t>(it - bl.begin());
+            c.row = static_cast<std::size_t>(std::lower_bound(cols.ns, cols.ns + cols.count, fromNs) - cols.ns);
+            if (valid(c, toNs)) {
+                out.push_back(c);
+            }
+        }
+    }
+    std::sort(out.begin(), out.end(), [this](const Cursor &a, const Cursor &b) { return timeOf(a) < timeOf(b); });
+    return out;
+}
+
+bool CaptureReader::valid(const Cursor &c, std::int64_t toNs) const
+{
+    return c.row < blocks_[c.pvId][c.block].count && timeOf(c) < toNs;
+}
+
+void CaptureReader::advance(Cursor &c) const
+{
+    c.row++;
+}
+
+std::int64_t CaptureReader::timeOf(const Cursor &c) const
+{
+    return columns(blocks_[c.pvId][c.block]).ns[c.row];
+}
+
+CaptureSample CaptureReader::sample(const Cursor &c) const
+{
+    const Columns cols = columns(blocks_[c.pvId][c.block]);
+    CaptureSample s;
+    s.ns = cols.ns[c.row];
+    s.value = cols.value[c.row];
+    s.status = cols.status[c.row];
+    s.severity = cols.severity[c.row];
+    return s;
+}
+
+std::vector<CaptureBin> CaptureReader::bins(std::uint32_t pvId, std::int64_t fromNs, std::int64_t toNs,
+                                            std::int64_t binNs) const
+{
+    std::vector<CaptureBin> out;
+    if (binNs <= 0) {
+        throw std::invalid_argument("CaptureReader::bins: binNs must be > 0");
+    }
+
+    const std::int64_t origin = fromNs > header_.firstNs ? fromNs : header_.firstNs;
+    scan(std::vector<std::uint32_t>(1, pvId), fromNs, toNs, [&](std::uint32_t, const CaptureSample &s) {
+        const std::int64_t start = origin + (s.ns - origin) / binNs * binNs;
+        if (out.empty() || out.back().startNs != start) {
+            if (!out.empty()) {
+                out.back().mean /= static_cast<double>(out.back().count);
+            }
+            CaptureBin b;
+            b.startNs = start;
+            b.count = 0;
+            b.min = s.value;
+            b.max = s.value;
+            b.mean = 0.0;
+            out.push_back(b);
+        }
+        CaptureBin &b = out.back();
+        b.count++;
+        b.min = s.value < b.min ? s.value : b.min;
+        b.max = s.value > b.max ? s.value : b.max;
+        b.mean += s.value;
+        return true;
+    });
+    if (!out.empty()) {
+        out.back().mean /= static_cast<double>(out.back().count);
+    }
+    return out;
+}
+
+std::uint64_t CaptureReader::replay(const std::vector<std::uint32_t> &pvIds, IMonitorHandler &handler,
+                                    const ReplayOptions &opt) const
+{
+    typedef std::chrono::steady_clock Clock;
+
+    std::uint64_t delivered = 0;
+    bool started = false;
+    std::int64_t originNs = 0;
+    Clock::time_point originWall;
+
+    scan(pvIds, opt.fromNs, opt.toNs, [&](std::uint32_t pvId, const CaptureSample &s) {
+        if (!started) {
+            started = true;
+            originNs = s.ns;
+            originWall = Clock::now();
+        } else if (opt.speed > 0.0 && s.ns > originNs) {
+            const double offsetSec = static_cast<double>(s.ns - originNs) * 1e-9 / opt.speed;
+            std::this_thread::sleep_until(
+                originWall + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offsetSec)));
+        }
+
+        char buf[32];
+        const int n = std::snprintf(buf, sizeof(buf), "%.15g", s.value);
+
+        MonitorUpdate u;
+        u.pvName = names_[pvId];
+        u.value.assign(std::string_view(buf, n > 0 ? static_cast<std::size_t>(n) : 0));
+        u.alarmStatus = s.status;
+        u.alarmSeverity = s.severity;
+        u.ts = capture::fromNs(s.ns);
+        handler.onUpdate(u);
+        delivered++;
+        return true;
+    });
+    return delivered;
+}
+
+} // namespace caClientLib
@@ -0,0 +1,307 @@
+#include "caClientLib/CaptureWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace caClientLib {
+
+namespace {
+
+std::runtime_error sysError(const std::string &what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+template <typename T>
+void permute(std::vector<T> &col, const std::vector<std::size_t> &order)
+{
+    std::vector<T> sorted(order.size());
+    for (std::size_t i = 0; i < order.size(); i++) {
+        sorted[i] = col[order[i]];
+    }
+    std::copy(sorted.begin(), sorted.end(), col.begin());
+}
+
+} // namespace
+
+CaptureWriter::CaptureWriter(const std::string &path, const CaptureWriterOptions &opt)
+    : opt_(opt), path_(path), fd_(-1), pageBytes_(static_cast<std::size_t>(sysconf(_SC_PAGESIZE))),
+      tail_(capture::kHeaderBytes), fileBytes_(0), window_(0), windowStart_(0), windowBytes_(0)
+{
+    if (opt_.blockSamples == 0 || opt_.indexEvery == 0) {
+        throw std::invalid_argument("CaptureWriter: blockSamples and indexEvery must be > 0");
+    }
+
+    // The window must hold the largest block plus the page it may start in.
+    const std::size_t largest = std::max(capture::dataBlockBytes(opt_.blockSamples),
+        sizeof(capture::BlockHeader) + 8 + opt_.indexEvery * sizeof(capture::IndexEntry));
+    if (opt_.mapBytes < largest + pageBytes_) {
+        opt_.mapBytes = largest + pageBytes_;
+    }
+    opt_.mapBytes = (opt_.mapBytes + pageBytes_ - 1) / pageBytes_ * pageBytes_;
+
+    fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw sysError("open " + path_);
+    }
+
+    std::memset(&header_, 0, sizeof(header_));
+    std::memcpy(header_.magic, capture::kMagic, sizeof(header_.magic));
+    header_.version = capture::kVersion;
+    header_.headerBytes = capture::kHeaderBytes;
+    header_.dataEnd = tail_;
+    header_.firstNs = std::numeric_limits<std::int64_t>::max();
+    header_.lastNs = std::numeric_limits<std::int64_t>::min();
+
+    if (ftruncate(fd_, static_cast<off_t>(capture::kHeaderBytes)) != 0) {
+        const std::runtime_error e = sysError("ftruncate " + path_);
+        ::close(fd_);
+        throw e;
+    }
+    fileBytes_ = capture::kHeaderBytes;
+    writeHeader();
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    try {
+        close();
+    } catch (const std::exception &) {
+        // Nothing sensible to report from a destructor.
+    }
+}
+
+std::uint32_t CaptureWriter::addPv(const std::string &pvName)
+{
+    if (pvName.size() > 0xffff) {
+        throw std::invalid_argument("CaptureWriter: PV name too long");
+    }
+
+    const std::uint32_t id = static_cast<std::uint32_t>(columns_.size());
+    columns_.emplace_back();
+    Column &c = columns_.back();
+    c.ns.resize(opt_.blockSamples);
+    c.value.resize(opt_.blockSamples);
+    c.status.resize(opt_.blockSamples);
+    c.severity.resize(opt_.blockSamples);
+
+    const std::size_t bytes = sizeof(capture::BlockHeader) + capture::align8(2 + pvName.size());
+    char *p = reserve(bytes);
+    std::memset(p, 0, bytes);
+
+    capture::BlockHeader h;
+    std::memset(&h, 0, sizeof(h));
+    h.kind = capture::Dictionary;
+    h.pvId = id;
+    h.count = 1;
+    h.bytes = static_cast<std::uint32_t>(bytes);
+    std::memcpy(p, &h, sizeof(h));
+
+    const std::uint16_t len = static_cast<std::uint16_t>(pvName.size());
+    std::memcpy(p + sizeof(h), &len, sizeof(len));
+    std::memcpy(p + sizeof(h) + sizeof(len), pvName.data(), pvName.size());
+
+    capture::IndexEntry e;
+    std::memset(&e, 0, sizeof(e));
+    e.offset = tail_;
+    e.kind = capture::Dictionary;
+    e.pvId = id;
+    e.count = 1;
+    pendingIndex_.push_back(e);
+
+    tail_ += bytes;
+    header_.pvCount++;
+    if (pendingIndex_.size() >= opt_.indexEvery) {
+        writeIndex();
+    }
+    return id;
+}
+
+char *CaptureWriter::reserve(std::size_t bytes)
+{
+    if (window_ && tail_ + bytes <= windowStart_ + windowBytes_) {
+        return window_ + (tail_ - windowStart_);
+    }
+
+    if (window_) {
+        munmap(window_, windowBytes_);
+        window_ = 0;
+    }
+
+    const std::uint64_t start = tail_ / pageBytes_ * pageBytes_;
+    const std::uint64_t end = start + opt_.mapBytes;
+    if (fileBytes_ < end) {
+        if (ftruncate(fd_, static_cast<off_t>(end)) != 0) {
+            throw sysError("ftruncate " + path_);
+        }
+        fileBytes_ = end;
+    }
+
+    void *m = mmap(0, opt_.mapBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, static_cast<off_t>(start));
+    if (m == MAP_FAILED) {
+        throw sysError("mmap " + path_);
+    }
+    window_ = static_cast<char *>(m);
+    windowStart_ = start;
+    windowBytes_ = opt_.mapBytes;
+    return window_ + (tail_ - windowStart_);
+}
+
+void CaptureWriter::sealBlock(std::uint32_t pvId)
+{
+    Column &c = columns_[pvId];
+    const std::size_t n = c.count;
+    if (n == 0) {
+        return;
+    }
+
+    // Timestamps come from the IOC and are not guaranteed to be monotonic;
+    // the format promises sorted rows, so fix up the rare unordered block.
+    if (!std::is_sorted(c.ns.begin(), c.ns.begin() + n)) {
+        std::vector<std::size_t> order(n);
+        for (std::size_t i = 0; i < n; i++) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(),
+            [&c](std::size_t a, std::size_t b) { return c.ns[a] < c.ns[b]; });
+        permute(c.ns, order);
+        permute(c.value, order);
+        permute(c.status, order);
+        permute(c.severity, order);
+    }
+    const std::int64_t first = c.ns[0];
+    const std::int64_t last = c.ns[n - 1];
+
+    const std::size_t bytes = capture::dataBlockBytes(n);
+    char *p = reserve(bytes);
+
+    capture::BlockHeader h;
+    std::memset(&h, 0, sizeof(h));
+    h.kind = capture::Data;
+    h.pvId = pvId;
+    h.count = static_cast<std::uint32_t>(n);
+    h.bytes = static_cast<std::uint32_t>(bytes);
+    h.firstNs = first;
+    h.lastNs = last;
+    std::memcpy(p, &h, sizeof(h));
+
+    char *col = p + sizeof(h);
+    std::memcpy(col, c.ns.data(), n * sizeof(std::int64_t));
+    col += n * sizeof(std::int64_t);
+    std::memcpy(col, c.value.data(), n * sizeof(double));
+    col += n * sizeof(double);
+    std::memcpy(col, c.status.data(), n * sizeof(std::int16_t));
+    col += n * sizeof(std::int16_t);
+    std::memcpy(col, c.severity.data(), n * sizeof(std::int16_t));
+    col += n * sizeof(std::int16_t);
+    std::memset(col, 0, static_cast<std::size_t>(p + bytes - col));
+
+    capture::IndexEntry e;
+    std::memset(&e, 0, sizeof(e));
+    e.offset = tail_;
+    e.kind = capture::Data;
+    e.pvId = pvId;
+    e.count = h.count;
+    e.firstNs = first;
+    e.lastNs = last;
+    pendingIndex_.push_back(e);
+
+    tail_ += bytes;
+    header_.samples += n;
+    header_.firstNs = first < header_.firstNs ? first : header_.firstNs;
+    header_.lastNs = last > header_.lastNs ? last : header_.lastNs;
+    c.count = 0;
+
+    if (pendingIndex_.size() >= opt_.indexEvery) {
+        writeIndex();
+    }
+}
+
+void CaptureWriter::writeIndex()
+{
+    if (pendingIndex_.empty()) {
+        return;
+    }
+
+    const std::size_t n = pendingIndex_.size();
+    const std::size_t bytes = sizeof(capture::BlockHeader) + sizeof(std::uint64_t) + n * sizeof(capture::IndexEntry);
+    char *p = reserve(bytes);
+
+    capture::BlockHeader h;
+    std::memset(&h, 0, sizeof(h));
+    h.kind = capture::Index;
+    h.count = static_cast<std::uint32_t>(n);
+    h.bytes = static_cast<std::uint32_t>(bytes);
+    h.firstNs = std::numeric_limits<std::int64_t>::max();
+    h.lastNs = std::numeric_limits<std::int64_t>::min();
+    for (const capture::IndexEntry &e : pendingIndex_) {
+        if (e.kind == capture::Data) {
+            h.firstNs = e.firstNs < h.firstNs ? e.firstNs : h.firstNs;
+            h.lastNs = e.lastNs > h.lastNs ? e.lastNs : h.lastNs;
+        }
+    }
+    std::memcpy(p, &h, sizeof(h));
+    std::memcpy(p + sizeof(h), &header_.lastIndex, sizeof(header_.lastIndex));
+    std::memcpy(p + sizeof(h) + sizeof(header_.lastIndex), pendingIndex_.data(), n * sizeof(capture::IndexEntry));
+
+    header_.lastIndex = tail_;
+    tail_ += bytes;
+    header_.dataEnd = tail_;
+    pendingIndex_.clear();
+    writeHeader();
+}
+
+void CaptureWriter::writeHeader()
+{
+    if (pwrite(fd_, &header_, sizeof(header_), 0) != static_cast<ssize_t>(sizeof(header_))) {
+        throw sysError("write " + path_);
+    }
+}
+
+void CaptureWriter::flush()
+{
+    if (fd_ < 0) {
+        return;
+    }
+    for (std::uint32_t id = 0; id < columns_.size(); id++) {
+        sealBlock(id);
+    }
+    writeIndex();
+}
+
+void CaptureWriter::close()
+{
+    if (fd_ < 0) {
+        return;
+    }
+
+    flush();
+    if (window_) {
+        munmap(window_, windowBytes_);
+        window_ = 0;
+    }
+    const int st = ftruncate(fd_, static_cast<off_t>(tail_));
+    ::close(fd_);
+    fd_ = -1;
+    if (st != 0) {
+        throw sysError("ftruncate " + path_);
+    }
+}
+
+std::uint64_t CaptureWriter::samples() const
+{
+    std::uint64_t n = header_.samples;
+    for (const Column &c : columns_) {
+        n += c.count;
+    }
+    return n;
+}
+
+} // namespace caClientLib
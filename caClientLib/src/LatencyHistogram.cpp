@@ -0,0 +1,112 @@
+#include "caClientLib/LatencyHistogram.h"
+
+#include <limits>
+
+namespace caClientLib {
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+std::size_t LatencyHistogram::bucketIndex(std::uint64_t ns)
+{
+    const std::uint64_t maxValue = (std::uint64_t(1) << kMaxBit) - 1;
+    if (ns > maxValue) {
+        ns = maxValue;
+    }
+    if (ns < 2 * kSub) {
+        return static_cast<std::size_t>(ns);
+    }
+
+    int msb = 63;
+    while (!(ns & (std::uint64_t(1) << msb))) {
+        msb--;
+    }
+    const int shift = msb - kSubBits;
+    return static_cast<std::size_t>(shift) * kSub + static_cast<std::size_t>(ns >> shift);
+}
+
+std::uint64_t LatencyHistogram::bucketUpper(std::size_t idx)
+{
+    if (idx < 2 * kSub) {
+        return idx;
+    }
+    const unsigned shift = static_cast<unsigned>(idx / kSub - 1);
+    const std::uint64_t mantissa = idx - shift * kSub;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(std::uint64_t ns)
+{
+    buckets_[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(ns, std::memory_order_relaxed);
+
+    std::uint64_t cur = min_.load(std::memory_order_relaxed);
+    while (ns < cur && !min_.compare_exchange_weak(cur, ns, std::memory_order_relaxed)) {
+    }
+    cur = max_.load(std::memory_order_relaxed);
+    while (ns > cur && !max_.compare_exchange_weak(cur, ns, std::memory_order_relaxed)) {
+    }
+}
+
+std::uint64_t LatencyHistogram::percentile(double q) const
+{
+    const std::uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    if (q < 0.0) {
+        q = 0.0;
+    }
+    if (q > 1.0) {
+        q = 1.0;
+    }
+
+    std::uint64_t rank = static_cast<std::uint64_t>(q * static_cast<double>(total) + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; i++) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            const std::uint64_t upper = bucketUpper(i);
+            const std::uint64_t mx = max_.load(std::memory_order_relaxed);
+            return upper < mx ? upper : mx;
+        }
+    }
+    return max_.load(std::memory_order_relaxed);
+}
+
+LatencySummary LatencyHistogram::summary() const
+{
+    LatencySummary s;
+    s.count = count();
+    if (s.count == 0) {
+        return s;
+    }
+    s.minNs = min_.load(std::memory_order_relaxed);
+    s.maxNs = max_.load(std::memory_order_relaxed);
+    s.meanNs = static_cast<double>(sum_.load(std::memory_order_relaxed)) / static_cast<double>(s.count);
+    s.p50Ns = percentile(0.50);
+    s.p90Ns = percentile(0.90);
+    s.p99Ns = percentile(0.99);
+    s.p999Ns = percentile(0.999);
+    return s;
+}
+
+void LatencyHistogram::reset()
+{
+    for (std::size_t i = 0; i < kBuckets; i++) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+} // namespace caClientLib
@@ -0,0 +1,354 @@
+#include "caClientLib/MonitorHub.h"
+#include "caClientLib/CaLatencyStats.h"
+#include "caClientLib/CaStatus.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iterator>
+#include <stdexcept>
+
+namespace caClientLib {
+
+namespace {
+
+bool parseNumber(const MonitorUpdate &u, double &out)
+{
+    const char *s = u.value.c_str();
+    char *end = 0;
+    out = std::strtod(s, &end);
+    return end != s && *end == '\0';
+}
+
+} // namespace
+
+MonitorHub::MonitorHub(IMonitorHandler &consumer, std::size_t queueCapacity, OverflowPolicy overflow)
+    : consumer_(&consumer),
+      overflow_(overflow),
+      ring_(queueCapacity),
+      running_(false),
+      sleeping_(false),
+      anyHeld_(false),
+      received_(0),
+      delivered_(0),
+      dropped_(0),
+      highWater_(0)
+{
+    if (!ca_preemtive_callback_is_enabled()) {
+        throw std::runtime_error("MonitorHub requires a preemptive CA context");
+    }
+}
+
+MonitorHub::~MonitorHub()
+{
+    // Stop the consumer first: queued updates refer to subscription names,
+    // so none may be delivered once the subscriptions are gone. Events that
+    // arrive in between are dropped (Block gives up once the consumer stops).
+    stop();
+    unsubscribeAll();
+}
+
+void MonitorHub::subscribe(const std::string &pvName, double timeoutSec, const MonitorPolicy &policy)
+{
+    const std::vector<std::string> failed = subscribe(std::vector<std::string>(1, pvName), timeoutSec, policy);
+    if (!failed.empty()) {
+        CaStatus::requireOk(ECA_TIMEOUT, "ca_pend_io (connect)");
+    }
+}
+
+std::vector<std::string> MonitorHub::subscribe(const std::vector<std::string> &pvNames, double timeoutSec,
+                                               const MonitorPolicy &policy)
+{
+    // Connect outside subsLock_: the wait can take the whole timeout, and
+    // the consumer needs the lock to flush held values (and may subscribe
+    // from onUpdate()). The list nodes keep their addresses when spliced in,
+    // so CA callbacks may start before that.
+    std::vector<std::string> failed;
+    std::list<Subscription> created;
+
+    for (const std::string &pv : pvNames) {
+        created.emplace_back();
+        std::list<Subscription>::iterator sub = std::prev(created.end());
+        sub->hub = this;
+        sub->pvName = pv;
+        sub->gate = MonitorGate(policy);
+        if (ca_create_channel(sub->pvName.c_str(), 0, 0, CA_PRIORITY_DEFAULT, &sub->chid_) != ECA_NORMAL) {
+            failed.push_back(pv);
+            created.erase(sub);
+        }
+    }
+
+    ca_pend_io(timeoutSec);
+
+    for (std::list<Subscription>::iterator sub = created.begin(); sub != created.end();) {
+        if (ca_state(sub->chid_) == cs_conn && subscribeConnected(*sub) == ECA_NORMAL) {
+            ++sub;
+            continue;
+        }
+        failed.push_back(sub->pvName);
+        ca_clear_channel(sub->chid_);
+        sub = created.erase(sub);
+    }
+
+    ca_flush_io();
+
+    if (!created.empty()) {
+        {
+            std::lock_guard<std::mutex> guard(subsLock_);
+            subs_.splice(subs_.end(), created);
+        }
+        // A value held before the splice was not visible to flushHeld().
+        anyHeld_.store(true);
+    }
+    return failed;
+}
+
+int MonitorHub::subscribeConnected(Subscription &sub)
+{
+    return ca_create_subscription(
+        DBR_TIME_STRING,
+        1,
+        sub.chid_,
+        DBE_VALUE | DBE_ALARM,
+        &MonitorHub::callback,
+        &sub,
+        &sub.evid_);
+}
+
+void MonitorHub::unsubscribeAll()
+{
+    std::lock_guard<std::mutex> guard(subsLock_);
+    for (Subscription &sub : subs_) {
+        if (sub.evid_) {
+            ca_clear_subscription(sub.evid_);
+        }
+        if (sub.chid_) {
+            ca_clear_channel(sub.chid_);
+        }
+    }
+    subs_.clear();
+}
+
+void MonitorHub::callback(struct event_handler_args args)
+{
+    if (args.status != ECA_NORMAL || args.dbr == 0) {
+        return;
+    }
+
+    Subscription *sub = static_cast<Subscription *>(args.usr);
+    if (!sub || !sub->hub) {
+        return;
+    }
+
+    sub->hub->enqueue(*sub, *static_cast<const dbr_time_string *>(args.dbr));
+}
+
+void MonitorHub::enqueue(Subscription &sub, const dbr_time_string &v)
+{
+    received_.fetch_add(1, std::memory_order_relaxed);
+
+    MonitorUpdate u;
+    fillMonitorUpdate(sub.pvName, v, u);
+    CaLatencyStats::recordMonitorLag(u.ts);
+
+    if (!sub.gate.policy().active()) {
+        push(u);
+        return;
+    }
+
+    const MonitorPolicy &policy = sub.gate.policy();
+    double value = 0.0;
+    const bool numeric = (policy.absDeadband > 0.0 || policy.relDeadband > 0.0) && parseNumber(u, value);
+    const MonitorGate::Clock::time_point now = MonitorGate::Clock::now();
+
+    MonitorUpdate due;
+    bool flushHeld = false;
+    MonitorGate::Decision d;
+    {
+        std::lock_guard<std::mutex> guard(sub.lock);
+        if (sub.gate.holdDue(now)) {
+            due = sub.held;
+            sub.gate.takeHeld(now);
+            flushHeld = true;
+        }
+        d = sub.gate.offer(numeric, value, u.alarmSeverity, now);
+        if (d == MonitorGate::Hold) {
+            sub.held = u;
+        }
+    }
+
+    if (flushHeld) {
+        push(due);
+    }
+    if (d == MonitorGate::Deliver) {
+        push(u);
+    } else if (d == MonitorGate::Hold && !anyHeld_.exchange(true)) {
+        wakeConsumer(); // let it schedule the flush
+    }
+}
+
+void MonitorHub::push(const MonitorUpdate &u)
+{
+    switch (overflow_) {
+    case OverflowPolicy::DropNewest:
+        if (!ring_.tryPush(u)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        break;
+
+    case OverflowPolicy::DropOldest:
+        while (!ring_.tryPush(u)) {
+            MonitorUpdate oldest;
+            if (ring_.tryPop(oldest)) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        break;
+
+    case OverflowPolicy::Block:
+        while (!ring_.tryPush(u)) {
+            if (!running_.load()) {
+                // Nobody will drain the ring; blocking would hang CA.
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            wakeConsumer();
+            std::this_thread::yield();
+        }
+        break;
+    }
+
+    const std::size_t depth = ring_.size();
+    std::size_t hw = highWater_.load(std::memory_order_relaxed);
+    while (depth > hw && !highWater_.compare_exchange_weak(hw, depth, std::memory_order_relaxed)) {
+    }
+
+    if (sleeping_.load()) {
+        wakeConsumer();
+    }
+}
+
+void MonitorHub::wakeConsumer()
+{
+    std::lock_guard<std::mutex> guard(wakeLock_);
+    wake_.notify_one();
+}
+
+void MonitorHub::deliver(const MonitorUpdate &u)
+{
+    consumer_->onUpdate(u);
+    delivered_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MonitorHub::start()
+{
+    if (running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread(&MonitorHub::consumerLoop, this);
+}
+
+void MonitorHub::stop()
+{
+    if (!running_.exchange(false)) {
+        return;
+    }
+    wakeConsumer();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+// Delivers held values whose rate-limit interval has elapsed and returns
+// the earliest time another one becomes due (time_point::max() if none).
+MonitorGate::Clock::time_point MonitorHub::flushHeld()
+{
+    MonitorGate::Clock::time_point next = MonitorGate::Clock::time_point::max();
+    if (!anyHeld_.exchange(false)) {
+        return next;
+    }
+
+    const MonitorGate::Clock::time_point now = MonitorGate::Clock::now();
+    bool stillHeld = false;
+
+    // Collect under the locks, deliver after: onUpdate() may be slow or call
+    // back into the hub.
+    flushing_.clear();
+    {
+        std::lock_guard<std::mutex> subsGuard(subsLock_);
+        for (Subscription &sub : subs_) {
+            std::lock_guard<std::mutex> guard(sub.lock);
+            if (!sub.gate.holding()) {
+                continue;
+            }
+            if (!sub.gate.holdDue(now)) {
+                stillHeld = true;
+                if (sub.gate.nextAllowed() < next) {
+                    next = sub.gate.nextAllowed();
+                }
+                continue;
+            }
+            flushing_.push_back(sub.held);
+            sub.gate.takeHeld(now);
+        }
+    }
+
+    if (stillHeld) {
+        anyHeld_.store(true);
+    }
+    for (const MonitorUpdate &u : flushing_) {
+        deliver(u);
+    }
+    return next;
+}
+
+void MonitorHub::consumerLoop()
+{
+    MonitorUpdate u;
+    for (;;) {
+        while (ring_.tryPop(u)) {
+            deliver(u);
+        }
+
+        const MonitorGate::Clock::time_point nextFlush = flushHeld();
+
+        if (!running_.load()) {
+            break;
+        }
+
+        // Park until a producer signals. sleeping_ is raised before the final
+        // emptiness check so a concurrent push either sees it or we see the item.
+        MonitorGate::Clock::time_point deadline = MonitorGate::Clock::now() + std::chrono::milliseconds(100);
+        if (nextFlush < deadline) {
+            deadline = nextFlush;
+        }
+
+        std::unique_lock<std::mutex> lock(wakeLock_);
+        sleeping_.store(true);
+        if (ring_.empty() && running_.load()) {
+            wake_.wait_until(lock, deadline);
+        }
+        sleeping_.store(false);
+    }
+}
+
+MonitorHubStats MonitorHub::stats() const
+{
+    MonitorHubStats s;
+    s.queueDepth = ring_.size();
+    s.queueHighWater = highWater_.load(std::memory_order_relaxed);
+    s.queueCapacity = ring_.capacity();
+    s.received = received_.load(std::memory_order_relaxed);
+    s.delivered = delivered_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> subsGuard(subsLock_);
+    for (const Subscription &sub : subs_) {
+        std::lock_guard<std::mutex> guard(sub.lock);
+        s.suppressed += sub.gate.stats().suppressed;
+        s.coalesced += sub.gate.stats().coalesced;
+    }
+    return s;
+}
+
+} // namespace caClientLib
@@ -0,0 +1,87 @@
+#include "caClientLib/MonitorPolicy.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace caClientLib {
+
+MonitorGate::MonitorGate(const MonitorPolicy &policy)
+    : policy_(policy),
+      minInterval_(Clock::duration::zero()),
+      hasLast_(false),
+      last_(0.0),
+      lastSeverity_(0),
+      holding_(false),
+      heldNumeric_(false),
+      heldValue_(0.0),
+      heldSeverity_(0),
+      nextAllowed_()
+{
+    if (policy_.maxRateHz > 0.0) {
+        minInterval_ = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / policy_.maxRateHz));
+    }
+}
+
+MonitorGate::Decision MonitorGate::offer(bool numeric, double value, short severity, Clock::time_point now)
+{
+    if (numeric && hasLast_ && severity == lastSeverity_ &&
+        (policy_.absDeadband > 0.0 || policy_.relDeadband > 0.0)) {
+        const double band = std::max(policy_.absDeadband, policy_.relDeadband * std::fabs(last_));
+        if (std::fabs(value - last_) <= band) {
+            if (holding_) {
+                // Back within the band of the last delivered value: the held
+                // value is stale and must not go out later.
+                ++stats_.coalesced;
+                holding_ = false;
+            }
+            ++stats_.suppressed;
+            return Suppress;
+        }
+    }
+
+    if (minInterval_ > Clock::duration::zero() && now < nextAllowed_) {
+        if (holding_) {
+            ++stats_.coalesced;
+        }
+        holding_ = true;
+        heldNumeric_ = numeric;
+        heldValue_ = value;
+        heldSeverity_ = severity;
+        return Hold;
+    }
+
+    if (holding_) {
+        // The held value is superseded by this one, which may go out now.
+        ++stats_.coalesced;
+        holding_ = false;
+    }
+
+    hasLast_ = numeric;
+    last_ = value;
+    lastSeverity_ = severity;
+    delivered(now);
+    return Deliver;
+}
+
+void MonitorGate::takeHeld(Clock::time_point now)
+{
+    if (!holding_) {
+        return;
+    }
+    holding_ = false;
+    hasLast_ = heldNumeric_;
+    last_ = heldValue_;
+    lastSeverity_ = heldSeverity_;
+    delivered(now);
+}
+
+void MonitorGate::delivered(Clock::time_point now)
+{
+    ++stats_.passed;
+    if (minInterval_ > Clock::duration::zero()) {
+        nextAllowed_ = now + minInterval_;
+    }
+}
+
+} // namespace caClientLib
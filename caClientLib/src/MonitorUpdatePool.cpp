@@ -0,0 +1,92 @@
+#include "caClientLib/MonitorUpdatePool.h"
+
+#include <algorithm>
+
+namespace caClientLib {
+
+namespace {
+
+// Enough for typical record names, so recycled entries rarely regrow.
+const std::size_t kNameReserve = 64;
+
+} // namespace
+
+void RetainedMonitorUpdate::assign(const MonitorUpdate &u)
+{
+    pvName.assign(u.pvName.data(), u.pvName.size());
+    value = u.value;
+    alarmStatus = u.alarmStatus;
+    alarmSeverity = u.alarmSeverity;
+    ts = u.ts;
+}
+
+MonitorUpdate RetainedMonitorUpdate::view() const
+{
+    MonitorUpdate u;
+    u.pvName = pvName;
+    u.value = value;
+    u.alarmStatus = alarmStatus;
+    u.alarmSeverity = alarmSeverity;
+    u.ts = ts;
+    return u;
+}
+
+MonitorUpdatePool::MonitorUpdatePool(std::size_t preallocate, std::size_t maxFree)
+    : capacity_(std::max(preallocate, maxFree))
+{
+    free_.reserve(capacity_);
+    for (std::size_t i = 0; i < preallocate; i++) {
+        RetainedMonitorUpdate *p = new RetainedMonitorUpdate;
+        p->pvName.reserve(kNameReserve);
+        free_.push_back(p);
+    }
+}
+
+MonitorUpdatePool::~MonitorUpdatePool()
+{
+    for (RetainedMonitorUpdate *p : free_) {
+        delete p;
+    }
+}
+
+MonitorUpdatePool::Handle MonitorUpdatePool::retain(const MonitorUpdate &u)
+{
+    RetainedMonitorUpdate *p = 0;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (!free_.empty()) {
+            p = free_.back();
+            free_.pop_back();
+        }
+    }
+    if (!p) {
+        p = new RetainedMonitorUpdate;
+        p->pvName.reserve(kNameReserve);
+    }
+
+    p->assign(u);
+    return Handle(p, Recycler{this});
+}
+
+void MonitorUpdatePool::recycle(RetainedMonitorUpdate *p)
+{
+    if (!p) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (free_.size() < capacity_) {
+            free_.push_back(p);
+            return;
+        }
+    }
+    delete p;
+}
+
+std::size_t MonitorUpdatePool::available() const
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    return free_.size();
+}
+
+} // namespace caClientLib
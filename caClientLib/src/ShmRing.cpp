@@ -0,0 +1,308 @@
+#include "caClientLib/ShmRing.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace caClientLib {
+
+namespace {
+
+// Bounds the wait for a slot the writer is filling, so a writer that died
+// mid-update cannot hang a reader.
+const int kMaxSpins = 1000;
+
+std::runtime_error sysError(const std::string &what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+std::size_t segmentBytes(std::size_t capacity)
+{
+    return sizeof(shm::SegmentHeader) + capacity * sizeof(shm::Slot);
+}
+
+std::size_t roundCapacity(std::size_t n)
+{
+    std::size_t c = 2;
+    while (c < n) {
+        c <<= 1;
+    }
+    return c;
+}
+
+std::uint64_t nowNs()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// Marks a segment we are about to replace as Closed so its readers notice.
+void closeStale(int fd, std::size_t size)
+{
+    if (size < sizeof(shm::SegmentHeader)) {
+        return;
+    }
+    void *m = mmap(0, sizeof(shm::SegmentHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m != MAP_FAILED) {
+        static_cast<shm::SegmentHeader *>(m)->state.store(shm::Closed, std::memory_order_release);
+        munmap(m, sizeof(shm::SegmentHeader));
+    }
+}
+
+int openLocked(const std::string &name, int flags)
+{
+    const int fd = shm_open(name.c_str(), flags | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw sysError("shm_open " + name);
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        const int err = errno;
+        ::close(fd);
+        if (err == EWOULDBLOCK) {
+            throw std::runtime_error(name + ": already published by another writer");
+        }
+        errno = err;
+        throw sysError("flock " + name);
+    }
+    return fd;
+}
+
+} // namespace
+
+std::string shmRingName(const std::string &pvName)
+{
+    std::string name = "/cacl." + pvName;
+    for (std::size_t i = 1; i < name.size(); i++) {
+        if (name[i] == '/') {
+            name[i] = '_';
+        }
+    }
+    return name;
+}
+
+ShmRingWriter::ShmRingWriter(const std::string &pvName, std::size_t capacity, bool unlinkOnClose)
+    : pvName_(pvName), name_(shmRingName(pvName)), unlinkOnClose_(unlinkOnClose), fd_(-1), map_(0), mapBytes_(0),
+      header_(0), slots_(0), mask_(roundCapacity(capacity) - 1), next_(0)
+{
+    mapBytes_ = segmentBytes(mask_ + 1);
+    fd_ = openLocked(name_, O_CREAT);
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        const std::runtime_error e = sysError("stat " + name_);
+        ::close(fd_);
+        throw e;
+    }
+    if (st.st_size != 0 && static_cast<std::size_t>(st.st_size) != mapBytes_) {
+        closeStale(fd_, static_cast<std::size_t>(st.st_size));
+        shm_unlink(name_.c_str());
+        ::close(fd_);
+        fd_ = openLocked(name_, O_CREAT | O_EXCL);
+    }
+
+    if (ftruncate(fd_, static_cast<off_t>(mapBytes_)) != 0) {
+        const std::runtime_error e = sysError("ftruncate " + name_);
+        ::close(fd_);
+        throw e;
+    }
+    map_ = mmap(0, mapBytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        const std::runtime_error e = sysError("mmap " + name_);
+        ::close(fd_);
+        throw e;
+    }
+    header_ = static_cast<shm::SegmentHeader *>(map_);
+    slots_ = reinterpret_cast<shm::Slot *>(static_cast<char *>(map_) + sizeof(shm::SegmentHeader));
+
+    // Readers of a previous writer may still be attached: reset head and the
+    // slot sequences before announcing the new generation.
+    header_->head.store(0, std::memory_order_relaxed);
+    for (std::size_t i = 0; i <= mask_; i++) {
+        slots_[i].seq.store(0, std::memory_order_relaxed);
+    }
+    std::memcpy(header_->magic, shm::kMagic, sizeof(header_->magic));
+    header_->version = shm::kVersion;
+    header_->capacity = static_cast<std::uint32_t>(mask_ + 1);
+    std::memset(header_->pvName, 0, sizeof(header_->pvName));
+    std::memcpy(header_->pvName, pvName_.data(), std::min(pvName_.size(), sizeof(header_->pvName) - 1));
+    header_->generation.store(nowNs(), std::memory_order_release);
+    header_->state.store(shm::Live, std::memory_order_release);
+}
+
+ShmRingWriter::~ShmRingWriter()
+{
+    header_->state.store(shm::Closed, std::memory_order_release);
+    munmap(map_, mapBytes_);
+    if (unlinkOnClose_) {
+        shm_unlink(name_.c_str());
+    }
+    ::close(fd_); // drops the flock
+}
+
+void ShmRingWriter::publish(const MonitorUpdate &u)
+{
+    const std::uint64_t i = next_;
+    shm::Slot &s = slots_[i & mask_];
+    s.seq.store(2 * i + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s.secPastEpoch = u.ts.secPastEpoch;
+    s.nsec = u.ts.nsec;
+    s.status = u.alarmStatus;
+    s.severity = u.alarmSeverity;
+    s.length = static_cast<std::uint16_t>(u.value.size());
+    std::memcpy(s.value, u.value.data(), u.value.size());
+
+    s.seq.store(2 * i + 2, std::memory_order_release);
+    header_->head.store(i + 1, std::memory_order_release);
+    next_ = i + 1;
+}
+
+ShmRingReader::ShmRingReader(const std::string &pvName)
+    : pvName_(pvName), name_(shmRingName(pvName)), map_(0), mapBytes_(0), header_(0), slots_(0), mask_(0),
+      generation_(0), cursor_(0)
+{
+    const int fd = shm_open(name_.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        throw sysError("shm_open " + name_);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        const std::runtime_error e = sysError("stat " + name_);
+        ::close(fd);
+        throw e;
+    }
+    mapBytes_ = static_cast<std::size_t>(st.st_size);
+    if (mapBytes_ < sizeof(shm::SegmentHeader)) {
+        ::close(fd);
+        throw std::runtime_error(name_ + ": not a monitor ring (or its writer is still starting)");
+    }
+    void *m = mmap(0, mapBytes_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        throw sysError("mmap " + name_);
+    }
+    map_ = m;
+    header_ = static_cast<const shm::SegmentHeader *>(map_);
+    slots_ = reinterpret_cast<const shm::Slot *>(static_cast<const char *>(map_) + sizeof(shm::SegmentHeader));
+
+    const std::size_t capacity = header_->capacity;
+    if (std::memcmp(header_->magic, shm::kMagic, sizeof(shm::kMagic)) != 0 || header_->version != shm::kVersion ||
+        capacity < 2 || (capacity & (capacity - 1)) != 0 || mapBytes_ < segmentBytes(capacity)) {
+        munmap(m, mapBytes_);
+        throw std::runtime_error(name_ + ": not a monitor ring (or unsupported version)");
+    }
+    mask_ = capacity - 1;
+    generation_ = header_->generation.load(std::memory_order_acquire);
+    cursor_ = published();
+}
+
+ShmRingReader::~ShmRingReader()
+{
+    munmap(const_cast<void *>(map_), mapBytes_);
+}
+
+bool ShmRingReader::read(std::uint64_t index, MonitorUpdate &out) const
+{
+    const shm::Slot &s = slots_[index & mask_];
+    const std::uint64_t done = 2 * index + 2;
+    for (int spin = 0; spin < kMaxSpins; spin++) {
+        const std::uint64_t before = s.seq.load(std::memory_order_acquire);
+        if (before == done - 1) {
+            continue; // the writer is filling this slot
+        }
+        if (before != done) {
+            return false; // overwritten by a later update, or re-initialized
+        }
+
+        const std::uint32_t sec = s.secPastEpoch;
+        const std::uint32_t nsec = s.nsec;
+        const std::int16_t status = s.status;
+        const std::int16_t severity = s.severity;
+        const std::size_t length = s.length;
+        char value[MAX_STRING_SIZE];
+        std::memcpy(value, s.value, sizeof(value));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.seq.load(std::memory_order_relaxed) != done) {
+            return false;
+        }
+
+        out.pvName = pvName_;
+        out.value.assign(value, length < sizeof(value) ? length : sizeof(value));
+        out.alarmStatus = status;
+        out.alarmSeverity = severity;
+        out.ts.secPastEpoch = sec;
+        out.ts.nsec = nsec;
+        return true;
+    }
+    return false;
+}
+
+bool ShmRingReader::latest(MonitorUpdate &out) const
+{
+    // Retry if the slot was lapped between reading head and copying it.
+    for (int attempt = 0; attempt < 4; attempt++) {
+        const std::uint64_t head = published();
+        if (head == 0) {
+            return false;
+        }
+        if (read(head - 1, out)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShmRingReader::seekToOldest()
+{
+    checkGeneration();
+    const std::uint64_t head = published();
+    cursor_ = head > capacity() ? head - capacity() : 0;
+}
+
+void ShmRingReader::checkGeneration()
+{
+    const std::uint64_t g = header_->generation.load(std::memory_order_acquire);
+    if (g != generation_) {
+        generation_ = g;
+        cursor_ = 0;
+    }
+}
+
+bool ShmRingReader::next(MonitorUpdate &out, std::uint64_t *lost)
+{
+    checkGeneration();
+    const std::uint64_t head = published();
+    if (cursor_ > head) {
+        cursor_ = 0; // re-initialized; the new generation is not visible yet
+    }
+    if (head - cursor_ > capacity()) {
+        if (lost) {
+            *lost += head - capacity() - cursor_;
+        }
+        cursor_ = head - capacity();
+    }
+    while (cursor_ < head) {
+        const std::uint64_t index = cursor_++;
+        if (read(index, out)) {
+            return true;
+        }
+        if (lost) {
+            ++*lost;
+        }
+    }
+    return false;
+}
+
+} // namespace caClientLib
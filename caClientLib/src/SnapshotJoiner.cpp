@@ -0,0 +1,196 @@
+#include "caClientLib/SnapshotJoiner.h"
+
+#include "caClientLib/CaptureFormat.h"
+
+#include <epicsTime.h>
+
+#include <stdexcept>
+
+namespace caClientLib {
+
+class SnapshotJoiner::Input final : public ITypedMonitorHandler<double> {
+public:
+    Input(SnapshotJoiner &joiner, std::size_t col) : joiner_(joiner), col_(col) {}
+
+    void onUpdate(const TypedUpdate<double> &u) override
+    {
+        joiner_.add(col_, capture::toNs(u.ts), u.value, u.alarmStatus, u.alarmSeverity);
+    }
+
+private:
+    SnapshotJoiner &joiner_;
+    std::size_t col_;
+};
+
+void SnapshotJoiner::Series::push(const Sample &s)
+{
+    if (size_ == buf_.size()) {
+        buf_[start_] = s;
+        start_ = (start_ + 1) % buf_.size();
+    } else {
+        buf_[(start_ + size_) % buf_.size()] = s;
+        size_++;
+    }
+}
+
+std::size_t SnapshotJoiner::Series::upperBound(std::int64_t ns) const
+{
+    std::size_t lo = 0;
+    std::size_t hi = size_;
+    while (lo < hi) {
+        const std::size_t mid = lo + (hi - lo) / 2;
+        if (at(mid).ns <= ns) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+SnapshotJoiner::SnapshotJoiner(const std::vector<std::string> &pvNames, ISnapshotHandler &handler,
+                               const SnapshotOptions &opt)
+    : handler_(handler), opt_(opt), nextGridNs_(0)
+{
+    if (opt_.depth == 0) {
+        throw std::invalid_argument("SnapshotJoiner: depth must be > 0");
+    }
+    if (opt_.trigger >= static_cast<int>(pvNames.size())) {
+        throw std::invalid_argument("SnapshotJoiner: trigger column out of range");
+    }
+    columns_.reserve(pvNames.size());
+    for (std::size_t i = 0; i < pvNames.size(); i++) {
+        columns_.push_back(Column{pvNames[i], Series(opt_.depth), std::unique_ptr<Input>(new Input(*this, i))});
+    }
+    row_.cells.resize(columns_.size());
+}
+
+SnapshotJoiner::~SnapshotJoiner() = default;
+
+ITypedMonitorHandler<double> &SnapshotJoiner::input(std::size_t col)
+{
+    return *columns_[col].input;
+}
+
+void SnapshotJoiner::add(std::size_t col, std::int64_t ns, double value, short status, short severity)
+{
+    Series &s = columns_[col].series;
+    if (s.size() > 0 && ns < s.back().ns) {
+        stats_.outOfOrder++;
+        return;
+    }
+    s.push(Sample{ns, value, status, severity});
+    stats_.samples++;
+
+    if (static_cast<int>(col) != opt_.trigger) {
+        return;
+    }
+    if (opt_.lagNs <= 0) {
+        emit(ns);
+        return;
+    }
+    if (triggers_.size() == opt_.depth) {
+        triggers_.pop_front();
+        stats_.triggersDropped++;
+    }
+    triggers_.push_back(ns);
+}
+
+void SnapshotJoiner::advance()
+{
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    advance(capture::toNs(now));
+}
+
+void SnapshotJoiner::advance(std::int64_t nowNs)
+{
+    const std::int64_t limit = nowNs - opt_.lagNs;
+    if (opt_.gridNs > 0 && nextGridNs_ == 0) {
+        nextGridNs_ = (limit / opt_.gridNs + 1) * opt_.gridNs;
+    }
+
+    // Grid and trigger rows in time order.
+    for (;;) {
+        const bool grid = opt_.gridNs > 0 && nextGridNs_ <= limit;
+        const bool trig = !triggers_.empty() && triggers_.front() <= limit;
+        if (trig && (!grid || triggers_.front() <= nextGridNs_)) {
+            const std::int64_t ns = triggers_.front();
+            triggers_.pop_front();
+            emit(ns);
+        } else if (grid) {
+            emit(nextGridNs_);
+            nextGridNs_ += opt_.gridNs;
+        } else {
+            break;
+        }
+    }
+}
+
+void SnapshotJoiner::cell(const Series &s, std::int64_t ns, SnapshotCell &out) const
+{
+    out.valid = false;
+    const std::size_t i = s.upperBound(ns);
+
+    if (opt_.mode == JoinMode::Exact) {
+        const Sample *best = 0;
+        std::int64_t bestDt = 0;
+        if (i > 0) {
+            best = &s.at(i - 1);
+            bestDt = ns - best->ns;
+        }
+        if (i < s.size() && (!best || s.at(i).ns - ns < bestDt)) {
+            best = &s.at(i);
+            bestDt = best->ns - ns;
+        }
+        if (best && bestDt <= opt_.toleranceNs) {
+            out.value = best->value;
+            out.ns = best->ns;
+            out.status = best->status;
+            out.severity = best->severity;
+            out.valid = true;
+        }
+        return;
+    }
+
+    if (i == 0) {
+        return;
+    }
+    const Sample &a = s.at(i - 1);
+    if (opt_.toleranceNs > 0 && ns - a.ns > opt_.toleranceNs) {
+        return;
+    }
+    out.value = a.value;
+    out.ns = a.ns;
+    out.status = a.status;
+    out.severity = a.severity;
+    out.valid = true;
+
+    if (opt_.mode == JoinMode::Interpolate && a.ns < ns && i < s.size()) {
+        const Sample &b = s.at(i);
+        const double f = static_cast<double>(ns - a.ns) / static_cast<double>(b.ns - a.ns);
+        out.value = a.value + (b.value - a.value) * f;
+        if (b.severity > a.severity) {
+            out.status = b.status;
+            out.severity = b.severity;
+        }
+    }
+}
+
+void SnapshotJoiner::join(std::int64_t ns, Snapshot &row) const
+{
+    row.ns = ns;
+    row.cells.resize(columns_.size());
+    for (std::size_t c = 0; c < columns_.size(); c++) {
+        cell(columns_[c].series, ns, row.cells[c]);
+    }
+}
+
+void SnapshotJoiner::emit(std::int64_t ns)
+{
+    join(ns, row_);
+    stats_.rows++;
+    handler_.onSnapshot(row_);
+}
+
+} // namespace caClientLib
@@ -19,6 +19,7 @@
 
 #include "driver/adc.h"
 #include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_continuous.h"
 
 #include "sdkconfig.h"
 #include "esp_check.h"
@@ -29,6 +30,7 @@
 
 #define USB_BAUD              115200
 #define BUFFER_LENGTH         40
+#define RESPONSE_LENGTH       160   // longest reply line (?all)
 #define COMMAND_LENGTH        16
 #define EOS_TERMINATOR_CHAR   '\n'
 #define UNDEFINED             (-1)
@@ -44,6 +46,101 @@
 #define MULTIPLIER_MIN        1
 #define MULTIPLIER_MAX        1000000
 
+#define DECIMATION_MAX        1000
+
+// Command results. Text mode prints cmd_status_text[status] followed by the
+// offending command line; binary mode sends the number (BIN_OP_ERROR frame).
+typedef enum {
+    CMD_OK = 0,
+    CMD_ERR_MISSING_ARGUMENT,
+    CMD_ERR_INVALID_ARGUMENT,
+    CMD_ERR_PIN_NOT_AVAILABLE,
+    CMD_ERR_BO_PIN_NOT_AVAILABLE,
+    CMD_ERR_PWM_PIN_NOT_AVAILABLE,
+    CMD_ERR_SETTING_PINMODE,
+    CMD_ERR_SETTING_BO_LEVEL,
+    CMD_ERR_PWM_VALUE_OUT_OF_RANGE,
+    CMD_ERR_NO_PWM_SLOTS_AVAILABLE,
+    CMD_ERR_CONFIGURING_LEDC_TIMER,
+    CMD_ERR_CONFIGURING_LEDC_CHANNEL,
+    CMD_ERR_SETTING_PWM_DUTY,
+    CMD_ERR_UPDATING_PWM_DUTY,
+    CMD_ERR_AI_INDEX_OUT_OF_RANGE,
+    CMD_ERR_READING_ADC,
+    CMD_ERR_MULTIPLIER_RANGE,
+    CMD_ERR_UNKNOWN_COMMAND,
+    CMD_ERR_BAD_FRAME,
+} cmd_status_t;
+
+static const char *const cmd_status_text[] = {
+    [CMD_OK]                           = "Ok",
+    [CMD_ERR_MISSING_ARGUMENT]         = "ERROR_MISSING_ARGUMENT: ",
+    [CMD_ERR_INVALID_ARGUMENT]         = "ERROR_INVALID_ARGUMENT: ",
+    [CMD_ERR_PIN_NOT_AVAILABLE]        = "ERROR_PIN_NOT_AVAILABLE: ",
+    [CMD_ERR_BO_PIN_NOT_AVAILABLE]     = "ERROR_BO_PIN_NOT_AVAILABLE: ",
+    [CMD_ERR_PWM_PIN_NOT_AVAILABLE]    = "ERROR_PWM_PIN_NOT_AVAILABLE: ",
+    [CMD_ERR_SETTING_PINMODE]          = "ERROR_SETTING_PINMODE: ",
+    [CMD_ERR_SETTING_BO_LEVEL]         = "ERROR_SETTING_BO_LEVEL: ",
+    [CMD_ERR_PWM_VALUE_OUT_OF_RANGE]   = "ERROR_PWM_VALUE_OUT_OF_RANGE: ",
+    [CMD_ERR_NO_PWM_SLOTS_AVAILABLE]   = "ERROR_NO_PWM_SLOTS_AVAILABLE: ",
+    [CMD_ERR_CONFIGURING_LEDC_TIMER]   = "ERROR_CONFIGURING_LEDC_TIMER: ",
+    [CMD_ERR_CONFIGURING_LEDC_CHANNEL] = "ERROR_CONFIGURING_LEDC_CHANNEL: ",
+    [CMD_ERR_SETTING_PWM_DUTY]         = "ERROR_SETTING_PWM_DUTY: ",
+    [CMD_ERR_UPDATING_PWM_DUTY]        = "ERROR_UPDATING_PWM_DUTY: ",
+    [CMD_ERR_AI_INDEX_OUT_OF_RANGE]    = "ERROR_AI_INDEX_OUT_OF_RANGE: ",
+    [CMD_ERR_READING_ADC]              = "ERROR_READING_ADC: ",
+    [CMD_ERR_MULTIPLIER_RANGE]         = "ERROR_MULTIPLIER_RANGE: ",
+    [CMD_ERR_UNKNOWN_COMMAND]          = "ERROR_UNKNOWN_COMMAND: ",
+    [CMD_ERR_BAD_FRAME]                = "ERROR_BAD_FRAME: ",
+};
+
+// Binary framed protocol, negotiated from text mode:
+//   "?bin"   -> "BIN <version> <max frame bytes>"
+//   "!bin 1" -> "Ok", then both directions switch to frames.
+// A frame is COBS-encoded and terminated by 0x00. Decoded it is
+//   u8 op, u16 id, payload, u16 crc
+// little endian, with CRC-16/CCITT-FALSE over op..payload. A reply echoes
+// the request id with op | BIN_REPLY, or is a BIN_OP_ERROR frame with the
+// cmd_status_t as its one payload byte (id 0 when the request could not be
+// decoded). BIN_OP_TEXT switches back to text mode; a reset always starts
+// in text mode.
+#define BIN_VERSION           1
+#define BIN_FRAME_MAX         96    // decoded frame, header and CRC included
+#define BIN_ENCODED_MAX       (BIN_FRAME_MAX + BIN_FRAME_MAX / 254 + 2)
+
+#define BIN_OP_GET_ALL        0x01  // -> u16 raw[4], f32 mean[4], u32 levels, rate, period_us, multiplier, u8 watched
+#define BIN_OP_GET_INFO       0x02  // -> u8 num_ai, num_bin, u32 period min, max, multiplier min, max, id, version (NUL-terminated)
+#define BIN_OP_SET_BO         0x10  // u8 gpio, u8 level
+#define BIN_OP_SET_PIN        0x11  // u8 gpio, u8 direction (1 = output)
+#define BIN_OP_SET_PWM        0x12  // u8 gpio, u8 duty
+#define BIN_OP_SET_WATCH      0x13  // u8 ai, u8 on
+#define BIN_OP_SET_PERIOD     0x14  // u32 period_us
+#define BIN_OP_SET_MULT       0x15  // u32 multiplier
+#define BIN_OP_SET_STREAM     0x16  // u8 ai mask, u16 decimation
+#define BIN_OP_TEXT           0x1F
+#define BIN_OP_SAMPLE         0x40  // unsolicited, id = sequence: u64 t_us, u32 samples, u8 mask, f32 mean per channel in mask
+#define BIN_OP_ERROR          0x7F
+#define BIN_REPLY             0x80
+
+// Continuous (DMA) acquisition, see Kconfig.projbuild. The ADC converts the
+// channels of adc_channel_map round-robin at CONFIG_EPICS_ADC_SAMPLE_FREQ_HZ
+// conversions per second in total; the driver hands over frames of
+// CONFIG_EPICS_ADC_FRAME_SAMPLES conversions. Without it (or when it cannot
+// be started) the sampling task scans the channels with oneshot reads.
+#ifdef CONFIG_EPICS_ADC_CONTINUOUS
+#define ADC_DMA_FRAME_BYTES   (CONFIG_EPICS_ADC_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)
+#define ADC_DMA_READ_TIMEOUT_MS 100
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_DMA_FORMAT        ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_DMA_CHANNEL(p)    ((p)->type1.channel)
+#define ADC_DMA_DATA(p)       ((p)->type1.data)
+#else
+#define ADC_DMA_FORMAT        ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_DMA_CHANNEL(p)    ((p)->type2.channel)
+#define ADC_DMA_DATA(p)       ((p)->type2.data)
+#endif
+#endif
+
 // ADC mapping
 // cmd_response protocol expects: ?ai <index>
 // ON EPS32-C6 ADC channels are mapped as follows:
@@ -73,16 +170,23 @@ static const adc_channel_map_t adc_channel_map[] = {
 #define NUM_DIGITAL_PINS 22
 static const gpio_num_t invalid_digital_pins[] = {GPIO_NUM_18, GPIO_NUM_19};
 #define NUM_INVALID_DIGITAL_PINS (sizeof(invalid_digital_pins) / sizeof(invalid_digital_pins[0]))
+static bool is_usb_pin(gpio_num_t gpio)
+{
+    for (size_t i = 0; i < NUM_INVALID_DIGITAL_PINS; i++) {
+        if (gpio == invalid_digital_pins[i]) {
+            return true;
+        }
+    }
+    return false;
+}
 static bool is_valid_digital_pin(gpio_num_t gpio)
 {
     if (gpio < GPIO_NUM_0 || gpio >= GPIO_NUM_22) {
         return false;
     }
-    for (size_t i = 0; i < NUM_INVALID_DIGITAL_PINS; i++) {
-        if (gpio == invalid_digital_pins[i]) {
-            ESP_LOGW(SOFTWARE_ID, "GPIO %d is used for USB D+/D-", gpio);
-            return false;
-        }
+    if (is_usb_pin(gpio)) {
+        ESP_LOGW(SOFTWARE_ID, "GPIO %d is used for USB D+/D-", gpio);
+        return false;
     }
     return true;
 }
@@ -99,18 +203,43 @@ static long period_us = PERIOD_DEFAULT_US;
 static long multiplier = MULTIPLIER_DEFAULT;
 
 static int      ai_watched[NUM_AI];
-static int16_t  ai_sums[NUM_AI];
+static int64_t  ai_sums[NUM_AI];
+static uint32_t ai_counts[NUM_AI];   // conversions in ai_sums
 static float    ai_mean[NUM_AI];
+static int      ai_last[NUM_AI];     // newest conversion (continuous mode)
 static int64_t  loop_count = 0;
 static int64_t  loop_rate = 0;
 
-static int64_t nextUpdate_us = 0;
+static int64_t nextUpdate_us = 0;   // end of the current averaging window; guarded by ai_lock
+
+// Streaming: every stream_decimation-th averaging window, ai_sampling_task
+// sends the means of the channels in stream_mask without being asked:
+//   text:   SAMPLE <seq> <t_us> <samples> <mask> <mean0> .. <mean3>  (mean*multiplier, 0 outside the mask)
+//   binary: BIN_OP_SAMPLE frame
+// t_us is esp_timer time at the end of the window.
+static uint8_t  stream_mask = 0;
+static uint16_t stream_decimation = 1;
+static uint16_t stream_countdown = 1;
+static uint16_t stream_seq = 0;
+
+static SemaphoreHandle_t tx_lock; // replies and stream output are whole lines/frames
+
+static bool binary_mode = false;
+static uint8_t frameBuf[BIN_ENCODED_MAX];
+static size_t framePtr = 0;
+static bool frameOverflow = false;
 
 static SemaphoreHandle_t ai_lock;
 
 // ADC oneshot handle (unit per mapping; simplest: assume all units are same)
 static adc_oneshot_unit_handle_t adc_handle = NULL;
 
+// Set when continuous acquisition runs; oneshot reads are not possible then.
+static bool adc_continuous_mode = false;
+#ifdef CONFIG_EPICS_ADC_CONTINUOUS
+static adc_continuous_handle_t adc_dma = NULL;
+#endif
+
 // LEDC channel configuration for PWM output bookkeeping : one channel per pin (simple case)
 typedef struct {
     bool configured;
@@ -122,6 +251,13 @@ typedef struct {
 static pwm_channel_t pwm_channels[PWM_SLOTS];
 
 // Helpers
+static void usb_write(const void *data, size_t len)
+{
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+    usb_serial_jtag_write_bytes(data, len, 20 / portTICK_PERIOD_MS);
+    xSemaphoreGive(tx_lock);
+}
+
 static int freeRamBytes(void){
     multi_heap_info_t info;
     heap_caps_get_info(&info, MALLOC_CAP_8BIT);
@@ -135,12 +271,12 @@ static void uart_write_lines(const char *lines)
         return;
     }
 
-    char buf[BUFFER_LENGTH + 2];
-    size_t len = strnlen(lines, BUFFER_LENGTH);
+    char buf[RESPONSE_LENGTH + 2];
+    size_t len = strnlen(lines, RESPONSE_LENGTH);
     memcpy(buf, lines, len);
     buf[len] = '\n';
     buf[len + 1] = '\0';
-    usb_serial_jtag_write_bytes(buf, len + 1, 20 / portTICK_PERIOD_MS);
+    usb_write(buf, len + 1);
 }
 
 // Reset input buffer and parsing state
@@ -172,7 +308,7 @@ static void finalizeError(const char *prefix, const char *input)
     }
 
     buf[pos++] = '\n';
-    usb_serial_jtag_write_bytes(buf, pos, 20 / portTICK_PERIOD_MS);
+    usb_write(buf, pos);
 }
 
 // very small tokenizer for command parsing : baseCmd [arg1] [arg2]
@@ -214,6 +350,17 @@ static bool gpio_is_reasonable(gpio_num_t gpio)
     return true;
 }
 
+// Text reply for a setter: "Ok" or the error with the command line.
+static void finishCommand(cmd_status_t status)
+{
+    if (status == CMD_OK) {
+        uart_write_lines(cmd_status_text[CMD_OK]);
+    } else {
+        finalizeError(cmd_status_text[status], inputString);
+        resetBuffer();
+    }
+}
+
 // Command handlers
 static void cmd_get_num_ai(const char *input){
     char response[64];
@@ -245,18 +392,24 @@ static void cmd_get_rate(const char *input){
     uart_write_lines(response);
 }
 
+static cmd_status_t set_period(long us)
+{
+    if (us < PERIOD_MIN_US || us > PERIOD_MAX_US) {
+        return CMD_ERR_INVALID_ARGUMENT;
+    }
+    xSemaphoreTake(ai_lock, portMAX_DELAY);
+    period_us = us;
+    nextUpdate_us = esp_timer_get_time(); // Reset update timer
+    xSemaphoreGive(ai_lock);
+    return CMD_OK;
+}
+
 static void cmd_set_period(const char *input){
     if (arg1 == UNDEFINED) {
         finalizeError("ERROR_MISSING_ARGUMENT: ", inputString);
         return;
     }
-    if (arg1 < PERIOD_MIN_US || arg1 > PERIOD_MAX_US) {
-        finalizeError("ERROR_INVALID_ARGUMENT: ", inputString);
-        return;
-    }
-    period_us = arg1;
-    uart_write_lines("Ok");
-    nextUpdate_us = esp_timer_get_time(); // Reset update timer
+    finishCommand(set_period(arg1));
 }
 
 static void cmd_get_period(const char *input){
@@ -276,19 +429,22 @@ static void cmd_get_period_max(const char *input){
     uart_write_lines(response);
 }
 
+static cmd_status_t set_multiplier(long k)
+{
+    if (k < MULTIPLIER_MIN || k > MULTIPLIER_MAX) {
+        return CMD_ERR_MULTIPLIER_RANGE;
+    }
+    multiplier = k;
+    return CMD_OK;
+}
+
 static void cmd_set_multiplier(const char *input){
     if (arg1 == UNDEFINED) {
         finalizeError("ERROR_MISSING_ARGUMENT: ", inputString);
         resetBuffer();
         return;
     }
-    if (arg1 < MULTIPLIER_MIN || arg1 > MULTIPLIER_MAX) {
-        finalizeError("ERROR_MULTIPLIER_RANGE: ", inputString);
-        resetBuffer();
-        return;
-    }
-    multiplier = arg1;
-    uart_write_lines("Ok");
+    finishCommand(set_multiplier(arg1));
 }
 
 static void cmd_get_multiplier(const char *input){
@@ -326,22 +482,14 @@ static void cmd_read_bi(const char *input){
     uart_write_lines(response);
 }
 
-static void cmd_write_bo(const char *input){
-    if (arg1 == UNDEFINED || arg2 == UNDEFINED) {
-        finalizeError("ERROR_MISSING_ARGUMENT: ", inputString);
-        resetBuffer();
-        return;
-    }
-    gpio_num_t gpio = (gpio_num_t)arg1;
+static cmd_status_t write_bo(long pin, long level)
+{
+    gpio_num_t gpio = (gpio_num_t)pin;
     if (!gpio_is_reasonable(gpio)) {
-        finalizeError("ERROR_BO_PIN_NOT_AVAILABLE: ", inputString);
-        resetBuffer();
-        return;
+        return CMD_ERR_BO_PIN_NOT_AVAILABLE;
     }
-    if (arg2 != 0 && arg2 != 1) {
-        finalizeError("ERROR_INVALID_ARGUMENT: ", inputString);
-        resetBuffer();
-        return;
+    if (level != 0 && level != 1) {
+        return CMD_ERR_INVALID_ARGUMENT;
     }
 
     // Arduino-like behavior: ensure the pin is configured as an output
@@ -352,58 +500,53 @@ static void cmd_write_bo(const char *input){
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
         .intr_type = GPIO_INTR_DISABLE,
     };
-    esp_err_t cfg_err = gpio_config(&io_conf);
-    if (cfg_err != ESP_OK) {
-        finalizeError("ERROR_SETTING_PINMODE: ", inputString);
-        resetBuffer();
-        return;
+    if (gpio_config(&io_conf) != ESP_OK) {
+        return CMD_ERR_SETTING_PINMODE;
     }
-
-    esp_err_t err = gpio_set_level(gpio, (uint32_t)arg2);
-    if (err != ESP_OK) {
-        finalizeError("ERROR_SETTING_BO_LEVEL: ", inputString);
-        resetBuffer();
-        return;
+    if (gpio_set_level(gpio, (uint32_t)level) != ESP_OK) {
+        return CMD_ERR_SETTING_BO_LEVEL;
     }
-    uart_write_lines("Ok");
+    return CMD_OK;
 }
 
-static void cmd_set_pinmode(const char *input){
+static void cmd_write_bo(const char *input){
     if (arg1 == UNDEFINED || arg2 == UNDEFINED) {
         finalizeError("ERROR_MISSING_ARGUMENT: ", inputString);
         resetBuffer();
         return;
     }
-    gpio_num_t gpio = (gpio_num_t)arg1;
+    finishCommand(write_bo(arg1, arg2));
+}
+
+static cmd_status_t set_pinmode(long pin, long output)
+{
+    gpio_num_t gpio = (gpio_num_t)pin;
     if (!gpio_is_reasonable(gpio)) {
-        finalizeError("ERROR_PIN_NOT_AVAILABLE: ", inputString);
-        resetBuffer();
-        return;
+        return CMD_ERR_PIN_NOT_AVAILABLE;
     }
-    if (arg2 != 0 && arg2 != 1) {
-        finalizeError("ERROR_INVALID_ARGUMENT: ", inputString);
-        resetBuffer();
-        return;
+    if (output != 0 && output != 1) {
+        return CMD_ERR_INVALID_ARGUMENT;
     }
     gpio_config_t io_conf = {
         .pin_bit_mask = (1ULL << gpio),
-        .mode = GPIO_MODE_DISABLE,
+        .mode = output ? GPIO_MODE_OUTPUT : GPIO_MODE_INPUT,
         .pull_up_en = GPIO_PULLUP_DISABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
         .intr_type = GPIO_INTR_DISABLE,
     };
-    if (arg2 == 0) {
-        io_conf.mode = GPIO_MODE_INPUT;
-    } else {
-        io_conf.mode = GPIO_MODE_OUTPUT;
+    if (gpio_config(&io_conf) != ESP_OK) {
+        return CMD_ERR_SETTING_PINMODE;
     }
-    esp_err_t res2 = gpio_config(&io_conf);
-    if (res2 != ESP_OK) {
-        finalizeError("ERROR_SETTING_PINMODE: ", inputString);
+    return CMD_OK;
+}
+
+static void cmd_set_pinmode(const char *input){
+    if (arg1 == UNDEFINED || arg2 == UNDEFINED) {
+        finalizeError("ERROR_MISSING_ARGUMENT: ", inputString);
         resetBuffer();
         return;
     }
-    uart_write_lines("Ok");
+    finishCommand(set_pinmode(arg1, arg2));
 }
 
 // ... PWM : use LEDC channels
@@ -426,28 +569,18 @@ static pwm_channel_t* pwm_get_or_alloc(gpio_num_t gpio){
     return NULL; // No available slot
 }
 
-static void cmd_write_pwm(const char *input){
-    if (arg1 == UNDEFINED || arg2 == UNDEFINED) {
-        finalizeError("ERROR_MISSING_ARGUMENT: ", inputString);
-        resetBuffer();
-        return;
-    }
-    gpio_num_t gpio = (gpio_num_t)arg1;
+static cmd_status_t write_pwm(long pin, long value)
+{
+    gpio_num_t gpio = (gpio_num_t)pin;
     if (!gpio_is_reasonable(gpio)) {
-        finalizeError("ERROR_PWM_PIN_NOT_AVAILABLE: ", inputString);
-        resetBuffer();
-        return;
+        return CMD_ERR_PWM_PIN_NOT_AVAILABLE;
     }
-    if (arg2 < PWM_MIN_VALUE || arg2 > PWM_MAX_VALUE) {
-        finalizeError("ERROR_PWM_VALUE_OUT_OF_RANGE: ", inputString);
-        resetBuffer();
-        return;
+    if (value < PWM_MIN_VALUE || value > PWM_MAX_VALUE) {
+        return CMD_ERR_PWM_VALUE_OUT_OF_RANGE;
     }
     pwm_channel_t *pwm_chan = pwm_get_or_alloc(gpio);
     if (pwm_chan == NULL) {
-        finalizeError("ERROR_NO_PWM_SLOTS_AVAILABLE: ", inputString);
-        resetBuffer();
-        return;
+        return CMD_ERR_NO_PWM_SLOTS_AVAILABLE;
     }
     // Configure LEDC for this pin if not already done
     static bool ledc_initialized = false;
@@ -459,11 +592,8 @@ static void cmd_write_pwm(const char *input){
             .freq_hz          = 1000000 / period_us, // Frequency in Hz
             .clk_cfg          = LEDC_AUTO_CLK,
         };
-        esp_err_t res1 = ledc_timer_config(&ledc_timer);
-        if (res1 != ESP_OK) {
-            finalizeError("ERROR_CONFIGURING_LEDC_TIMER: ", inputString);
-            resetBuffer();
-            return;
+        if (ledc_timer_config(&ledc_timer) != ESP_OK) {
+            return CMD_ERR_CONFIGURING_LEDC_TIMER;
         }
         ledc_initialized = true;
     }
@@ -477,27 +607,37 @@ static void cmd_write_pwm(const char *input){
         .duty           = 0, // will set later
         .hpoint         = 0,
     };
-    esp_err_t res2 = ledc_channel_config(&ledc_channel);
-    if (res2 != ESP_OK) {
-        finalizeError("ERROR_CONFIGURING_LEDC_CHANNEL: ", inputString);
-        resetBuffer();
-        return;
+    if (ledc_channel_config(&ledc_channel) != ESP_OK) {
+        return CMD_ERR_CONFIGURING_LEDC_CHANNEL;
     }
     // Set duty
-    uint32_t duty = (uint32_t)arg2; // 0-255
-    esp_err_t res3 = ledc_set_duty(LEDC_LOW_SPEED_MODE, pwm_chan->ledc_channel, duty);
-    if (res3 != ESP_OK) {
-        finalizeError("ERROR_SETTING_PWM_DUTY: ", inputString);
-        resetBuffer();
-        return;
+    if (ledc_set_duty(LEDC_LOW_SPEED_MODE, pwm_chan->ledc_channel, (uint32_t)value) != ESP_OK) {
+        return CMD_ERR_SETTING_PWM_DUTY;
     }
-    esp_err_t res4 = ledc_update_duty(LEDC_LOW_SPEED_MODE, pwm_chan->ledc_channel);
-    if (res4 != ESP_OK) {
-        finalizeError("ERROR_UPDATING_PWM_DUTY: ", inputString);
+    if (ledc_update_duty(LEDC_LOW_SPEED_MODE, pwm_chan->ledc_channel) != ESP_OK) {
+        return CMD_ERR_UPDATING_PWM_DUTY;
+    }
+    return CMD_OK;
+}
+
+static void cmd_write_pwm(const char *input){
+    if (arg1 == UNDEFINED || arg2 == UNDEFINED) {
+        finalizeError("ERROR_MISSING_ARGUMENT: ", inputString);
         resetBuffer();
         return;
     }
-    uart_write_lines("Ok");
+    finishCommand(write_pwm(arg1, arg2));
+}
+
+// Raw value of AI index; called with ai_lock held. While continuous
+// acquisition owns the ADC this is its newest conversion.
+static esp_err_t read_raw(int index, int *raw)
+{
+    if (adc_continuous_mode) {
+        *raw = ai_last[index];
+        return ESP_OK;
+    }
+    return adc_oneshot_read(adc_handle, adc_channel_map[index].channel, raw);
 }
 
 static void cmd_read_ai(const char *input){
@@ -518,7 +658,9 @@ static void cmd_read_ai(const char *input){
         return;
     }
     int raw;
-    esp_err_t res = adc_oneshot_read(adc_handle, adc_channel_map[ai_index].channel, &raw);
+    xSemaphoreTake(ai_lock, portMAX_DELAY);
+    esp_err_t res = read_raw(ai_index, &raw);
+    xSemaphoreGive(ai_lock);
     if (res != ESP_OK) {
         finalizeError("ERROR_READING_ADC: ", inputString);
         resetBuffer();
@@ -529,6 +671,20 @@ static void cmd_read_ai(const char *input){
     uart_write_lines(response);
 }
 
+static cmd_status_t watch_ai(long index, int watch)
+{
+    if (index < 0 || index >= NUM_AI) {
+        return CMD_ERR_AI_INDEX_OUT_OF_RANGE;
+    }
+    xSemaphoreTake(ai_lock, portMAX_DELAY);
+    ai_watched[index] = watch;
+    ai_sums[index] = 0;
+    ai_counts[index] = 0;
+    ai_mean[index] = 0.0f;
+    xSemaphoreGive(ai_lock);
+    return CMD_OK;
+}
+
 static void cmd_watch_ai(const char *input){
     if (arg1 == UNDEFINED) {
         finalizeError("ERROR_MISSING_ARGUMENT: ", inputString);
@@ -541,12 +697,7 @@ static void cmd_watch_ai(const char *input){
         return;
     }
     int watch = (arg2 == 0) ? 0 : 1; // Default to 1 (enable) if arg2 is undefined
-    xSemaphoreTake(ai_lock, portMAX_DELAY);
-    ai_watched[(int)arg1] = watch;
-    ai_sums[(int)arg1] = 0;
-    ai_mean[(int)arg1] = 0.0f;
-    xSemaphoreGive(ai_lock);
-    uart_write_lines("Ok");
+    finishCommand(watch_ai(arg1, watch));
 }
 
 static void cmd_read_ai_mean(const char *input){
@@ -574,6 +725,395 @@ static void cmd_read_ai_mean(const char *input){
     uart_write_lines(response);
 }
 
+// Snapshot of every input taken in one pass, shared by the text ?all reply
+// and the binary BIN_OP_GET_ALL frame.
+typedef struct {
+    int raw[NUM_AI];
+    float mean[NUM_AI];     // already multiplied, 0 when not watched
+    uint32_t levels;        // bit N = GPIO N
+    uint8_t watched;        // bit i = ai i
+} device_state_t;
+
+static cmd_status_t read_state(device_state_t *st)
+{
+    st->watched = 0;
+    xSemaphoreTake(ai_lock, portMAX_DELAY);
+    for (int i = 0; i < NUM_AI; i++) {
+        if (read_raw(i, &st->raw[i]) != ESP_OK) {
+            xSemaphoreGive(ai_lock);
+            return CMD_ERR_READING_ADC;
+        }
+        st->mean[i] = ai_watched[i] ? ai_mean[i] * (float)multiplier : 0.0f;
+        if (ai_watched[i]) {
+            st->watched |= 1u << i;
+        }
+    }
+    xSemaphoreGive(ai_lock);
+
+    st->levels = 0;
+    for (int g = 0; g < NUM_DIGITAL_PINS; g++) {
+        if (!is_usb_pin((gpio_num_t)g) && gpio_get_level((gpio_num_t)g)) {
+            st->levels |= 1UL << g;
+        }
+    }
+    return CMD_OK;
+}
+
+// Whole device state in one line:
+//   ALL <ai0..ai3 raw> <ai0..ai3 mean*multiplier> <bi mask> <rate> <period_us> <multiplier>
+// Bit N of the mask is the level of GPIO N (USB pins read 0). Channels that
+// are not watched report a mean of 0.
+static void cmd_read_all(const char *input){
+    device_state_t st;
+    cmd_status_t status = read_state(&st);
+    if (status != CMD_OK) {
+        finishCommand(status);
+        return;
+    }
+
+    char response[RESPONSE_LENGTH];
+    int pos = snprintf(response, sizeof(response), "ALL");
+    for (int i = 0; i < NUM_AI; i++) {
+        pos += snprintf(response + pos, sizeof(response) - pos, " %d", st.raw[i]);
+    }
+    for (int i = 0; i < NUM_AI; i++) {
+        pos += snprintf(response + pos, sizeof(response) - pos, " %.2f", st.mean[i]);
+    }
+    snprintf(response + pos, sizeof(response) - pos, " %lu %lld %ld %ld",
+             (unsigned long)st.levels, (long long)loop_rate, period_us, multiplier);
+    uart_write_lines(response);
+}
+
+static void cmd_get_bin(const char *input){
+    char response[32];
+    snprintf(response, sizeof(response), "BIN %d %d", BIN_VERSION, BIN_FRAME_MAX);
+    uart_write_lines(response);
+}
+
+static void cmd_set_bin(const char *input){
+    if (arg1 != 0 && arg1 != 1) {
+        finalizeError("ERROR_INVALID_ARGUMENT: ", inputString);
+        resetBuffer();
+        return;
+    }
+    uart_write_lines("Ok");
+    framePtr = 0;
+    frameOverflow = false;
+    binary_mode = (arg1 == 1);
+}
+
+static cmd_status_t set_stream(long mask, long decimation)
+{
+    if (mask < 0 || mask >= (1L << NUM_AI) || decimation < 1 || decimation > DECIMATION_MAX) {
+        return CMD_ERR_INVALID_ARGUMENT;
+    }
+    xSemaphoreTake(ai_lock, portMAX_DELAY);
+    for (int i = 0; i < NUM_AI; i++) {
+        if ((mask & (1L << i)) && !ai_watched[i]) {
+            ai_watched[i] = 1;
+            ai_sums[i] = 0;
+            ai_counts[i] = 0;
+            ai_mean[i] = 0.0f;
+        }
+    }
+    stream_mask = (uint8_t)mask;
+    stream_decimation = (uint16_t)decimation;
+    stream_countdown = stream_decimation;
+    xSemaphoreGive(ai_lock);
+    return CMD_OK;
+}
+
+// !stream <mask> [decimation]: mask 0 stops streaming; the channels in the
+// mask are watched from now on.
+static void cmd_set_stream(const char *input){
+    if (arg1 == UNDEFINED) {
+        finalizeError("ERROR_MISSING_ARGUMENT: ", inputString);
+        resetBuffer();
+        return;
+    }
+    finishCommand(set_stream(arg1, arg2 == UNDEFINED ? 1 : arg2));
+}
+
+static void cmd_get_stream(const char *input){
+    char response[32];
+    xSemaphoreTake(ai_lock, portMAX_DELAY);
+    snprintf(response, sizeof(response), "STREAM %u %u", stream_mask, stream_decimation);
+    xSemaphoreGive(ai_lock);
+    uart_write_lines(response);
+}
+
+// ADC continuous <conversions/s> <frame conversions> | ADC oneshot
+static void cmd_get_adc(const char *input){
+    char response[48];
+#ifdef CONFIG_EPICS_ADC_CONTINUOUS
+    if (adc_continuous_mode) {
+        snprintf(response, sizeof(response), "ADC continuous %d %d", CONFIG_EPICS_ADC_SAMPLE_FREQ_HZ,
+                 CONFIG_EPICS_ADC_FRAME_SAMPLES);
+        uart_write_lines(response);
+        return;
+    }
+#endif
+    snprintf(response, sizeof(response), "ADC oneshot");
+    uart_write_lines(response);
+}
+
+// --- Binary framed protocol ---
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void put_f32(uint8_t *p, float v)
+{
+    uint32_t u;
+    memcpy(&u, &v, sizeof(u));
+    put_u32(p, u);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t code_pos = 0;
+    size_t o = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+        } else {
+            out[o++] = in[i];
+            if (++code == 0xFF) {
+                out[code_pos] = code;
+                code_pos = o++;
+                code = 1;
+            }
+        }
+    }
+    out[code_pos] = code;
+    return o;
+}
+
+static bool cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t size, size_t *out_len)
+{
+    size_t i = 0;
+    size_t o = 0;
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (code == 0) {
+            return false;
+        }
+        for (uint8_t k = 1; k < code; k++) {
+            if (i >= len || o >= size) {
+                return false;
+            }
+            out[o++] = in[i++];
+        }
+        if (code != 0xFF && i < len) {
+            if (o >= size) {
+                return false;
+            }
+            out[o++] = 0;
+        }
+    }
+    *out_len = o;
+    return true;
+}
+
+static void bin_send(uint8_t op, uint16_t id, const uint8_t *payload, size_t len)
+{
+    uint8_t raw[BIN_FRAME_MAX];
+    uint8_t enc[BIN_ENCODED_MAX];
+    if (len + 5 > sizeof(raw)) {
+        return;
+    }
+    raw[0] = op;
+    put_u16(raw + 1, id);
+    if (len > 0) {
+        memcpy(raw + 3, payload, len);
+    }
+    put_u16(raw + 3 + len, crc16(raw, len + 3));
+    size_t n = cobs_encode(raw, len + 5, enc);
+    enc[n++] = 0;
+    usb_write(enc, n);
+}
+
+static size_t bin_info(uint8_t *out)
+{
+    out[0] = NUM_AI;
+    out[1] = NUM_DIGITAL_PINS;
+    put_u32(out + 2, PERIOD_MIN_US);
+    put_u32(out + 6, PERIOD_MAX_US);
+    put_u32(out + 10, MULTIPLIER_MIN);
+    put_u32(out + 14, MULTIPLIER_MAX);
+    size_t n = 18;
+    memcpy(out + n, SOFTWARE_ID, sizeof(SOFTWARE_ID));
+    n += sizeof(SOFTWARE_ID);
+    memcpy(out + n, SOFTWARE_VERSION, sizeof(SOFTWARE_VERSION));
+    n += sizeof(SOFTWARE_VERSION);
+    return n;
+}
+
+static cmd_status_t bin_all(uint8_t *out, size_t *len)
+{
+    device_state_t st;
+    cmd_status_t status = read_state(&st);
+    if (status != CMD_OK) {
+        return status;
+    }
+    size_t n = 0;
+    for (int i = 0; i < NUM_AI; i++, n += 2) {
+        put_u16(out + n, (uint16_t)st.raw[i]);
+    }
+    for (int i = 0; i < NUM_AI; i++, n += 4) {
+        put_f32(out + n, st.mean[i]);
+    }
+    put_u32(out + n, st.levels);
+    put_u32(out + n + 4, (uint32_t)loop_rate);
+    put_u32(out + n + 8, (uint32_t)period_us);
+    put_u32(out + n + 12, (uint32_t)multiplier);
+    out[n + 16] = st.watched;
+    *len = n + 17;
+    return CMD_OK;
+}
+
+// One received frame (still COBS-encoded, without the 0x00 delimiter).
+static void bin_execute(const uint8_t *enc, size_t len)
+{
+    uint8_t f[BIN_FRAME_MAX];
+    size_t n = 0;
+    if (!cobs_decode(enc, len, f, sizeof(f), &n) || n < 5 || crc16(f, n - 2) != get_u16(f + n - 2)) {
+        uint8_t code = CMD_ERR_BAD_FRAME;
+        bin_send(BIN_OP_ERROR, 0, &code, 1);
+        return;
+    }
+    const uint8_t op = f[0];
+    const uint16_t id = get_u16(f + 1);
+    const uint8_t *p = f + 3;
+    const size_t plen = n - 5;
+
+    uint8_t reply[BIN_FRAME_MAX - 5];
+    size_t rlen = 0;
+    cmd_status_t status = CMD_OK;
+    switch (op) {
+    case BIN_OP_GET_ALL:
+        status = bin_all(reply, &rlen);
+        break;
+    case BIN_OP_GET_INFO:
+        rlen = bin_info(reply);
+        break;
+    case BIN_OP_SET_BO:
+        status = plen == 2 ? write_bo(p[0], p[1]) : CMD_ERR_BAD_FRAME;
+        break;
+    case BIN_OP_SET_PIN:
+        status = plen == 2 ? set_pinmode(p[0], p[1]) : CMD_ERR_BAD_FRAME;
+        break;
+    case BIN_OP_SET_PWM:
+        status = plen == 2 ? write_pwm(p[0], p[1]) : CMD_ERR_BAD_FRAME;
+        break;
+    case BIN_OP_SET_WATCH:
+        status = plen == 2 ? watch_ai(p[0], p[1] ? 1 : 0) : CMD_ERR_BAD_FRAME;
+        break;
+    case BIN_OP_SET_PERIOD:
+        status = plen == 4 ? set_period((long)get_u32(p)) : CMD_ERR_BAD_FRAME;
+        break;
+    case BIN_OP_SET_MULT:
+        status = plen == 4 ? set_multiplier((long)get_u32(p)) : CMD_ERR_BAD_FRAME;
+        break;
+    case BIN_OP_SET_STREAM:
+        status = plen == 3 ? set_stream(p[0], get_u16(p + 1)) : CMD_ERR_BAD_FRAME;
+        break;
+    case BIN_OP_TEXT:
+        binary_mode = false;
+        break;
+    default:
+        status = CMD_ERR_UNKNOWN_COMMAND;
+        break;
+    }
+
+    if (status != CMD_OK) {
+        uint8_t code = (uint8_t)status;
+        bin_send(BIN_OP_ERROR, id, &code, 1);
+        return;
+    }
+    bin_send(op | BIN_REPLY, id, reply, rlen);
+}
+
+// One stream record, in the protocol currently in use.
+static void stream_send(uint16_t seq, int64_t t_us, uint32_t samples, uint8_t mask, const float *mean)
+{
+    if (binary_mode) {
+        uint8_t payload[13 + 4 * NUM_AI];
+        put_u32(payload, (uint32_t)t_us);
+        put_u32(payload + 4, (uint32_t)((uint64_t)t_us >> 32));
+        put_u32(payload + 8, samples);
+        payload[12] = mask;
+        size_t n = 13;
+        for (int i = 0; i < NUM_AI; i++) {
+            if (mask & (1u << i)) {
+                put_f32(payload + n, mean[i]);
+                n += 4;
+            }
+        }
+        bin_send(BIN_OP_SAMPLE, seq, payload, n);
+        return;
+    }
+
+    char line[RESPONSE_LENGTH];
+    int pos = snprintf(line, sizeof(line), "SAMPLE %u %lld %lu %u", seq, (long long)t_us, (unsigned long)samples,
+                       mask);
+    for (int i = 0; i < NUM_AI; i++) {
+        pos += snprintf(line + pos, sizeof(line) - pos, " %.2f", (mask & (1u << i)) ? mean[i] : 0.0f);
+    }
+    uart_write_lines(line);
+}
+
+static void bin_receive(uint8_t c)
+{
+    if (c == 0) {
+        if (framePtr > 0 && !frameOverflow) {
+            bin_execute(frameBuf, framePtr);
+        }
+        framePtr = 0;
+        frameOverflow = false;
+    } else if (framePtr < sizeof(frameBuf)) {
+        frameBuf[framePtr++] = c;
+    } else {
+        frameOverflow = true; // drop the rest of this frame
+    }
+}
+
 // --- Dispatcher ---
 static void executeCommandLine(const char *line){
   dissectCommand(line);
@@ -608,6 +1148,16 @@ static void executeCommandLine(const char *line){
   else if (strcmp(baseCmd, "?k:min") == 0) cmd_get_multiplier_min(line);
   else if (strcmp(baseCmd, "?k:max") == 0) cmd_get_multiplier_max(line);
 
+  else if (strcmp(baseCmd, "?all") == 0) cmd_read_all(line);
+
+  else if (strcmp(baseCmd, "?bin") == 0) cmd_get_bin(line);
+  else if (strcmp(baseCmd, "!bin") == 0) cmd_set_bin(line);
+
+  else if (strcmp(baseCmd, "!stream") == 0) cmd_set_stream(line);
+  else if (strcmp(baseCmd, "?stream") == 0) cmd_get_stream(line);
+
+  else if (strcmp(baseCmd, "?adc") == 0) cmd_get_adc(line);
+
   else {
       finalizeError("ERROR_UNKNOWN_COMMAND: ", line);
       resetBuffer();
@@ -634,6 +1184,10 @@ static void uart_cmd_task(void *arg)
 
         // Process incoming data
         for (int i = 0; i < len; i++) {
+            if (binary_mode) {
+                bin_receive(data[i]);
+                continue;
+            }
             char c = (char)data[i];
             if (c == '\r') {
                 continue;
@@ -656,12 +1210,58 @@ static void uart_cmd_task(void *arg)
     }
 }
 
+// End of an averaging window: loop rate, means of the watched channels and
+// the stream record. scans is the number of passes over the channels since
+// the previous window.
+static void ai_window_end(int64_t current_time, int64_t elapsed_us, int64_t scans)
+{
+    loop_rate = elapsed_us > 0 ? (scans * 1000000) / elapsed_us : 0;
+
+    uint8_t send_mask = 0;
+    float send_mean[NUM_AI];
+    xSemaphoreTake(ai_lock, portMAX_DELAY);
+    for (int i = 0; i < NUM_AI; i++) {
+        if (ai_watched[i]) {
+            ai_mean[i] = ai_counts[i] > 0 ? (float)((double)ai_sums[i] / ai_counts[i]) : 0.0f;
+            ai_sums[i] = 0;
+            ai_counts[i] = 0;
+        }
+        send_mean[i] = ai_mean[i] * (float)multiplier;
+    }
+    if (stream_mask != 0 && --stream_countdown == 0) {
+        stream_countdown = stream_decimation;
+        send_mask = stream_mask;
+    }
+    xSemaphoreGive(ai_lock);
+    if (send_mask != 0) {
+        stream_send(stream_seq++, current_time, (uint32_t)scans, send_mask, send_mean);
+    }
+}
+
+// True (and the next window scheduled) when the current one is over.
+static bool ai_window_due(int64_t current_time)
+{
+    bool due = false;
+    xSemaphoreTake(ai_lock, portMAX_DELAY);
+    if (current_time >= nextUpdate_us) {
+        nextUpdate_us += period_us;
+        if (nextUpdate_us <= current_time) {
+            nextUpdate_us = current_time + period_us; // fell behind, e.g. after a period change
+        }
+        due = true;
+    }
+    xSemaphoreGive(ai_lock);
+    return due;
+}
+
 static void ai_sampling_task(void *arg)
 {
-    ESP_LOGI(SOFTWARE_ID, "AI sampling task starting");
+    ESP_LOGI(SOFTWARE_ID, "AI sampling task starting (oneshot)");
     int64_t last_time = esp_timer_get_time();
     int64_t window_samples = 0;
-    int64_t nextUpdate_us = last_time + period_us;
+    xSemaphoreTake(ai_lock, portMAX_DELAY);
+    nextUpdate_us = last_time + period_us;
+    xSemaphoreGive(ai_lock);
     while (1) {
         int any = 0;
         if (NUM_AI > 0) {
@@ -673,6 +1273,7 @@ static void ai_sampling_task(void *arg)
                     esp_err_t res = adc_oneshot_read(adc_handle, adc_channel_map[i].channel, &raw);
                     if (res == ESP_OK) {
                         ai_sums[i] += raw;
+                        ai_counts[i]++;
                     }
                 }
             }
@@ -680,29 +1281,10 @@ static void ai_sampling_task(void *arg)
         }
         window_samples++;
         int64_t current_time = esp_timer_get_time();
-        if (current_time >= nextUpdate_us) {
-            // Update loop rate
-            int64_t elapsed_us = current_time - last_time;
-            if (elapsed_us > 0) {
-                loop_rate = (window_samples * 1000000) / elapsed_us;
-            } else {
-                loop_rate = 0;
-            }
-            // Update mean values
-            if (NUM_AI > 0) {
-                xSemaphoreTake(ai_lock, portMAX_DELAY);
-                for (int i = 0; i < NUM_AI; i++) {
-                    if (ai_watched[i]) {
-                        int64_t denom = (window_samples > 0) ? window_samples : 1;
-                        ai_mean[i] = (float)ai_sums[i] / (float)denom;
-                        ai_sums[i] = 0;
-                    }
-                }
-                xSemaphoreGive(ai_lock);
-            }
+        if (ai_window_due(current_time)) {
+            ai_window_end(current_time, current_time - last_time, window_samples);
             last_time = current_time;
             window_samples = 0;
-            nextUpdate_us += period_us;
         }
 
         // Yield time to the rest of the system (and avoid WDT)
@@ -710,10 +1292,128 @@ static void ai_sampling_task(void *arg)
     }
 }
 
+#ifdef CONFIG_EPICS_ADC_CONTINUOUS
+// AI index of each ADC channel in the DMA pattern, -1 if none.
+static int8_t adc_dma_index[SOC_ADC_MAX_CHANNEL_NUM];
+
+static esp_err_t adc_continuous_init(void)
+{
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = ADC_DMA_FRAME_BYTES * 4,
+        .conv_frame_size = ADC_DMA_FRAME_BYTES,
+    };
+    esp_err_t err = adc_continuous_new_handle(&handle_config, &adc_dma);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    adc_digi_pattern_config_t pattern[NUM_AI];
+    memset(adc_dma_index, -1, sizeof(adc_dma_index));
+    for (int i = 0; i < NUM_AI; i++) {
+        pattern[i].atten = ADC_ATTEN_DB_11;
+        pattern[i].channel = adc_channel_map[i].channel;
+        pattern[i].unit = adc_channel_map[i].unit;
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+        adc_dma_index[adc_channel_map[i].channel] = (int8_t)i;
+    }
+    adc_continuous_config_t config = {
+        .pattern_num = NUM_AI,
+        .adc_pattern = pattern,
+        .sample_freq_hz = CONFIG_EPICS_ADC_SAMPLE_FREQ_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DMA_FORMAT,
+    };
+    err = adc_continuous_config(adc_dma, &config);
+    if (err == ESP_OK) {
+        err = adc_continuous_start(adc_dma);
+    }
+    if (err != ESP_OK) {
+        adc_continuous_deinit(adc_dma);
+        adc_dma = NULL;
+    }
+    return err;
+}
+
+// Takes whole DMA frames, sums them per channel without the lock, then adds
+// the totals of the watched channels under ai_lock once per frame.
+static void ai_continuous_task(void *arg)
+{
+    static uint8_t frame[ADC_DMA_FRAME_BYTES];
+    ESP_LOGI(SOFTWARE_ID, "AI sampling task starting (continuous, %d Hz)", CONFIG_EPICS_ADC_SAMPLE_FREQ_HZ);
+    int64_t last_time = esp_timer_get_time();
+    int64_t window_conversions = 0;
+    xSemaphoreTake(ai_lock, portMAX_DELAY);
+    nextUpdate_us = last_time + period_us;
+    xSemaphoreGive(ai_lock);
+    while (1) {
+        uint32_t length = 0;
+        esp_err_t res = adc_continuous_read(adc_dma, frame, sizeof(frame), &length, ADC_DMA_READ_TIMEOUT_MS);
+        if (res == ESP_OK) {
+            int64_t sums[NUM_AI] = {0};
+            uint32_t counts[NUM_AI] = {0};
+            int last[NUM_AI];
+            for (uint32_t pos = 0; pos + SOC_ADC_DIGI_RESULT_BYTES <= length; pos += SOC_ADC_DIGI_RESULT_BYTES) {
+                const adc_digi_output_data_t *d = (const adc_digi_output_data_t *)&frame[pos];
+                unsigned channel = ADC_DMA_CHANNEL(d);
+                int index = channel < SOC_ADC_MAX_CHANNEL_NUM ? adc_dma_index[channel] : -1;
+                if (index < 0) {
+                    continue;
+                }
+                last[index] = ADC_DMA_DATA(d);
+                sums[index] += last[index];
+                counts[index]++;
+                window_conversions++;
+            }
+            xSemaphoreTake(ai_lock, portMAX_DELAY);
+            for (int i = 0; i < NUM_AI; i++) {
+                if (counts[i] == 0) {
+                    continue;
+                }
+                ai_last[i] = last[i];
+                if (ai_watched[i]) {
+                    ai_sums[i] += sums[i];
+                    ai_counts[i] += counts[i];
+                }
+            }
+            xSemaphoreGive(ai_lock);
+        } else if (res != ESP_ERR_TIMEOUT) {
+            ESP_LOGW(SOFTWARE_ID, "adc_continuous_read: %s", esp_err_to_name(res));
+            vTaskDelay(1);
+        }
+
+        int64_t current_time = esp_timer_get_time();
+        if (ai_window_due(current_time)) {
+            ai_window_end(current_time, current_time - last_time, window_conversions / NUM_AI);
+            last_time = current_time;
+            window_conversions = 0;
+        }
+    }
+}
+#endif
+
+static void adc_oneshot_init(void)
+{
+    adc_oneshot_unit_init_cfg_t init_config = {
+        .unit_id = adc_channel_map[0].unit,
+        .ulp_mode = ADC_ULP_MODE_DISABLE,
+    };
+    ESP_ERROR_CHECK(adc_oneshot_new_unit(&init_config, &adc_handle));
+
+    for (int i = 0; i < NUM_AI; i++) {
+        adc_oneshot_chan_cfg_t chan_config = {
+            .bitwidth = ADC_BITWIDTH_DEFAULT,
+            .atten = ADC_ATTEN_DB_11,
+        };
+        ESP_ERROR_CHECK(adc_oneshot_config_channel(adc_handle, adc_channel_map[i].channel, &chan_config));
+    }
+}
+
 // --- Main application entry point ---
 void app_main(void) {
   ai_lock = xSemaphoreCreateMutex();
   ESP_ERROR_CHECK(ai_lock != NULL ? ESP_OK : ESP_FAIL);
+  tx_lock = xSemaphoreCreateMutex();
+  ESP_ERROR_CHECK(tx_lock != NULL ? ESP_OK : ESP_FAIL);
 
     // Configure USB SERIAL JTAG early so logging/output works before tasks start
     usb_serial_jtag_driver_config_t usb_serial_jtag_config = {
@@ -723,25 +1423,29 @@ void app_main(void) {
     ESP_ERROR_CHECK(usb_serial_jtag_driver_install(&usb_serial_jtag_config));
     ESP_LOGI(SOFTWARE_ID, "USB_SERIAL_JTAG init done");
 
-  // Initialize ADC oneshot
+  for (int i = 0; i < NUM_AI; i++) {
+      ai_watched[i] = 0;
+      ai_sums[i] = 0;
+      ai_counts[i] = 0;
+      ai_mean[i] = 0.0f;
+      ai_last[i] = 0;
+  }
+
+  // Initialize the ADC: continuous (DMA) if configured, oneshot otherwise
+  // or as fallback
+#ifdef CONFIG_EPICS_ADC_CONTINUOUS
   if (NUM_AI > 0) {
-      adc_oneshot_unit_init_cfg_t init_config = {
-          .unit_id = adc_channel_map[0].unit,
-          .ulp_mode = ADC_ULP_MODE_DISABLE,
-      };
-      ESP_ERROR_CHECK(adc_oneshot_new_unit(&init_config, &adc_handle));
-
-      for (int i = 0; i < NUM_AI; i++) {
-          adc_oneshot_chan_cfg_t chan_config = {
-              .bitwidth = ADC_BITWIDTH_DEFAULT,
-              .atten = ADC_ATTEN_DB_11,
-          };
-          ESP_ERROR_CHECK(adc_oneshot_config_channel(adc_handle, adc_channel_map[i].channel, &chan_config));
-          ai_watched[i] = 0;
-          ai_sums[i] = 0;
-          ai_mean[i] = 0.0f;
+      esp_err_t err = adc_continuous_init();
+      if (err == ESP_OK) {
+          adc_continuous_mode = true;
+      } else {
+          ESP_LOGW(SOFTWARE_ID, "ADC continuous mode unavailable (%s), using oneshot reads", esp_err_to_name(err));
       }
   }
+#endif
+  if (NUM_AI > 0 && !adc_continuous_mode) {
+      adc_oneshot_init();
+  }
 
   // Print startup message
   char startup_msg[128];
@@ -751,6 +1455,12 @@ void app_main(void) {
   // Create tasks
   BaseType_t res1 = xTaskCreate(uart_cmd_task, "UART_cmd_task", 8192, NULL, 10, NULL);
   ESP_ERROR_CHECK(res1 == pdTRUE ? ESP_OK : ESP_FAIL);
-  BaseType_t res2 = xTaskCreate(ai_sampling_task, "AI_sampling_task", 8192, NULL, 10, NULL);
+  TaskFunction_t sampling_task = ai_sampling_task;
+#ifdef CONFIG_EPICS_ADC_CONTINUOUS
+  if (adc_continuous_mode) {
+      sampling_task = ai_continuous_task;
+  }
+#endif
+  BaseType_t res2 = xTaskCreate(sampling_task, "AI_sampling_task", 8192, NULL, 10, NULL);
   ESP_ERROR_CHECK(res2 == pdTRUE ? ESP_OK : ESP_FAIL);
 }
\ No newline at end of file
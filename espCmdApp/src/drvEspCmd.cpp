@@ -0,0 +1,1011 @@
+/* drvEspCmd.cpp
+ *
+ * asynPortDriver for the ESP32 cmd_response firmware (esp32/epics_esp32.c).
+ * See drvEspCmd.h and espCmdAsyn.db.
+ */
+
+#include "drvEspCmd.h"
+#include "espBinary.h"
+
+#include <asynOctetSyncIO.h>
+
+#include <epicsExport.h>
+#include <epicsStdio.h>
+#include <epicsThread.h>
+#include <iocsh.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char *driverName = "drvEspCmd";
+
+namespace {
+
+// Firmware limits (NUM_AI, NUM_DIGITAL_PINS and the USB pins it rejects).
+const int kNumAi = 4;
+const int kNumGpio = 22;
+const int kDefaultGpioMask = ((1 << kNumGpio) - 1) & ~((1 << 18) | (1 << 19));
+
+// Queries per write. The firmware reads its USB buffer in BUFFER_LENGTH
+// chunks and answers every line in order; keeping a batch to a few hundred
+// bytes stays well inside its 2 kB RX/TX buffers.
+const size_t kMaxPipelined = 16;
+
+const double kReplyTimeout = 1.0;
+
+// Frames skipped while waiting for the reply to a binary request (late
+// replies to requests that timed out, or log output from the firmware).
+const int kMaxStaleFrames = 8;
+
+// Read timeout while waiting for stream records between poll cycles; bounds
+// how late a write from an output record is sent.
+const double kStreamReadTimeout = 0.05;
+
+// The smallest host - device offset seen belongs to the record delivered
+// fastest. It is let go up by this much per record so that the drift of the
+// ESP32 clock is followed.
+const double kOffsetCreep = 10e-6;
+
+// Firmware DECIMATION_MAX.
+const int kMaxDecimation = 1000;
+
+bool startsWith(const char *s, const char *prefix)
+{
+    return std::strncmp(s, prefix, std::strlen(prefix)) == 0;
+}
+
+void pollerThreadC(void *drvPvt)
+{
+    static_cast<drvEspCmd *>(drvPvt)->pollerThread();
+}
+
+} // namespace
+
+drvEspCmd::drvEspCmd(const char *portName, const char *serialPort, double pollPeriod, int gpioMask, int binary)
+    : asynPortDriver(portName, kNumGpio,
+                     asynInt32Mask | asynFloat64Mask | asynOctetMask | asynDrvUserMask,
+                     asynInt32Mask | asynFloat64Mask | asynOctetMask,
+                     ASYN_MULTIDEVICE | ASYN_CANBLOCK, 1, 0, 0),
+      octet_(0), gpioMask_(gpioMask ? (gpioMask & kDefaultGpioMask) : kDefaultGpioMask), useAll_(true),
+      binaryWanted_(binary != 0), binaryActive_(false), nextId_(0), watched_(kNumAi, false), streamMask_(0),
+      lastSeq_(-1), clockOffset_(0.0), haveOffset_(false)
+{
+    static const char *functionName = "drvEspCmd";
+
+    createParam(ESP_ID_STRING, asynParamOctet, &P_Id);
+    createParam(ESP_VERSION_STRING, asynParamOctet, &P_Version);
+    createParam(ESP_NUM_AI_STRING, asynParamInt32, &P_NumAi);
+    createParam(ESP_NUM_BI_STRING, asynParamInt32, &P_NumBi);
+    createParam(ESP_AI_STRING, asynParamInt32, &P_Ai);
+    createParam(ESP_AI_MEAN_STRING, asynParamFloat64, &P_AiMean);
+    createParam(ESP_AI_WATCH_STRING, asynParamInt32, &P_AiWatch);
+    createParam(ESP_BI_STRING, asynParamInt32, &P_Bi);
+    createParam(ESP_BO_STRING, asynParamInt32, &P_Bo);
+    createParam(ESP_PIN_DIR_STRING, asynParamInt32, &P_PinDir);
+    createParam(ESP_PWM_STRING, asynParamInt32, &P_Pwm);
+    createParam(ESP_PIN_CMD_STRING, asynParamOctet, &P_PinCmd);
+    createParam(ESP_BO_CMD_STRING, asynParamOctet, &P_BoCmd);
+    createParam(ESP_RATE_STRING, asynParamInt32, &P_Rate);
+    createParam(ESP_PERIOD_STRING, asynParamInt32, &P_Period);
+    createParam(ESP_PERIOD_MIN_STRING, asynParamInt32, &P_PeriodMin);
+    createParam(ESP_PERIOD_MAX_STRING, asynParamInt32, &P_PeriodMax);
+    createParam(ESP_MULT_STRING, asynParamInt32, &P_Mult);
+    createParam(ESP_MULT_MIN_STRING, asynParamInt32, &P_MultMin);
+    createParam(ESP_MULT_MAX_STRING, asynParamInt32, &P_MultMax);
+    createParam(ESP_POLL_PERIOD_STRING, asynParamFloat64, &P_PollPeriod);
+    createParam(ESP_POLL_COUNT_STRING, asynParamInt32, &P_PollCount);
+    createParam(ESP_POLL_ERRORS_STRING, asynParamInt32, &P_PollErrors);
+    createParam(ESP_BINARY_STRING, asynParamInt32, &P_Binary);
+    createParam(ESP_STREAM_MASK_STRING, asynParamInt32, &P_StreamMask);
+    createParam(ESP_STREAM_DECIM_STRING, asynParamInt32, &P_StreamDecim);
+    createParam(ESP_STREAM_SEQ_STRING, asynParamInt32, &P_StreamSeq);
+    createParam(ESP_STREAM_SAMPLES_STRING, asynParamInt32, &P_StreamSamples);
+    createParam(ESP_STREAM_TIME_STRING, asynParamFloat64, &P_StreamTime);
+    createParam(ESP_STREAM_LOST_STRING, asynParamInt32, &P_StreamLost);
+
+    setDoubleParam(P_PollPeriod, pollPeriod > 0.0 ? pollPeriod : 1.0);
+    setIntegerParam(P_PollCount, 0);
+    setIntegerParam(P_PollErrors, 0);
+    setIntegerParam(P_Binary, 0);
+    setIntegerParam(P_StreamMask, 0);
+    setIntegerParam(P_StreamDecim, 1);
+    setIntegerParam(P_StreamLost, 0);
+    for (int i = 0; i < kNumAi; i++) {
+        setIntegerParam(i, P_AiWatch, 0);
+    }
+
+    if (pasynOctetSyncIO->connect(serialPort, 0, &octet_, NULL) != asynSuccess) {
+        std::printf("%s:%s: cannot connect to serial port %s\n", driverName, functionName, serialPort);
+        octet_ = 0;
+        return;
+    }
+    pasynOctetSyncIO->setInputEos(octet_, "\n", 1);
+    pasynOctetSyncIO->setOutputEos(octet_, "", 0);
+
+    if (epicsThreadCreate("drvEspCmd", epicsThreadPriorityMedium, epicsThreadGetStackSize(epicsThreadStackMedium),
+                          pollerThreadC, this) == NULL) {
+        std::printf("%s:%s: epicsThreadCreate failure\n", driverName, functionName);
+    }
+}
+
+// Sends the queries in batches of kMaxPipelined lines and reads one reply
+// line per query. Stops at the first timeout or reply that does not belong
+// to its query (e.g. the firmware's startup banner after a reset), flushing
+// the input so the next cycle starts in sync. Replies not received stay
+// empty.
+bool drvEspCmd::runQueries(const std::vector<Query> &queries)
+{
+    static const char *functionName = "runQueries";
+    std::vector<std::string> replies(queries.size());
+    bool ok = true;
+
+    for (size_t begin = 0; ok && begin < queries.size(); begin += kMaxPipelined) {
+        const size_t end = begin + kMaxPipelined < queries.size() ? begin + kMaxPipelined : queries.size();
+        std::string batch;
+        for (size_t i = begin; i < end; i++) {
+            batch += queries[i].command;
+            batch += '\n';
+        }
+
+        epicsGuard<epicsMutex> guard(ioLock_);
+        size_t nwrite = 0;
+        if (pasynOctetSyncIO->write(octet_, batch.data(), batch.size(), kReplyTimeout, &nwrite) != asynSuccess) {
+            asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: write failed\n", driverName, functionName);
+            ok = false;
+            break;
+        }
+        for (size_t i = begin; i < end; i++) {
+            char buf[128];
+            size_t nread = 0;
+            int eomReason = 0;
+            asynStatus status;
+            do {
+                status = pasynOctetSyncIO->read(octet_, buf, sizeof(buf) - 1, kReplyTimeout, &nread, &eomReason);
+                buf[nread] = '\0';
+                if (nread > 0 && buf[nread - 1] == '\r') {
+                    buf[nread - 1] = '\0';
+                }
+            } while (status == asynSuccess && queueTextSample(buf));
+            if (status != asynSuccess ||
+                (!startsWith(buf, queries[i].prefix) && !startsWith(buf, "ERROR_"))) {
+                asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: %s: %s reply '%s'\n", driverName, functionName,
+                          queries[i].command.c_str(), status != asynSuccess ? "no" : "unexpected", buf);
+                pasynOctetSyncIO->flush(octet_);
+                ok = false;
+                break;
+            }
+            replies[i] = buf;
+        }
+    }
+
+    lock();
+    updateTimeStamp();
+    for (size_t i = 0; i < queries.size(); i++) {
+        if (!applyReply(queries[i], replies[i].c_str())) {
+            setQueryStatus(queries[i], replies[i].empty() ? asynTimeout : asynError);
+        }
+    }
+    if (!ok) {
+        int errors = 0;
+        getIntegerParam(P_PollErrors, &errors);
+        setIntegerParam(P_PollErrors, errors + 1);
+    }
+    for (int addr = 0; addr < kNumGpio; addr++) {
+        callParamCallbacks(addr);
+    }
+    unlock();
+    return ok;
+}
+
+// Called with the driver locked.
+void drvEspCmd::setQueryStatus(const Query &q, asynStatus status)
+{
+    if (q.param >= 0) {
+        setParamStatus(q.addr, q.param, status);
+    } else {
+        setStateStatus(status);
+    }
+}
+
+// Status of everything "?all" and OpGetAll refresh; called with the driver
+// locked.
+void drvEspCmd::setStateStatus(asynStatus status)
+{
+    for (int i = 0; i < kNumAi; i++) {
+        setParamStatus(i, P_Ai, status);
+        if (watched_[i] && !(streamMask_ & (1 << i))) {
+            setParamStatus(i, P_AiMean, status);
+        }
+    }
+    for (int g = 0; g < kNumGpio; g++) {
+        if (gpioMask_ & (1 << g)) {
+            setParamStatus(g, P_Bi, status);
+        }
+    }
+    setParamStatus(0, P_Rate, status);
+    setParamStatus(0, P_Period, status);
+    setParamStatus(0, P_Mult, status);
+}
+
+// Called with the driver locked.
+bool drvEspCmd::applyReply(const Query &q, const char *reply)
+{
+    if (q.param < 0) {
+        return applyAll(reply);
+    }
+    if (reply[0] == '\0' || startsWith(reply, "ERROR_")) {
+        return false;
+    }
+    const char *p = reply + std::strlen(q.prefix);
+    char *end = 0;
+    if (q.indexed) {
+        if (std::strtol(p, &end, 10) != q.addr || end == p) {
+            return false;
+        }
+        p = end;
+    }
+    while (*p == ' ') {
+        p++;
+    }
+
+    asynParamType type;
+    getParamType(q.param, &type);
+    if (type == asynParamOctet) {
+        setStringParam(q.addr, q.param, p);
+    } else if (type == asynParamFloat64) {
+        const double v = std::strtod(p, &end);
+        if (end == p) {
+            return false;
+        }
+        setDoubleParam(q.addr, q.param, v);
+    } else {
+        const long v = std::strtol(p, &end, 10);
+        if (end == p) {
+            return false;
+        }
+        setIntegerParam(q.addr, q.param, static_cast<epicsInt32>(v));
+    }
+    setParamStatus(q.addr, q.param, asynSuccess);
+    return true;
+}
+
+// "ALL <ai0..3> <mean0..3> <bi mask> <rate> <period_us> <multiplier>";
+// called with the driver locked.
+bool drvEspCmd::applyAll(const char *reply)
+{
+    if (startsWith(reply, "ERROR_UNKNOWN_COMMAND")) {
+        useAll_ = false;
+        return false;
+    }
+    if (!startsWith(reply, "ALL ")) {
+        return false;
+    }
+
+    const char *p = reply + 4;
+    char *end = 0;
+    long raw[kNumAi];
+    double mean[kNumAi];
+    long tail[4]; // mask, rate, period, multiplier
+    for (int i = 0; i < kNumAi; i++) {
+        raw[i] = std::strtol(p, &end, 10);
+        if (end == p) {
+            return false;
+        }
+        p = end;
+    }
+    for (int i = 0; i < kNumAi; i++) {
+        mean[i] = std::strtod(p, &end);
+        if (end == p) {
+            return false;
+        }
+        p = end;
+    }
+    for (int i = 0; i < 4; i++) {
+        tail[i] = std::strtol(p, &end, 10);
+        if (end == p) {
+            return false;
+        }
+        p = end;
+    }
+    applyState(raw, mean, tail[0], tail[1], tail[2], tail[3]);
+    return true;
+}
+
+// Called with the driver locked.
+void drvEspCmd::applyState(const long raw[], const double mean[], long levels, long rate, long period, long mult)
+{
+    for (int i = 0; i < kNumAi; i++) {
+        setIntegerParam(i, P_Ai, static_cast<epicsInt32>(raw[i]));
+        setParamStatus(i, P_Ai, asynSuccess);
+        if (watched_[i] && !(streamMask_ & (1 << i))) {
+            setDoubleParam(i, P_AiMean, mean[i]);
+            setParamStatus(i, P_AiMean, asynSuccess);
+        }
+    }
+    for (int g = 0; g < kNumGpio; g++) {
+        if (gpioMask_ & (1 << g)) {
+            setIntegerParam(g, P_Bi, (levels >> g) & 1);
+            setParamStatus(g, P_Bi, asynSuccess);
+        }
+    }
+    setIntegerParam(P_Rate, static_cast<epicsInt32>(rate));
+    setIntegerParam(P_Period, static_cast<epicsInt32>(period));
+    setIntegerParam(P_Mult, static_cast<epicsInt32>(mult));
+    setParamStatus(0, P_Rate, asynSuccess);
+    setParamStatus(0, P_Period, asynSuccess);
+    setParamStatus(0, P_Mult, asynSuccess);
+}
+
+// Identification and limits; repeated until the firmware answered all of it.
+bool drvEspCmd::pollInfo()
+{
+    std::vector<Query> q;
+    q.push_back(Query{"?id", "ID ", false, P_Id, 0});
+    q.push_back(Query{"?v", "VERSION ", false, P_Version, 0});
+    q.push_back(Query{"?#ai", "NUM_AI ", false, P_NumAi, 0});
+    q.push_back(Query{"?#bi", "NUM_BIN ", false, P_NumBi, 0});
+    q.push_back(Query{"?t:min", "", false, P_PeriodMin, 0});
+    q.push_back(Query{"?t:max", "", false, P_PeriodMax, 0});
+    q.push_back(Query{"?k:min", "", false, P_MultMin, 0});
+    q.push_back(Query{"?k:max", "", false, P_MultMax, 0});
+    return runQueries(q);
+}
+
+void drvEspCmd::pollValues()
+{
+    std::vector<Query> q;
+    char cmd[32];
+
+    lock();
+    const bool useAll = useAll_;
+    unlock();
+    if (useAll) {
+        q.push_back(Query{"?all", "ALL ", false, -1, 0});
+        const bool ok = runQueries(q);
+        lock();
+        if (useAll_) {
+            if (ok) {
+                int count = 0;
+                getIntegerParam(P_PollCount, &count);
+                setIntegerParam(P_PollCount, count + 1);
+                callParamCallbacks();
+            }
+            unlock();
+            return;
+        }
+        unlock();
+        asynPrint(pasynUserSelf, ASYN_TRACE_WARNING, "%s:pollValues: firmware has no ?all, polling per value\n",
+                  driverName);
+        q.clear();
+    }
+
+    lock();
+    for (int i = 0; i < kNumAi; i++) {
+        std::snprintf(cmd, sizeof(cmd), "?ai %d", i);
+        q.push_back(Query{cmd, "AI ", true, P_Ai, i});
+        if (watched_[i] && !(streamMask_ & (1 << i))) {
+            std::snprintf(cmd, sizeof(cmd), "?ai:mean %d", i);
+            q.push_back(Query{cmd, "AI_MEAN ", true, P_AiMean, i});
+        }
+    }
+    unlock();
+    for (int g = 0; g < kNumGpio; g++) {
+        if (gpioMask_ & (1 << g)) {
+            std::snprintf(cmd, sizeof(cmd), "?bi %d", g);
+            q.push_back(Query{cmd, "BI ", true, P_Bi, g});
+        }
+    }
+    q.push_back(Query{"?rate", "RATE ", false, P_Rate, 0});
+    q.push_back(Query{"?t", "PERIOD ", false, P_Period, 0});
+    q.push_back(Query{"?k", "MULTIPLIER ", false, P_Mult, 0});
+
+    if (runQueries(q)) {
+        lock();
+        int count = 0;
+        getIntegerParam(P_PollCount, &count);
+        setIntegerParam(P_PollCount, count + 1);
+        callParamCallbacks();
+        unlock();
+    }
+}
+
+// Switches the firmware to binary frames: "?bin" must report our protocol
+// version, then "!bin 1". The firmware may still be in binary mode from an
+// earlier IOC run, so first send it OpText and drop whatever comes back.
+bool drvEspCmd::negotiateBinary()
+{
+    static const char *functionName = "negotiateBinary";
+    epicsGuard<epicsMutex> guard(ioLock_);
+
+    epicsUInt8 frame[espBinary::kEncodedMax + 1];
+    size_t n = espBinary::encodeFrame(espBinary::OpText, 0, 0, 0, frame);
+    frame[n++] = '\n';
+    size_t nwrite = 0;
+    pasynOctetSyncIO->setInputEos(octet_, "\n", 1);
+    pasynOctetSyncIO->write(octet_, reinterpret_cast<const char *>(frame), n, kReplyTimeout, &nwrite);
+    epicsThreadSleep(0.1);
+    pasynOctetSyncIO->flush(octet_);
+
+    char reply[64];
+    if (exchange("?bin", reply, sizeof(reply)) != asynSuccess) {
+        return false;
+    }
+    int version = 0;
+    if (startsWith(reply, "ERROR_") ||
+        (std::sscanf(reply, "BIN %d", &version) == 1 && version != espBinary::kVersion)) {
+        asynPrint(pasynUserSelf, ASYN_TRACE_WARNING, "%s:%s: no binary protocol %d ('%s'), staying in text mode\n",
+                  driverName, functionName, espBinary::kVersion, reply);
+        binaryWanted_ = false;
+        return false;
+    }
+    if (version != espBinary::kVersion) {
+        return false; // out of sync; try again next cycle
+    }
+    if (exchange("!bin 1", reply, sizeof(reply)) != asynSuccess || std::strcmp(reply, "Ok") != 0) {
+        return false;
+    }
+    pasynOctetSyncIO->setInputEos(octet_, "\0", 1);
+    binaryActive_ = true;
+    return true;
+}
+
+// One request/reply; called with ioLock_ held. On OpError, *fwStatus is the
+// firmware's status code. reply (kFrameMax bytes) may be 0 if the payload
+// is not needed.
+asynStatus drvEspCmd::binaryRequest(epicsUInt8 op, const epicsUInt8 *payload, size_t len, epicsUInt8 *reply,
+                                    size_t *replyLen, int *fwStatus)
+{
+    static const char *functionName = "binaryRequest";
+    epicsUInt8 frame[espBinary::kEncodedMax];
+    const epicsUInt16 id = ++nextId_;
+    const size_t n = espBinary::encodeFrame(op, id, payload, len, frame);
+    size_t nwrite = 0;
+    asynStatus status =
+        pasynOctetSyncIO->write(octet_, reinterpret_cast<const char *>(frame), n, kReplyTimeout, &nwrite);
+    if (status != asynSuccess) {
+        return status;
+    }
+
+    for (int stale = 0; stale < kMaxStaleFrames;) {
+        char buf[256];
+        size_t nread = 0;
+        int eomReason = 0;
+        status = pasynOctetSyncIO->read(octet_, buf, sizeof(buf), kReplyTimeout, &nread, &eomReason);
+        if (status != asynSuccess) {
+            return status;
+        }
+        epicsUInt8 f[espBinary::kFrameMax];
+        size_t flen = 0;
+        if (!espBinary::decodeFrame(reinterpret_cast<const epicsUInt8 *>(buf), nread, f, &flen)) {
+            asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: dropped %lu bytes that are not a valid frame\n",
+                      driverName, functionName, static_cast<unsigned long>(nread));
+            stale++;
+            continue;
+        }
+        if (queueBinarySample(f, flen)) {
+            continue;
+        }
+        const epicsUInt16 replyId = espBinary::getU16(f + 1);
+        if (f[0] == espBinary::OpError && (replyId == id || replyId == 0)) {
+            if (fwStatus) {
+                *fwStatus = flen > espBinary::kHeader ? f[espBinary::kHeader] : -1;
+            }
+            return asynError;
+        }
+        if (replyId != id) {
+            stale++;
+            continue; // reply to an earlier request
+        }
+        if (f[0] != (op | espBinary::OpReply)) {
+            return asynError;
+        }
+        if (reply) {
+            *replyLen = flen - espBinary::kHeader;
+            std::memcpy(reply, f + espBinary::kHeader, *replyLen);
+        }
+        return asynSuccess;
+    }
+    return asynError;
+}
+
+bool drvEspCmd::pollBinaryInfo()
+{
+    epicsUInt8 r[espBinary::kFrameMax];
+    size_t len = 0;
+    asynStatus status;
+    {
+        epicsGuard<epicsMutex> guard(ioLock_);
+        status = binaryRequest(espBinary::OpGetInfo, 0, 0, r, &len, 0);
+    }
+    if (status != asynSuccess || len < espBinary::kInfoFixed + 2) {
+        return false;
+    }
+    const char *id = reinterpret_cast<const char *>(r + espBinary::kInfoFixed);
+    const size_t idLen = strnlen(id, len - espBinary::kInfoFixed);
+    if (espBinary::kInfoFixed + idLen + 1 >= len) {
+        return false;
+    }
+    const char *version = id + idLen + 1;
+    const std::string versionStr(version, strnlen(version, len - espBinary::kInfoFixed - idLen - 1));
+
+    lock();
+    setStringParam(P_Id, std::string(id, idLen).c_str());
+    setStringParam(P_Version, versionStr.c_str());
+    setIntegerParam(P_NumAi, r[0]);
+    setIntegerParam(P_NumBi, r[1]);
+    setIntegerParam(P_PeriodMin, static_cast<epicsInt32>(espBinary::getU32(r + 2)));
+    setIntegerParam(P_PeriodMax, static_cast<epicsInt32>(espBinary::getU32(r + 6)));
+    setIntegerParam(P_MultMin, static_cast<epicsInt32>(espBinary::getU32(r + 10)));
+    setIntegerParam(P_MultMax, static_cast<epicsInt32>(espBinary::getU32(r + 14)));
+    const int params[] = {P_Id, P_Version, P_NumAi, P_NumBi, P_PeriodMin, P_PeriodMax, P_MultMin, P_MultMax};
+    for (size_t i = 0; i < sizeof(params) / sizeof(params[0]); i++) {
+        setParamStatus(0, params[i], asynSuccess);
+    }
+    callParamCallbacks();
+    unlock();
+    return true;
+}
+
+void drvEspCmd::pollBinary()
+{
+    epicsUInt8 r[espBinary::kFrameMax];
+    size_t len = 0;
+    asynStatus status;
+    {
+        epicsGuard<epicsMutex> guard(ioLock_);
+        status = binaryRequest(espBinary::OpGetAll, 0, 0, r, &len, 0);
+        if (status == asynSuccess && len < espBinary::kAllSize) {
+            status = asynError;
+        }
+        if (status == asynTimeout) {
+            // Reset or lost sync: back to text until renegotiated.
+            binaryActive_ = false;
+            pasynOctetSyncIO->setInputEos(octet_, "\n", 1);
+            pasynOctetSyncIO->flush(octet_);
+        }
+    }
+
+    lock();
+    updateTimeStamp();
+    if (status == asynSuccess) {
+        long raw[kNumAi];
+        double mean[kNumAi];
+        for (int i = 0; i < kNumAi; i++) {
+            raw[i] = espBinary::getU16(r + 2 * i);
+            mean[i] = espBinary::getF32(r + 2 * kNumAi + 4 * i);
+        }
+        const epicsUInt8 *tail = r + 6 * kNumAi;
+        applyState(raw, mean, static_cast<long>(espBinary::getU32(tail)), static_cast<long>(espBinary::getU32(tail + 4)),
+                   static_cast<long>(espBinary::getU32(tail + 8)), static_cast<long>(espBinary::getU32(tail + 12)));
+    } else {
+        setStateStatus(status);
+    }
+    const int counter = status == asynSuccess ? P_PollCount : P_PollErrors;
+    int count = 0;
+    getIntegerParam(counter, &count);
+    setIntegerParam(counter, count + 1);
+    for (int addr = 0; addr < kNumGpio; addr++) {
+        callParamCallbacks(addr);
+    }
+    unlock();
+}
+
+// "SAMPLE <seq> <t_us> <samples> <mask> <mean0..3>"; queues it and returns
+// true if line is a stream record. Called with ioLock_ held.
+bool drvEspCmd::queueTextSample(const char *line)
+{
+    if (!startsWith(line, "SAMPLE ")) {
+        return false;
+    }
+    StreamSample s;
+    const char *p = line + 7;
+    char *end = 0;
+    s.seq = static_cast<epicsUInt16>(std::strtoul(p, &end, 10));
+    p = end;
+    s.deviceTime = std::strtod(p, &end) * 1e-6;
+    p = end;
+    s.samples = static_cast<epicsUInt32>(std::strtoul(p, &end, 10));
+    p = end;
+    s.mask = static_cast<int>(std::strtol(p, &end, 10)) & ((1 << kNumAi) - 1);
+    for (int i = 0; i < kNumAi; i++) {
+        p = end;
+        s.mean[i] = std::strtod(p, &end);
+        if (end == p) {
+            return true; // truncated; dropped, and counted by the sequence gap
+        }
+    }
+    epicsTimeGetCurrent(&s.received);
+    samples_.push_back(s);
+    return true;
+}
+
+// Same for an OpSample frame (decoded, header included).
+bool drvEspCmd::queueBinarySample(const epicsUInt8 *frame, size_t len)
+{
+    if (frame[0] != espBinary::OpSample) {
+        return false;
+    }
+    if (len < espBinary::kHeader + espBinary::kSampleFixed) {
+        return true;
+    }
+    const epicsUInt8 *p = frame + espBinary::kHeader;
+    StreamSample s;
+    s.seq = espBinary::getU16(frame + 1);
+    s.deviceTime = (espBinary::getU32(p) + 4294967296.0 * espBinary::getU32(p + 4)) * 1e-6;
+    s.samples = espBinary::getU32(p + 8);
+    s.mask = p[12] & ((1 << kNumAi) - 1);
+    p += espBinary::kSampleFixed;
+    for (int i = 0; i < kNumAi; i++) {
+        if (s.mask & (1 << i)) {
+            if (p + 4 > frame + len) {
+                return true;
+            }
+            s.mean[i] = espBinary::getF32(p);
+            p += 4;
+        }
+    }
+    epicsTimeGetCurrent(&s.received);
+    samples_.push_back(s);
+    return true;
+}
+
+// Waits up to timeout for one stream record.
+void drvEspCmd::readUnsolicited(double timeout)
+{
+    epicsGuard<epicsMutex> guard(ioLock_);
+    char buf[256];
+    size_t nread = 0;
+    int eomReason = 0;
+    if (pasynOctetSyncIO->read(octet_, buf, sizeof(buf) - 1, timeout, &nread, &eomReason) != asynSuccess) {
+        return;
+    }
+    if (binaryActive_) {
+        epicsUInt8 f[espBinary::kFrameMax];
+        size_t flen = 0;
+        if (espBinary::decodeFrame(reinterpret_cast<const epicsUInt8 *>(buf), nread, f, &flen)) {
+            queueBinarySample(f, flen);
+        }
+    } else {
+        buf[nread] = '\0';
+        queueTextSample(buf);
+    }
+}
+
+// Posts the queued stream records, each with the host time of its window
+// end, derived from the device clock.
+void drvEspCmd::applySamples()
+{
+    std::vector<StreamSample> samples;
+    {
+        epicsGuard<epicsMutex> guard(ioLock_);
+        samples.swap(samples_);
+    }
+    if (samples.empty()) {
+        return;
+    }
+
+    lock();
+    int lost = 0;
+    getIntegerParam(P_StreamLost, &lost);
+    for (size_t k = 0; k < samples.size(); k++) {
+        const StreamSample &s = samples[k];
+        const double received = s.received.secPastEpoch + s.received.nsec * 1e-9;
+        const double offset = received - s.deviceTime;
+        // The device clock jumping back is an ESP32 reset; its sequence
+        // numbers restart as well, which is not lost records.
+        const bool restarted = haveOffset_ && offset > clockOffset_ + 1.0;
+        if (!haveOffset_ || restarted || offset < clockOffset_ + kOffsetCreep) {
+            clockOffset_ = offset;
+            haveOffset_ = true;
+            if (restarted) {
+                lastSeq_ = -1;
+            }
+        } else {
+            clockOffset_ += kOffsetCreep;
+        }
+        const double t = s.deviceTime + clockOffset_;
+        epicsTimeStamp ts;
+        ts.secPastEpoch = static_cast<epicsUInt32>(t);
+        ts.nsec = static_cast<epicsUInt32>((t - std::floor(t)) * 1e9);
+        setTimeStamp(&ts);
+
+        if (lastSeq_ >= 0) {
+            lost += (s.seq - lastSeq_ - 1) & 0xFFFF;
+        }
+        lastSeq_ = s.seq;
+        if (s.mask != streamMask_) {
+            streamMask_ = s.mask; // e.g. still streaming from before an IOC restart
+            setIntegerParam(P_StreamMask, s.mask);
+        }
+
+        setIntegerParam(P_StreamSeq, s.seq);
+        setIntegerParam(P_StreamSamples, static_cast<epicsInt32>(s.samples));
+        setDoubleParam(P_StreamTime, s.deviceTime);
+        setIntegerParam(P_StreamLost, lost);
+        for (int i = 0; i < kNumAi; i++) {
+            if (s.mask & (1 << i)) {
+                setDoubleParam(i, P_AiMean, s.mean[i]);
+                setParamStatus(i, P_AiMean, asynSuccess);
+            }
+            if (i == 0 || (s.mask & (1 << i))) {
+                callParamCallbacks(i);
+            }
+        }
+    }
+    // Back to the current time for everything else posted by this driver.
+    updateTimeStamp();
+    unlock();
+}
+
+void drvEspCmd::pollerThread()
+{
+    bool haveInfo = false;
+    for (;;) {
+        if (binaryWanted_ && !binaryActive_ && negotiateBinary()) {
+            haveInfo = false;
+        }
+        if (!haveInfo) {
+            haveInfo = binaryActive_ ? pollBinaryInfo() : pollInfo();
+        }
+        if (binaryActive_) {
+            pollBinary();
+        } else {
+            pollValues();
+        }
+        lock();
+        setIntegerParam(P_Binary, binaryActive_ ? 1 : 0);
+        callParamCallbacks();
+        unlock();
+
+        applySamples();
+
+        double period = 1.0;
+        lock();
+        getDoubleParam(P_PollPeriod, &period);
+        const bool streaming = streamMask_ != 0;
+        unlock();
+        if (!streaming) {
+            wakeup_.wait(period);
+            continue;
+        }
+        epicsTimeStamp start, now;
+        epicsTimeGetCurrent(&start);
+        do {
+            readUnsolicited(kStreamReadTimeout);
+            applySamples();
+            if (wakeup_.tryWait()) {
+                break;
+            }
+            epicsTimeGetCurrent(&now);
+        } while (epicsTimeDiffInSeconds(&now, &start) < period);
+    }
+}
+
+// One text command and its reply line; called with ioLock_ held.
+asynStatus drvEspCmd::exchange(const std::string &cmd, char *reply, size_t size)
+{
+    const std::string line = cmd + "\n";
+    size_t nwrite = 0;
+    reply[0] = '\0';
+    asynStatus status = pasynOctetSyncIO->write(octet_, line.data(), line.size(), kReplyTimeout, &nwrite);
+    if (status != asynSuccess) {
+        return status;
+    }
+    size_t nread = 0;
+    int eomReason = 0;
+    do {
+        status = pasynOctetSyncIO->read(octet_, reply, size - 1, kReplyTimeout, &nread, &eomReason);
+        reply[nread] = '\0';
+        if (nread > 0 && reply[nread - 1] == '\r') {
+            reply[nread - 1] = '\0';
+        }
+    } while (status == asynSuccess && queueTextSample(reply));
+    if (status != asynSuccess) {
+        pasynOctetSyncIO->flush(octet_);
+    }
+    return status;
+}
+
+// One command for an output record, as text (cmd, answered by "Ok") or as
+// the equivalent binary request; called with the driver locked, between
+// poll batches.
+asynStatus drvEspCmd::command(const std::string &cmd, epicsUInt8 op, const epicsUInt8 *payload, size_t len,
+                              asynUser *pasynUser)
+{
+    if (!octet_) {
+        epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize, "serial port not connected");
+        return asynDisconnected;
+    }
+
+    epicsGuard<epicsMutex> guard(ioLock_);
+    if (binaryActive_) {
+        int fwStatus = -1;
+        const asynStatus status = binaryRequest(op, payload, len, 0, 0, &fwStatus);
+        if (status != asynSuccess) {
+            epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize, "%s: %s", cmd.c_str(),
+                          fwStatus >= 0 ? espBinary::statusText(fwStatus) : "no reply");
+        }
+        return status;
+    }
+
+    char buf[128];
+    const asynStatus status = exchange(cmd, buf, sizeof(buf));
+    if (status != asynSuccess) {
+        epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize, "%s: no reply", cmd.c_str());
+        return status;
+    }
+    if (std::strcmp(buf, "Ok") != 0) {
+        epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize, "%s: %s", cmd.c_str(), buf);
+        return asynError;
+    }
+    return asynSuccess;
+}
+
+asynStatus drvEspCmd::writeInt32(asynUser *pasynUser, epicsInt32 value)
+{
+    const int function = pasynUser->reason;
+    int addr = 0;
+    getAddress(pasynUser, &addr);
+
+    char cmd[48];
+    epicsUInt8 op;
+    epicsUInt8 payload[4];
+    size_t len = 2;
+    payload[0] = static_cast<epicsUInt8>(addr);
+    payload[1] = static_cast<epicsUInt8>(value);
+    if (function == P_AiWatch) {
+        if (addr < 0 || addr >= kNumAi) {
+            epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize, "no AI channel %d", addr);
+            return asynError;
+        }
+        std::snprintf(cmd, sizeof(cmd), "!ai:watch %d %d", addr, value ? 1 : 0);
+        op = espBinary::OpSetWatch;
+        payload[1] = value ? 1 : 0;
+    } else if (function == P_Bo) {
+        std::snprintf(cmd, sizeof(cmd), "!bo %d %d", addr, value);
+        op = espBinary::OpSetBo;
+    } else if (function == P_PinDir) {
+        std::snprintf(cmd, sizeof(cmd), "!pin %d %d", addr, value);
+        op = espBinary::OpSetPin;
+    } else if (function == P_Pwm) {
+        std::snprintf(cmd, sizeof(cmd), "!pwm %d %d", addr, value);
+        op = espBinary::OpSetPwm;
+    } else if (function == P_Period) {
+        std::snprintf(cmd, sizeof(cmd), "!t %d", value);
+        op = espBinary::OpSetPeriod;
+        espBinary::putU32(payload, static_cast<epicsUInt32>(value));
+        len = 4;
+    } else if (function == P_Mult) {
+        std::snprintf(cmd, sizeof(cmd), "!k %d", value);
+        op = espBinary::OpSetMult;
+        espBinary::putU32(payload, static_cast<epicsUInt32>(value));
+        len = 4;
+    } else if (function == P_StreamMask || function == P_StreamDecim) {
+        int mask = 0;
+        int decimation = 1;
+        getIntegerParam(P_StreamMask, &mask);
+        getIntegerParam(P_StreamDecim, &decimation);
+        (function == P_StreamMask ? mask : decimation) = value;
+        std::snprintf(cmd, sizeof(cmd), "!stream %d %d", mask, decimation);
+        if (mask < 0 || mask >= (1 << kNumAi) || decimation < 1 || decimation > kMaxDecimation) {
+            epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize, "%s: value out of range", cmd);
+            return asynError;
+        }
+        op = espBinary::OpSetStream;
+        payload[0] = static_cast<epicsUInt8>(mask);
+        espBinary::putU16(payload + 1, static_cast<epicsUInt16>(decimation));
+        len = 3;
+    } else {
+        return asynPortDriver::writeInt32(pasynUser, value);
+    }
+    if (len == 2 && (value < 0 || value > 255)) {
+        epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize, "%s: value out of range", cmd);
+        return asynError;
+    }
+
+    const asynStatus status = command(cmd, op, payload, len, pasynUser);
+    if (status == asynSuccess) {
+        setIntegerParam(addr, function, value);
+        if (function == P_AiWatch) {
+            watched_[addr] = value != 0;
+        } else if (function == P_StreamMask) {
+            // The firmware enables mean accumulation for streamed channels.
+            streamMask_ = value;
+            for (int i = 0; i < kNumAi; i++) {
+                if (value & (1 << i)) {
+                    watched_[i] = true;
+                    setIntegerParam(i, P_AiWatch, 1);
+                    callParamCallbacks(i);
+                }
+            }
+            wakeup_.signal();
+        }
+    }
+    setParamStatus(addr, function, status);
+    callParamCallbacks(addr);
+    asynPrint(pasynUser, status == asynSuccess ? ASYN_TRACEIO_DRIVER : ASYN_TRACE_ERROR,
+              "%s:writeInt32: %s -> %s\n", driverName, cmd, status == asynSuccess ? "Ok" : pasynUser->errorMessage);
+    return status;
+}
+
+asynStatus drvEspCmd::writeFloat64(asynUser *pasynUser, epicsFloat64 value)
+{
+    if (pasynUser->reason != P_PollPeriod) {
+        return asynPortDriver::writeFloat64(pasynUser, value);
+    }
+    if (value <= 0.0) {
+        epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize, "poll period must be > 0");
+        return asynError;
+    }
+    setDoubleParam(P_PollPeriod, value);
+    callParamCallbacks();
+    wakeup_.signal();
+    return asynSuccess;
+}
+
+// "<gpio> <0|1>" strings, as for the StreamDevice pin_mode_raw/bo_raw protocols.
+asynStatus drvEspCmd::writeOctet(asynUser *pasynUser, const char *value, size_t maxChars, size_t *nActual)
+{
+    const int function = pasynUser->reason;
+    const char *verb;
+    if (function == P_PinCmd) {
+        verb = "!pin ";
+    } else if (function == P_BoCmd) {
+        verb = "!bo ";
+    } else {
+        return asynPortDriver::writeOctet(pasynUser, value, maxChars, nActual);
+    }
+
+    const std::string args(value, strnlen(value, maxChars));
+    char *end = 0;
+    const long gpio = std::strtol(args.c_str(), &end, 10);
+    const char *p = end;
+    const long level = std::strtol(p, &end, 10);
+    if (end == p || gpio < 0 || gpio >= kNumGpio || level < 0 || level > 1) {
+        epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize, "expected '<gpio> <0|1>', got '%s'",
+                      args.c_str());
+        return asynError;
+    }
+    const epicsUInt8 payload[2] = {static_cast<epicsUInt8>(gpio), static_cast<epicsUInt8>(level)};
+    const asynStatus status = command(verb + args, function == P_PinCmd ? espBinary::OpSetPin : espBinary::OpSetBo,
+                                      payload, sizeof(payload), pasynUser);
+    if (status == asynSuccess) {
+        setStringParam(function, args.c_str());
+    }
+    setParamStatus(0, function, status);
+    callParamCallbacks();
+    *nActual = maxChars;
+    return status;
+}
+
+extern "C" {
+
+int drvEspCmdConfigure(const char *portName, const char *serialPort, double pollPeriod, int gpioMask, int binary)
+{
+    new drvEspCmd(portName, serialPort, pollPeriod, gpioMask, binary);
+    return asynSuccess;
+}
+
+static const iocshArg initArg0 = {"portName", iocshArgString};
+static const iocshArg initArg1 = {"serialPort", iocshArgString};
+static const iocshArg initArg2 = {"pollPeriod", iocshArgDouble};
+static const iocshArg initArg3 = {"gpioMask", iocshArgInt};
+static const iocshArg initArg4 = {"binary", iocshArgInt};
+static const iocshArg *const initArgs[] = {&initArg0, &initArg1, &initArg2, &initArg3, &initArg4};
+static const iocshFuncDef initFuncDef = {"drvEspCmdConfigure", 5, initArgs};
+
+static void initCallFunc(const iocshArgBuf *args)
+{
+    drvEspCmdConfigure(args[0].sval, args[1].sval, args[2].dval, args[3].ival, args[4].ival);
+}
+
+static void drvEspCmdRegister(void)
+{
+    iocshRegister(&initFuncDef, initCallFunc);
+}
+
+epicsExportRegistrar(drvEspCmdRegister);
+
+} // extern "C"
@@ -0,0 +1,168 @@
+#ifndef DRV_ESP_CMD_H
+#define DRV_ESP_CMD_H
+
+#include <asynPortDriver.h>
+
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsTime.h>
+#include <epicsTypes.h>
+
+#include <string>
+#include <vector>
+
+// Parameter names (drvInfo strings in the records' INP/OUT links). The asyn
+// address is the AI index for ESP_AI*, the GPIO number for ESP_BI/BO/PIN/PWM
+// and 0 otherwise.
+#define ESP_ID_STRING          "ESP_ID"          /* asynOctet   r  */
+#define ESP_VERSION_STRING     "ESP_VERSION"     /* asynOctet   r  */
+#define ESP_NUM_AI_STRING      "ESP_NUM_AI"      /* asynInt32   r  */
+#define ESP_NUM_BI_STRING      "ESP_NUM_BI"      /* asynInt32   r  */
+#define ESP_AI_STRING          "ESP_AI"          /* asynInt32   r  raw ADC counts */
+#define ESP_AI_MEAN_STRING     "ESP_AI_MEAN"     /* asynFloat64 r  mean * multiplier */
+#define ESP_AI_WATCH_STRING    "ESP_AI_WATCH"    /* asynInt32   w  */
+#define ESP_BI_STRING          "ESP_BI"          /* asynInt32   r  */
+#define ESP_BO_STRING          "ESP_BO"          /* asynInt32   w  */
+#define ESP_PIN_DIR_STRING     "ESP_PIN_DIR"     /* asynInt32   w  0=in, 1=out */
+#define ESP_PWM_STRING         "ESP_PWM"         /* asynInt32   w  0..255 */
+#define ESP_PIN_CMD_STRING     "ESP_PIN_CMD"     /* asynOctet   w  "<gpio> <0|1>" */
+#define ESP_BO_CMD_STRING      "ESP_BO_CMD"      /* asynOctet   w  "<gpio> <0|1>" */
+#define ESP_RATE_STRING        "ESP_RATE"        /* asynInt32   r  */
+#define ESP_PERIOD_STRING      "ESP_PERIOD"      /* asynInt32   rw microseconds */
+#define ESP_PERIOD_MIN_STRING  "ESP_PERIOD_MIN"  /* asynInt32   r  */
+#define ESP_PERIOD_MAX_STRING  "ESP_PERIOD_MAX"  /* asynInt32   r  */
+#define ESP_MULT_STRING        "ESP_MULT"        /* asynInt32   rw */
+#define ESP_MULT_MIN_STRING    "ESP_MULT_MIN"    /* asynInt32   r  */
+#define ESP_MULT_MAX_STRING    "ESP_MULT_MAX"    /* asynInt32   r  */
+#define ESP_POLL_PERIOD_STRING "ESP_POLL_PERIOD" /* asynFloat64 rw seconds */
+#define ESP_POLL_COUNT_STRING  "ESP_POLL_COUNT"  /* asynInt32   r  completed poll cycles */
+#define ESP_POLL_ERRORS_STRING "ESP_POLL_ERRORS" /* asynInt32   r  timeouts/out-of-sync replies */
+#define ESP_BINARY_STRING      "ESP_BINARY"      /* asynInt32   r  1 while the binary protocol is in use */
+#define ESP_STREAM_MASK_STRING    "ESP_STREAM_MASK"    /* asynInt32   rw AI channels streamed, bit i = ai i */
+#define ESP_STREAM_DECIM_STRING   "ESP_STREAM_DECIM"   /* asynInt32   rw one record every N windows */
+#define ESP_STREAM_SEQ_STRING     "ESP_STREAM_SEQ"     /* asynInt32   r  sequence number of the last record */
+#define ESP_STREAM_SAMPLES_STRING "ESP_STREAM_SAMPLES" /* asynInt32   r  ADC samples in its window */
+#define ESP_STREAM_TIME_STRING    "ESP_STREAM_TIME"    /* asynFloat64 r  device time of its window end, s */
+#define ESP_STREAM_LOST_STRING    "ESP_STREAM_LOST"    /* asynInt32   r  records missed (sequence gaps) */
+
+// Owns the serial link to the ESP32 firmware (an asyn octet port created
+// with drvAsynSerialPortConfigure) and replaces the per-record StreamDevice
+// exchanges. One poller thread reads the whole device state with the
+// firmware's "?all" command (or, for firmware without it, sends the queries
+// of a cycle in a single write and reads the replies in order) and publishes
+// changed values to I/O Intr records through parameter callbacks. Writes
+// from output records are sent immediately, between poll cycles.
+//
+// With binary != 0 the driver switches the firmware to its binary framed
+// protocol (espBinary.h) when it supports it, and goes back to negotiating
+// after a timeout, e.g. when the ESP32 was reset into text mode.
+//
+// While ESP_STREAM_MASK is non-zero the firmware sends a record with the
+// means of the streamed channels at the end of each averaging window. The
+// poller reads them between poll cycles (and picks them out of the replies
+// it waits for) and posts ESP_AI_MEAN with the device's window time, so
+// streamed means are not polled.
+class drvEspCmd : public asynPortDriver {
+public:
+    drvEspCmd(const char *portName, const char *serialPort, double pollPeriod, int gpioMask, int binary);
+
+    asynStatus writeInt32(asynUser *pasynUser, epicsInt32 value) override;
+    asynStatus writeFloat64(asynUser *pasynUser, epicsFloat64 value) override;
+    asynStatus writeOctet(asynUser *pasynUser, const char *value, size_t maxChars, size_t *nActual) override;
+
+    void pollerThread();
+
+private:
+    // One unsolicited stream record. mean[i] is valid for bit i of mask.
+    struct StreamSample {
+        epicsUInt16 seq;
+        double deviceTime; // s since the ESP32 booted
+        epicsUInt32 samples;
+        int mask;
+        double mean[8];
+        epicsTimeStamp received;
+    };
+
+    // One query and where its reply goes. The reply must start with prefix
+    // (then the index again if indexed) followed by the value. param < 0
+    // marks the "?all" query.
+    struct Query {
+        std::string command;
+        const char *prefix;
+        bool indexed;
+        int param;
+        int addr;
+    };
+
+    bool pollInfo();
+    void pollValues();
+    bool runQueries(const std::vector<Query> &queries);
+    bool applyReply(const Query &q, const char *reply);
+    bool applyAll(const char *reply);
+    void applyState(const long raw[], const double mean[], long levels, long rate, long period, long mult);
+    void setQueryStatus(const Query &q, asynStatus status);
+    void setStateStatus(asynStatus status);
+
+    bool negotiateBinary();
+    bool pollBinaryInfo();
+    void pollBinary();
+    asynStatus binaryRequest(epicsUInt8 op, const epicsUInt8 *payload, size_t len, epicsUInt8 *reply,
+                             size_t *replyLen, int *fwStatus);
+
+    bool queueTextSample(const char *line);
+    bool queueBinarySample(const epicsUInt8 *frame, size_t len);
+    void readUnsolicited(double timeout);
+    void applySamples();
+
+    asynStatus exchange(const std::string &cmd, char *reply, size_t size);
+    asynStatus command(const std::string &cmd, epicsUInt8 op, const epicsUInt8 *payload, size_t len,
+                       asynUser *pasynUser);
+
+    int P_Id;
+    int P_Version;
+    int P_NumAi;
+    int P_NumBi;
+    int P_Ai;
+    int P_AiMean;
+    int P_AiWatch;
+    int P_Bi;
+    int P_Bo;
+    int P_PinDir;
+    int P_Pwm;
+    int P_PinCmd;
+    int P_BoCmd;
+    int P_Rate;
+    int P_Period;
+    int P_PeriodMin;
+    int P_PeriodMax;
+    int P_Mult;
+    int P_MultMin;
+    int P_MultMax;
+    int P_PollPeriod;
+    int P_PollCount;
+    int P_PollErrors;
+    int P_Binary;
+    int P_StreamMask;
+    int P_StreamDecim;
+    int P_StreamSeq;
+    int P_StreamSamples;
+    int P_StreamTime;
+    int P_StreamLost;
+
+    asynUser *octet_;
+    epicsMutex ioLock_; // one exchange on the link at a time
+    epicsEvent wakeup_;
+    int gpioMask_;
+    bool useAll_;       // cleared when the firmware does not know "?all"
+    bool binaryWanted_; // cleared when the firmware has no binary protocol
+    bool binaryActive_; // changed by the poller only, with ioLock_ held
+    epicsUInt16 nextId_;
+    std::vector<bool> watched_; // AI channels with mean accumulation enabled
+    int streamMask_;
+    std::vector<StreamSample> samples_; // received, not yet posted; guarded by ioLock_
+    int lastSeq_;                       // -1 until the first record
+    double clockOffset_;                // host - device time, s
+    bool haveOffset_;
+};
+
+#endif
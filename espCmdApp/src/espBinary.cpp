@@ -0,0 +1,135 @@
+/* espBinary.cpp
+ *
+ * COBS framing and CRC for the ESP32 binary protocol. See espBinary.h.
+ */
+
+#include "espBinary.h"
+
+namespace espBinary {
+
+namespace {
+
+// CRC-16/CCITT-FALSE, one table lookup per byte.
+struct CrcTable {
+    epicsUInt16 t[256];
+    CrcTable()
+    {
+        for (int i = 0; i < 256; i++) {
+            epicsUInt16 crc = static_cast<epicsUInt16>(i << 8);
+            for (int b = 0; b < 8; b++) {
+                crc = (crc & 0x8000) ? static_cast<epicsUInt16>((crc << 1) ^ 0x1021) : static_cast<epicsUInt16>(crc << 1);
+            }
+            t[i] = crc;
+        }
+    }
+};
+
+const CrcTable crcTable;
+
+const char *const statusTexts[] = {
+    "Ok",
+    "ERROR_MISSING_ARGUMENT",
+    "ERROR_INVALID_ARGUMENT",
+    "ERROR_PIN_NOT_AVAILABLE",
+    "ERROR_BO_PIN_NOT_AVAILABLE",
+    "ERROR_PWM_PIN_NOT_AVAILABLE",
+    "ERROR_SETTING_PINMODE",
+    "ERROR_SETTING_BO_LEVEL",
+    "ERROR_PWM_VALUE_OUT_OF_RANGE",
+    "ERROR_NO_PWM_SLOTS_AVAILABLE",
+    "ERROR_CONFIGURING_LEDC_TIMER",
+    "ERROR_CONFIGURING_LEDC_CHANNEL",
+    "ERROR_SETTING_PWM_DUTY",
+    "ERROR_UPDATING_PWM_DUTY",
+    "ERROR_AI_INDEX_OUT_OF_RANGE",
+    "ERROR_READING_ADC",
+    "ERROR_MULTIPLIER_RANGE",
+    "ERROR_UNKNOWN_COMMAND",
+    "ERROR_BAD_FRAME",
+};
+
+} // namespace
+
+const char *statusText(int status)
+{
+    if (status < 0 || status >= static_cast<int>(sizeof(statusTexts) / sizeof(statusTexts[0]))) {
+        return "ERROR_UNKNOWN";
+    }
+    return statusTexts[status];
+}
+
+epicsUInt16 crc16(const epicsUInt8 *data, size_t len)
+{
+    epicsUInt16 crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc = static_cast<epicsUInt16>((crc << 8) ^ crcTable.t[((crc >> 8) ^ data[i]) & 0xFF]);
+    }
+    return crc;
+}
+
+size_t encodeFrame(epicsUInt8 op, epicsUInt16 id, const epicsUInt8 *payload, size_t len, epicsUInt8 *out)
+{
+    epicsUInt8 raw[kFrameMax];
+    if (len + kHeader + 2 > sizeof(raw)) {
+        return 0;
+    }
+    raw[0] = op;
+    putU16(raw + 1, id);
+    if (len > 0) {
+        std::memcpy(raw + kHeader, payload, len);
+    }
+    const size_t n = kHeader + len;
+    putU16(raw + n, crc16(raw, n));
+
+    size_t codePos = 0;
+    size_t o = 1;
+    epicsUInt8 code = 1;
+    for (size_t i = 0; i < n + 2; i++) {
+        if (raw[i] == 0) {
+            out[codePos] = code;
+            codePos = o++;
+            code = 1;
+        } else {
+            out[o++] = raw[i];
+            if (++code == 0xFF) {
+                out[codePos] = code;
+                codePos = o++;
+                code = 1;
+            }
+        }
+    }
+    out[codePos] = code;
+    out[o++] = 0;
+    return o;
+}
+
+bool decodeFrame(const epicsUInt8 *in, size_t inLen, epicsUInt8 *out, size_t *len)
+{
+    size_t i = 0;
+    size_t o = 0;
+    while (i < inLen) {
+        const epicsUInt8 code = in[i++];
+        if (code == 0) {
+            return false;
+        }
+        for (epicsUInt8 k = 1; k < code; k++) {
+            if (i >= inLen || o >= kFrameMax) {
+                return false;
+            }
+            out[o++] = in[i++];
+        }
+        if (code != 0xFF && i < inLen) {
+            if (o >= kFrameMax) {
+                return false;
+            }
+            out[o++] = 0;
+        }
+    }
+    if (o < kHeader + 2 || crc16(out, o - 2) != getU16(out + o - 2)) {
+        return false;
+    }
+    *len = o - 2;
+    return true;
+}
+
+} // namespace espBinary
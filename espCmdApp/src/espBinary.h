@@ -0,0 +1,95 @@
+#ifndef ESP_BINARY_H
+#define ESP_BINARY_H
+
+#include <epicsTypes.h>
+
+#include <cstddef>
+#include <cstring>
+
+// Binary framed protocol of the ESP32 firmware; the op codes, payload
+// layouts and status codes must match esp32/epics_esp32.c. A frame is
+//   u8 op, u16 id, payload, u16 crc16
+// (little endian, CRC-16/CCITT-FALSE over op..payload), COBS-encoded and
+// terminated by 0x00.
+namespace espBinary {
+
+const int kVersion = 1;
+const size_t kFrameMax = 96; // decoded, header and CRC included
+const size_t kEncodedMax = kFrameMax + kFrameMax / 254 + 2; // with the 0x00 delimiter
+const size_t kHeader = 3; // op, id
+
+enum Op {
+    OpGetAll = 0x01,
+    OpGetInfo = 0x02,
+    OpSetBo = 0x10,
+    OpSetPin = 0x11,
+    OpSetPwm = 0x12,
+    OpSetWatch = 0x13,
+    OpSetPeriod = 0x14,
+    OpSetMult = 0x15,
+    OpSetStream = 0x16,
+    OpText = 0x1F,
+    OpSample = 0x40,
+    OpError = 0x7F,
+    OpReply = 0x80,
+};
+
+// OpGetAll reply: u16 raw[4], f32 mean[4], u32 levels, rate, period_us,
+// multiplier, u8 watched.
+const size_t kAllSize = 41;
+// OpGetInfo reply: u8 num_ai, num_bin, u32 period min, max, multiplier min,
+// max, then the NUL-terminated id and version strings.
+const size_t kInfoFixed = 18;
+// OpSample (unsolicited, id = sequence number): u64 t_us, u32 samples,
+// u8 mask, then f32 mean for each channel in mask.
+const size_t kSampleFixed = 13;
+
+// Firmware cmd_status_t: "Ok", or the text-mode error prefix without ": ".
+const char *statusText(int status);
+
+epicsUInt16 crc16(const epicsUInt8 *data, size_t len);
+
+// Builds the frame for op/id/payload into out (at least kEncodedMax bytes),
+// delimiter included; returns its length, or 0 if the payload is too long.
+size_t encodeFrame(epicsUInt8 op, epicsUInt16 id, const epicsUInt8 *payload, size_t len, epicsUInt8 *out);
+
+// Decodes one received frame (without the delimiter) into out (kFrameMax
+// bytes) and checks the CRC; *len is the length of op, id and payload.
+bool decodeFrame(const epicsUInt8 *in, size_t inLen, epicsUInt8 *out, size_t *len);
+
+inline epicsUInt16 getU16(const epicsUInt8 *p)
+{
+    return static_cast<epicsUInt16>(p[0] | (p[1] << 8));
+}
+
+inline epicsUInt32 getU32(const epicsUInt8 *p)
+{
+    return static_cast<epicsUInt32>(p[0]) | (static_cast<epicsUInt32>(p[1]) << 8) |
+           (static_cast<epicsUInt32>(p[2]) << 16) | (static_cast<epicsUInt32>(p[3]) << 24);
+}
+
+inline epicsFloat32 getF32(const epicsUInt8 *p)
+{
+    const epicsUInt32 u = getU32(p);
+    epicsFloat32 f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+inline void putU16(epicsUInt8 *p, epicsUInt16 v)
+{
+    p[0] = static_cast<epicsUInt8>(v);
+    p[1] = static_cast<epicsUInt8>(v >> 8);
+}
+
+inline void putU32(epicsUInt8 *p, epicsUInt32 v)
+{
+    p[0] = static_cast<epicsUInt8>(v);
+    p[1] = static_cast<epicsUInt8>(v >> 8);
+    p[2] = static_cast<epicsUInt8>(v >> 16);
+    p[3] = static_cast<epicsUInt8>(v >> 24);
+}
+
+} // namespace espBinary
+
+#endif
@@ -40,6 +40,27 @@ cd "${TOP}/espCmdApp/Db"
 dbLoadTemplate("gpio.substitutions")
 cd "${TOP}"
 
+#- Alternative StreamDevice databases: one "?all" exchange per SCAN period
+#- refreshes every input through I/O Intr records (needs firmware with ?all).
+#- Load these instead of espCmd.db and gpio.substitutions.
+#dbLoadRecords("${TOP}/espCmdApp/Db/espCmdAll.db","P=ESP:,PORT=vasu-usb,SCAN=.5 second")
+#- Streaming mode records (SAMPLE lines), optional on top of espCmdAll.db
+#dbLoadRecords("${TOP}/espCmdApp/Db/espCmdStream.db","P=ESP:,PORT=vasu-usb")
+#cd "${TOP}/espCmdApp/Db"
+#dbLoadTemplate("gpioAll.substitutions")
+#cd "${TOP}"
+
+#- Alternative: native asyn driver (drvEspCmd) that polls everything in one
+#- batched exchange and updates I/O Intr records. Use it instead of the
+#- StreamDevice databases above, never together on the same serial port.
+#- Arguments: port, serial port, poll period (s), GPIO mask (0 = all usable pins),
+#- binary (1 = use the firmware's binary framed protocol when it has one)
+#drvEspCmdConfigure("ESP","vasu-usb",0.5,0,1)
+#dbLoadRecords("${TOP}/espCmdApp/Db/espCmdAsyn.db","P=ESP:,PORT=ESP")
+#cd "${TOP}/espCmdApp/Db"
+#dbLoadTemplate("gpioAsyn.substitutions")
+#cd "${TOP}"
+
 #cd "${TOP}/iocBoot/${IOC}"
 iocInit
 